@@ -0,0 +1,52 @@
+/**
+ * @file axis_mailbox.cpp
+ * @brief Implementation of the sequence-locked axis state mailbox.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The state is stored as relaxed atomic words so a reader racing a writer is
+ * well defined; the sequence counter around it tells the reader whether the
+ * words it copied belong to a single publish.
+ */
+#include "axis_mailbox.h"
+#include "version.h"
+#include <string.h>
+
+AxisMailbox axis_mailboxes[AXIS_COUNT];
+
+void AxisMailbox::publish(const AxisState& state) {
+    uint32_t raw[WORDS];
+    memcpy(raw, &state, sizeof(raw));
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (int i = 0; i < WORDS; i++) {
+        words[i].store(raw[i], std::memory_order_relaxed);
+    }
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+uint32_t AxisMailbox::read(AxisState& state) const {
+    uint32_t raw[WORDS];
+    uint32_t before;
+    uint32_t after;
+
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        for (int i = 0; i < WORDS; i++) {
+            raw[i] = words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    memcpy(&state, raw, sizeof(raw));
+    return before >> 1;
+}
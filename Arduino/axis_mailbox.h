@@ -0,0 +1,85 @@
+/**
+ * @file axis_mailbox.h
+ * @brief Lock-free, single-producer/single-consumer axis state mailbox.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The servo task publishes the latest position, limit state and timestamp of
+ * each axis as a versioned snapshot protected by a sequence lock. Readers (the
+ * LED task) always get a consistent copy of the newest state without any queue
+ * backlog, and the writer never blocks. The mailboxes are statically allocated,
+ * so they are valid before either task starts.
+ */
+#ifndef AXIS_MAILBOX_H
+#define AXIS_MAILBOX_H
+
+#include "version.h"
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @enum AxisId
+ * @brief Axis indices, shared with the LED strip indices.
+ */
+enum AxisId {
+    AXIS_Y = 0,
+    AXIS_YY = 1,
+    AXIS_X = 2,
+    AXIS_COUNT
+};
+
+/**
+ * @struct AxisState
+ * @brief One published sample of an axis.
+ */
+struct AxisState {
+    int32_t position;           // Encoder counts
+    uint16_t status;            // Raw limit/status word
+    uint8_t min_limit;          // Min limit switch active
+    uint8_t max_limit;          // Max limit switch active
+    uint32_t timestamp_ms;      // millis() when the position was received
+    uint32_t last_move_tick;    // Tick count of the last position change
+    uint8_t stale;              // Last read failed; the values are the last known ones
+    uint8_t reserved[3];
+};
+
+/**
+ * @class AxisMailbox
+ * @brief Sequence-locked holder of the newest AxisState of one axis.
+ */
+class AxisMailbox {
+public:
+    /**
+     * @brief Publishes a new state. Only one task may publish to a mailbox.
+     */
+    void publish(const AxisState& state);
+
+    /**
+     * @brief Reads the newest consistent state.
+     *
+     * Retries while a publish is in progress; never blocks the writer.
+     *
+     * @param state Receives the state.
+     * @return The version of the state read, 0 if nothing was published yet.
+     */
+    uint32_t read(AxisState& state) const;
+
+    /**
+     * @brief Returns the current version, which changes on every publish.
+     */
+    uint32_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+
+private:
+    static const int WORDS = sizeof(AxisState) / sizeof(uint32_t);
+    static_assert(sizeof(AxisState) % sizeof(uint32_t) == 0, "AxisState must be a whole number of words");
+
+    // Odd while a publish is in progress
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> words[WORDS] = {};
+};
+
+// One mailbox per axis, written by servo_task and read by led_task
+extern AxisMailbox axis_mailboxes[AXIS_COUNT];
+
+#endif // AXIS_MAILBOX_H
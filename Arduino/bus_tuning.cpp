@@ -0,0 +1,134 @@
+/**
+ * @file bus_tuning.cpp
+ * @brief Implementation of the RS485 baud rate autotune.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Probes are single-register reads of the servo status register, issued
+ * through the Modbus RTU master one at a time so each round trip is measured
+ * on an otherwise idle bus.
+ */
+#include "bus_tuning.h"
+#include "version.h"
+#include "config.h"
+#include "modbus_rtu.h"
+#include "servo_registers.h"
+#include "logger.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const int tuning_rates[BUS_TUNING_RATE_COUNT] = {9600, 19200, 38400, 57600, 115200, 230400};
+
+static BusTuningReport tuning_report;
+
+/**
+ * @struct ProbeResult
+ * @brief Outcome of one probe, filled in by the completion callback.
+ */
+struct ProbeResult {
+    bool ok;
+    uint32_t elapsed_us;
+    TaskHandle_t waiter;
+};
+
+static void probe_done(const ModbusRequest& request, const ModbusResponse& response) {
+    ProbeResult* result = (ProbeResult*)request.context;
+    result->ok = response.status == MODBUS_OK;
+    result->elapsed_us = response.elapsed_us;
+    xTaskNotifyGive(result->waiter);
+}
+
+/**
+ * @brief Sends one probe and waits for its completion.
+ */
+static bool probe(uint8_t slave_id, uint32_t* elapsed_us) {
+    ProbeResult result = {false, 0, xTaskGetCurrentTaskHandle()};
+
+    ModbusRequest request;
+    request.slave_id = slave_id;
+    request.address = SERVO_REG_STATUS;
+    request.count = 1;
+    request.timeout_ms = config.SERVOS.RESPONSE_TIMEOUT_MS;
+    request.deadline_ms = millis() + config.SERVOS.RESPONSE_TIMEOUT_MS;
+    request.callback = probe_done;
+    request.context = &result;
+    if (!modbus_rtu_submit(request)) return false;
+
+    // The master always completes a request, at the latest after its timeout
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    *elapsed_us = result.elapsed_us;
+    return result.ok;
+}
+
+/**
+ * @brief Runs the baud rate autotune on the RS485 bus.
+ */
+int bus_autotune(const uint8_t slave_ids[AXIS_COUNT]) {
+    char parity = config.SERVOS.PARITY[0];
+    int selected = 0;
+
+    tuning_report = {};
+    LOG_INFO(LOG_MODBUS, "RS485 autotune started.");
+
+    for (int r = 0; r < BUS_TUNING_RATE_COUNT; r++) {
+        BusTuningRate& rate = tuning_report.rates[r];
+        rate.baud = tuning_rates[r];
+        if (!modbus_rtu_set_line(rate.baud, parity, config.SERVOS.INTER_FRAME_US)) break;
+        rate.tested = 1;
+        rate.reliable = 1;
+
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            uint64_t total_us = 0;
+            for (int p = 0; p < BUS_TUNING_PROBES; p++) {
+                uint32_t elapsed_us = 0;
+                if (!probe(slave_ids[axis], &elapsed_us)) continue;
+                rate.successes[axis]++;
+                total_us += elapsed_us;
+                if (elapsed_us > rate.max_rtt_us[axis]) rate.max_rtt_us[axis] = elapsed_us;
+            }
+            if (rate.successes[axis] > 0) {
+                rate.avg_rtt_us[axis] = total_us / rate.successes[axis];
+            }
+            if (rate.successes[axis] < BUS_TUNING_PROBES) {
+                rate.reliable = 0;
+            }
+        }
+
+        LOG_INFO(LOG_MODBUS, "RS485 autotune %d baud: %u/%u/%u ok, avg rtt %u/%u/%u us", rate.baud,
+                 (unsigned)rate.successes[0], (unsigned)rate.successes[1], (unsigned)rate.successes[2],
+                 (unsigned)rate.avg_rtt_us[0], (unsigned)rate.avg_rtt_us[1], (unsigned)rate.avg_rtt_us[2]);
+
+        // Stop climbing at the first unreliable rate above a reliable one
+        if (!rate.reliable) {
+            if (selected != 0) break;
+            LOG_WARN(LOG_MODBUS, "RS485 autotune: %d baud unreliable, trying the next rate.", rate.baud);
+            continue;
+        }
+        selected = rate.baud;
+    }
+
+    // Fall back to the configured rate if no rate was reliable
+    if (selected == 0) {
+        selected = config.SERVOS.BAUD;
+        LOG_WARN(LOG_MODBUS, "RS485 autotune found no reliable rate, keeping %d baud.", selected);
+    }
+    modbus_rtu_set_line(selected, parity, config.SERVOS.INTER_FRAME_US);
+
+    // The drives were not reconfigured, so the rate is not saved
+    if (selected != config.SERVOS.BAUD) {
+        LOG_INFO(LOG_MODBUS, "RS485 autotune selected %d baud (configured %d) until restart.", selected,
+                 config.SERVOS.BAUD);
+    }
+
+    tuning_report.selected_baud = selected;
+    tuning_report.valid = 1;
+    return selected;
+}
+
+/**
+ * @brief Returns the report of the last autotune run.
+ */
+const BusTuningReport& bus_tuning_report() {
+    return tuning_report;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file bus_tuning.h
+ * @brief RS485 baud rate autotune and per-slave round-trip report.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The autotune steps through the supported baud rates from slowest to fastest
+ * and probes every servo a number of times at each rate, recording how many
+ * probes succeeded and their round-trip times. Once a rate has been found
+ * reliable, it stops climbing at the next rate where any servo is unreliable.
+ * It then returns the bus to the fastest rate where all servos answered every
+ * probe (or the configured rate if none did).
+ *
+ * Only the master's UART changes rate; the drives keep whatever their own
+ * baud parameter says, so a rate is only reliable if the drives happen to be
+ * set to it. The selected rate is therefore not saved: it is used until the
+ * next restart, and servo_task returns to config.SERVOS.BAUD if the bus stops
+ * answering at it.
+ */
+#ifndef BUS_TUNING_H
+#define BUS_TUNING_H
+
+#include "version.h"
+#include "axis_mailbox.h"
+#include <stdint.h>
+
+// Rates tried by the autotune, slowest first
+#define BUS_TUNING_RATE_COUNT   6
+
+// Probes per servo and rate; a rate is reliable only if all of them succeed
+#define BUS_TUNING_PROBES       20
+
+/**
+ * @struct BusTuningRate
+ * @brief Probe results of all servos at one baud rate.
+ */
+struct BusTuningRate {
+    int baud;
+    uint8_t tested;                         // Rate was probed (not skipped after a failure)
+    uint8_t reliable;                       // Every probe of every servo succeeded
+    uint16_t successes[AXIS_COUNT];         // Successful probes per servo
+    uint32_t avg_rtt_us[AXIS_COUNT];        // Mean round trip of the successful probes
+    uint32_t max_rtt_us[AXIS_COUNT];        // Slowest successful probe
+};
+
+/**
+ * @struct BusTuningReport
+ * @brief Result of the last autotune run.
+ */
+struct BusTuningReport {
+    uint8_t valid;                          // An autotune has completed
+    int selected_baud;                      // Baud rate the bus was left at
+    BusTuningRate rates[BUS_TUNING_RATE_COUNT];
+};
+
+/**
+ * @brief Runs the baud rate autotune on the RS485 bus.
+ *
+ * Must be called from the task that owns the bus traffic (servo_task), with
+ * no other requests outstanding. Blocks while probing.
+ *
+ * @param slave_ids The Modbus slave id of each axis.
+ * @return The selected baud rate.
+ */
+int bus_autotune(const uint8_t slave_ids[AXIS_COUNT]);
+
+/**
+ * @brief Returns the report of the last autotune run.
+ */
+const BusTuningReport& bus_tuning_report();
+
+#endif // BUS_TUNING_H
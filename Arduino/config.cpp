@@ -10,6 +10,7 @@
  */
 #include "config.h"
 #include "sd_tasks.h"
+#include "logger.h"
 #include <SD.h>
 
 Config config;
@@ -19,20 +20,22 @@ Config config;
  * @return True if the configuration was loaded successfully, false otherwise.
  */
 bool load_config_from_sd() {
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) != pdTRUE) return false;
     File configFile = SD.open("/config.json");
     if (!configFile) {
-        log_to_sd("Failed to open config file for reading");
+        xSemaphoreGive(sdMutex);
+        LOG_ERROR(LOG_CONFIG, "Failed to open config file for reading");
         return false;
     }
 
     StaticJsonDocument<2048> doc;
     DeserializationError error = deserializeJson(doc, configFile);
+    configFile.close();
+    xSemaphoreGive(sdMutex);
     if (error) {
-        log_to_sd("Failed to parse config file: " + String(error.c_str()));
-        configFile.close();
+        LOG_ERROR(LOG_CONFIG, "Failed to parse config file: %s", error.c_str());
         return false;
     }
-    configFile.close();
 
     config.WIFI_SSID        = doc["NETWORK"]["WIFI_SSID"].as<String>();
     config.WIFI_PASSWORD    = doc["NETWORK"]["WIFI_PASSWORD"].as<String>();
@@ -53,13 +56,27 @@ bool load_config_from_sd() {
     config.FLASH_SPEED = doc["LEDS"]["FLASH_SPEED"].as<int>();
     config.IDLE_DIM_PERCENT = doc["LEDS"]["IDLE_DIM_PERCENT"].as<int>();
     config.IDLE_TIMEOUT_SECONDS = doc["LEDS"]["IDLE_TIMEOUT_SECONDS"].as<int>();
+    config.LEDS.TARGET_FPS = doc["LEDS"]["TARGET_FPS"] | 40;
+    config.LEDS.GAMMA = doc["LEDS"]["GAMMA"] | 1.0f;
 
     config.SERVOY_SLAVE_ID = doc["SERVOS"]["SERVOY_SLAVE_ID"].as<int>();
     config.SERVOYY_SLAVE_ID = doc["SERVOS"]["SERVOYY_SLAVE_ID"].as<int>();
     config.SERVOX_SLAVE_ID = doc["SERVOS"]["SERVOX_SLAVE_ID"].as<int>();
+    config.SERVOS.BAUD = doc["SERVOS"]["BAUD"] | 19200;
+    strlcpy(config.SERVOS.PARITY, doc["SERVOS"]["PARITY"] | "N", sizeof(config.SERVOS.PARITY));
+    config.SERVOS.INTER_FRAME_US = doc["SERVOS"]["INTER_FRAME_US"] | 0;
+    config.SERVOS.RESPONSE_TIMEOUT_MS = doc["SERVOS"]["RESPONSE_TIMEOUT_MS"] | 30;
+    config.SERVOS.AUTOTUNE = doc["SERVOS"]["AUTOTUNE"] | false;
+    strlcpy(config.SERVOS.SERVOY_READ_ALONG, doc["SERVOS"]["SERVOY_READ_ALONG"] | "", sizeof(config.SERVOS.SERVOY_READ_ALONG));
+    strlcpy(config.SERVOS.SERVOYY_READ_ALONG, doc["SERVOS"]["SERVOYY_READ_ALONG"] | "", sizeof(config.SERVOS.SERVOYY_READ_ALONG));
+    strlcpy(config.SERVOS.SERVOX_READ_ALONG, doc["SERVOS"]["SERVOX_READ_ALONG"] | "", sizeof(config.SERVOS.SERVOX_READ_ALONG));
 
     config.RAIL_Y_LENGTH_MM = doc["SERVOS"]["RAIL_Y_LENGTH_MM"].as<int>();
     config.RAIL_X_LENGTH_MM = doc["SERVOS"]["RAIL_X_LENGTH_MM"].as<int>();
+    config.TABLE.COUNTS_PER_MM_Y = doc["TABLE"]["COUNTS_PER_MM_Y"] | 1.0f;
+    config.TABLE.COUNTS_PER_MM_X = doc["TABLE"]["COUNTS_PER_MM_X"] | 1.0f;
+    config.TABLE.SKEW_THRESHOLD_MM = doc["TABLE"]["SKEW_THRESHOLD_MM"] | 2.0f;
+    config.TABLE.SKEW_FILTER = doc["TABLE"]["SKEW_FILTER"] | 0.2f;
 
     config.SNMP_COMMUNITY = doc["SNMP"]["SNMP_COMMUNITY"].as<String>();
     config.SNMP_TRAP_COMMUNITY = doc["SNMP"]["SNMP_TRAP_COMMUNITY"].as<String>();
@@ -74,6 +91,12 @@ bool load_config_from_sd() {
 
     config.SD_MONITOR_INTERVAL      = doc["SD"]["SD_MONITOR_INTERVAL"].as<int>();
     config.SD_USAGE_THRESHOLD       = doc["SD"]["SD_USAGE_THRESHOLD"].as<int>();
+    config.SD.LOG_BINARY            = doc["SD"]["LOG_BINARY"] | false;
+    config.SD.LOG_SEGMENT_KB        = doc["SD"]["LOG_SEGMENT_KB"] | 1024;
+    config.SD.LOG_SEGMENT_HOURS     = doc["SD"]["LOG_SEGMENT_HOURS"] | 24;
+    config.SD.LOG_RETAIN_MB         = doc["SD"]["LOG_RETAIN_MB"] | 64;
+
+    strlcpy(config.SD.LOG_FILE_PATH, doc["LOG"]["LOG_FILE_PATH"] | "/system.log", sizeof(config.SD.LOG_FILE_PATH));
     
     return true;
 }
@@ -83,12 +106,6 @@ bool load_config_from_sd() {
  * @return True if the configuration was saved successfully, false otherwise.
  */
 bool save_config_to_sd() {
-    File configFile = SD.open("/config.json", FILE_WRITE);
-    if (!configFile) {
-        log_to_sd("Failed to open config file for writing");
-        return false;
-    }
-
     StaticJsonDocument<2048> doc;
     doc["NETWORK"]["WIFI_SSID"] = config.WIFI_SSID;
     doc["NETWORK"]["WIFI_PASSWORD"] = config.WIFI_PASSWORD;
@@ -109,13 +126,27 @@ bool save_config_to_sd() {
     doc["LEDS"]["FLASH_SPEED"] = config.FLASH_SPEED;
     doc["LEDS"]["IDLE_DIM_PERCENT"] = config.IDLE_DIM_PERCENT;
     doc["LEDS"]["IDLE_TIMEOUT_SECONDS"] = config.IDLE_TIMEOUT_SECONDS;
+    doc["LEDS"]["TARGET_FPS"] = config.LEDS.TARGET_FPS;
+    doc["LEDS"]["GAMMA"] = config.LEDS.GAMMA;
 
     doc["SERVOS"]["SERVOY_SLAVE_ID"] = config.SERVOY_SLAVE_ID;
     doc["SERVOS"]["SERVOYY_SLAVE_ID"] = config.SERVOYY_SLAVE_ID;
     doc["SERVOS"]["SERVOX_SLAVE_ID"] = config.SERVOX_SLAVE_ID;
+    doc["SERVOS"]["BAUD"] = config.SERVOS.BAUD;
+    doc["SERVOS"]["PARITY"] = config.SERVOS.PARITY;
+    doc["SERVOS"]["INTER_FRAME_US"] = config.SERVOS.INTER_FRAME_US;
+    doc["SERVOS"]["RESPONSE_TIMEOUT_MS"] = config.SERVOS.RESPONSE_TIMEOUT_MS;
+    doc["SERVOS"]["AUTOTUNE"] = config.SERVOS.AUTOTUNE;
+    doc["SERVOS"]["SERVOY_READ_ALONG"] = config.SERVOS.SERVOY_READ_ALONG;
+    doc["SERVOS"]["SERVOYY_READ_ALONG"] = config.SERVOS.SERVOYY_READ_ALONG;
+    doc["SERVOS"]["SERVOX_READ_ALONG"] = config.SERVOS.SERVOX_READ_ALONG;
 
     doc["SERVOS"]["RAIL_Y_LENGTH_MM"] = config.RAIL_Y_LENGTH_MM;
     doc["SERVOS"]["RAIL_X_LENGTH_MM"] = config.RAIL_X_LENGTH_MM;
+    doc["TABLE"]["COUNTS_PER_MM_Y"] = config.TABLE.COUNTS_PER_MM_Y;
+    doc["TABLE"]["COUNTS_PER_MM_X"] = config.TABLE.COUNTS_PER_MM_X;
+    doc["TABLE"]["SKEW_THRESHOLD_MM"] = config.TABLE.SKEW_THRESHOLD_MM;
+    doc["TABLE"]["SKEW_FILTER"] = config.TABLE.SKEW_FILTER;
 
 
     doc["SNMP"]["SNMP_COMMUNITY"] = config.SNMP_COMMUNITY;
@@ -131,9 +162,22 @@ bool save_config_to_sd() {
 
     doc["SD"]["SD_MONITOR_INTERVAL"] = config.SD_MONITOR_INTERVAL;
     doc["SD"]["SD_USAGE_THRESHOLD"] = config.SD_USAGE_THRESHOLD;
+    doc["SD"]["LOG_BINARY"] = config.SD.LOG_BINARY;
+    doc["SD"]["LOG_SEGMENT_KB"] = config.SD.LOG_SEGMENT_KB;
+    doc["SD"]["LOG_SEGMENT_HOURS"] = config.SD.LOG_SEGMENT_HOURS;
+    doc["SD"]["LOG_RETAIN_MB"] = config.SD.LOG_RETAIN_MB;
 
+    doc["LOG"]["LOG_FILE_PATH"] = config.SD.LOG_FILE_PATH;
 
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) != pdTRUE) return false;
+    File configFile = SD.open("/config.json", FILE_WRITE);
+    if (!configFile) {
+        xSemaphoreGive(sdMutex);
+        LOG_ERROR(LOG_CONFIG, "Failed to open config file for writing");
+        return false;
+    }
     serializeJson(doc, configFile);
     configFile.close();
+    xSemaphoreGive(sdMutex);
     return true;
 }
@@ -31,6 +31,10 @@ struct Config {
         char LOG_FILE_PATH[64];
         int SD_MONITOR_INTERVAL;
         int SD_USAGE_THRESHOLD;
+        bool LOG_BINARY;            // Log in the compact binary format (log_codec.h), .bin segments
+        int LOG_SEGMENT_KB;         // Start a new log segment at this size, 0 for no limit
+        int LOG_SEGMENT_HOURS;      // ... or after this long, 0 for no limit
+        int LOG_RETAIN_MB;          // Delete the oldest segments beyond this total size, 0 for no limit
     } SD;
     struct PIN {
         int LEDY_PIN;
@@ -58,6 +62,9 @@ struct Config {
 
         int LED_IDLE_SERVO_DIM;
         int LED_IDLE_SERVO_SECONDS;
+
+        int TARGET_FPS;     // LED task frame rate; a 700 LED strip caps this near 45
+        float GAMMA;        // Output gamma, 1.0 for linear
     } LEDS;
 
     // Network settings
@@ -96,6 +103,12 @@ struct Config {
         int RAIL_Y_LENGTH;
         int RAIL_X_LENGTH;
         int RAIL_Z_LENGTH;
+
+        float COUNTS_PER_MM_Y;  // Servo encoder counts per millimeter of travel
+        float COUNTS_PER_MM_X;
+
+        float SKEW_THRESHOLD_MM;    // Y/YY racking error that raises the skew alarm, 0 to disable
+        float SKEW_FILTER;          // Weight of a new sample in the filtered skew (0-1]
     } TABLE;
 
     // Servo settings
@@ -103,6 +116,17 @@ struct Config {
         int SERVOY_SLAVE_ID;
         int SERVOYY_SLAVE_ID;
         int SERVOX_SLAVE_ID;
+
+        int BAUD;                   // RS485 bus baud rate
+        char PARITY[2];             // "N", "E" or "O"
+        int INTER_FRAME_US;         // Silent time between frames, 0 for 3.5 characters
+        int RESPONSE_TIMEOUT_MS;    // Time a servo has to answer a request
+        bool AUTOTUNE;              // Probe for the fastest reliable baud rate at boot
+        // Registers each drive answers, "first-last" or "" for none; status and
+        // position are read in one request across them, e.g. "10-21"
+        char SERVOY_READ_ALONG[16];
+        char SERVOYY_READ_ALONG[16];
+        char SERVOX_READ_ALONG[16];
     } SERVOS;
 
 
@@ -20,7 +20,6 @@
 #include <ArduinoJson.h>
 #include <esp_task_wdt.h>
 #include <Espalexa.h>
-#include <ModbusMaster.h>
 #include <Wire.h>
 #include <TCA9554.h>
 #include <esp_sleep.h>
@@ -35,19 +34,20 @@
 #include "buzzer.h"
 #include "networking.h"
 #include "led_tasks.h"
+#include "led_output.h"
+#include "framebuffer.h"
+#include "telemetry.h"
 #include "servo_tasks.h"
 #include "webserver_task.h"
 #include "snmp_tasks.h"
 #include "sd_tasks.h"
+#include "logger.h"
 #include "ssh_tasks.h"
 
 // Global objects
 CRGB* ledsY;
 CRGB* ledsYY;
 CRGB* ledsX;
-ModbusMaster nodeY;
-ModbusMaster nodeYY;
-ModbusMaster nodeX;
 TCA9554 tca9554;
 Espalexa alexa;
 AsyncWebServer server(80);
@@ -88,9 +88,11 @@ void shutdownCallback(uint8_t brightness) {
 void chasingPurpleCallback(uint8_t brightness) {
     if (brightness > 0) {
         // Signal LED task to start chasing purple effect
-        // (Implementation requires FreeRTOS queues or events)
+        EffectParams params = {CRGB::Purple, config.LEDS.CHASE_SPEED, 0};
+        led_request_effect("chasing", params);
     } else {
         // Signal LED task to stop chasing effect
+        led_request_effect(NULL, EffectParams());
     }
 }
 
@@ -100,17 +102,21 @@ void shutdown_arduino() {
     beep(BUZZER_PIN, 2);
     crossfade_to_blue(5000); // Cross fade LED strips to blue over 5 seconds
     delay(1000); // Give a small delay after the animation
+    sd_log_flush(pdMS_TO_TICKS(1000)); // Write out the queued log messages
     ESP.restart();
 }
 
 void setup() {
+    sd_mutex_init(); // Before anything touches the card
     Serial.begin(115200);
     beep(BUZZER_PIN, 2); // Beep twice on power-up
 
     esp_reset_reason_t reason = esp_reset_reason();
     if (reason != ESP_RST_SW && reason != ESP_RST_WDT && reason != ESP_RST_DEEPSLEEP) {
-        snmp_trap_send("Arduino Restarted. Reason: " + String(reason));
-        log_to_sd("Arduino restarted. Reason: " + String(reason));
+        char trap[48];
+        snprintf(trap, sizeof(trap), "Arduino Restarted. Reason: %d", (int)reason);
+        snmp_trap_send(trap);
+        LOG_WARN(LOG_SYSTEM, "Arduino restarted. Reason: %d", (int)reason);
     }
 
     Wire.begin(I2C_SDA, I2C_SCL);
@@ -128,6 +134,7 @@ void setup() {
         delay(5 * 60 * 1000);
         ESP.restart();
     }
+    sd_init_tasks(); // Start the SD log writer
     snmp_trap_send("SD Card Loaded");
     beep(BUZZER_PIN, 1);
 
@@ -139,12 +146,22 @@ void setup() {
     snmp_trap_send("Config Loaded");
     beep(BUZZER_PIN, 1);
 
-    ledsY = new CRGB[config.LEDS_Y_COUNT];
-    ledsYY = new CRGB[config.LEDS_YY_COUNT];
-    ledsX = new CRGB[config.LEDS_X_COUNT];
-    FastLED.addLeds<WS2815, LEDY_PIN, GRB>(ledsY, config.LEDS_Y_COUNT).setCorrection(TypicalSMD5050);
-    FastLED.addLeds<WS2815, LEDYY_PIN, GRB>(ledsYY, config.LEDS_YY_COUNT).setCorrection(TypicalSMD5050);
-    FastLED.addLeds<WS2815, LEDX_PIN, GRB>(ledsX, config.LEDS_X_COUNT).setCorrection(TypicalSMD5050);
+    int led_counts[LED_STRIP_COUNT] = {config.LEDS.LEDS_Y_COUNT, config.LEDS.LEDS_YY_COUNT, config.LEDS.LEDS_X_COUNT};
+    if (!framebuffer_init(led_counts)) {
+        // Without framebuffers the strips cannot show anything; report it only
+        snmp_trap_send("LED Framebuffer Allocation Failed");
+        LOG_ERROR(LOG_SYSTEM, "LED framebuffer allocation failed, restarting in 5 minutes");
+        beep(BUZZER_PIN, 3);
+        delay(5 * 60 * 1000);
+        ESP.restart();
+    }
+    ledsY = framebuffer_get(0, FB_SCENE);
+    ledsYY = framebuffer_get(1, FB_SCENE);
+    ledsX = framebuffer_get(2, FB_SCENE);
+    if (!led_output_init(led_counts)) {
+        snmp_trap_send("LED Output Initialization Failed");
+    }
+    telemetry_init();
 
     alexa.addDevice("LEDY Brightness", ledYBrightnessCallback, EspalexaDeviceType::dimmable);
     alexa.addDevice("LEDYY Brightness", ledYYBrightnessCallback, EspalexaDeviceType::dimmable);
@@ -0,0 +1,59 @@
+/**
+ * @file frame_scheduler.cpp
+ * @brief Implementation of the fixed-rate frame scheduler.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Frame work time is measured with the microsecond esp_timer, while pacing
+ * uses FreeRTOS ticks so the task sleeps between frames.
+ */
+#include "frame_scheduler.h"
+#include "version.h"
+#include <esp_timer.h>
+
+void FrameScheduler::begin(int target_fps) {
+    if (target_fps < 1) target_fps = 1;
+    period_ticks = pdMS_TO_TICKS(1000 / target_fps);
+    if (period_ticks == 0) period_ticks = 1;
+    frame_period_ms = period_ticks * portTICK_PERIOD_MS;
+
+    last_wake = xTaskGetTickCount();
+    start_ms = millis();
+    fps_window_start_ms = start_ms;
+    fps_window_frames = 0;
+    frame_stats = {};
+}
+
+uint32_t FrameScheduler::frame_start() {
+    work_start_us = esp_timer_get_time();
+    return millis() - start_ms;
+}
+
+void FrameScheduler::frame_end() {
+    uint32_t work_us = (uint32_t)(esp_timer_get_time() - work_start_us);
+
+    frame_stats.frames++;
+    frame_stats.last_frame_us = work_us;
+    if (work_us > frame_stats.max_frame_us) {
+        frame_stats.max_frame_us = work_us;
+    }
+    // EMA with a 1/16 weight for the newest frame
+    frame_stats.avg_frame_us = frame_stats.frames == 1
+        ? work_us
+        : frame_stats.avg_frame_us - (frame_stats.avg_frame_us >> 4) + (work_us >> 4);
+
+    uint32_t now_ms = millis();
+    fps_window_frames++;
+    if (now_ms - fps_window_start_ms >= 1000) {
+        frame_stats.achieved_fps = fps_window_frames * 1000.0f / (now_ms - fps_window_start_ms);
+        fps_window_start_ms = now_ms;
+        fps_window_frames = 0;
+    }
+
+    // xTaskDelayUntil returns pdFALSE when the deadline had already passed
+    if (xTaskDelayUntil(&last_wake, period_ticks) == pdFALSE) {
+        frame_stats.missed_deadlines++;
+        last_wake = xTaskGetTickCount();
+    }
+}
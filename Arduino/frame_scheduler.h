@@ -0,0 +1,85 @@
+/**
+ * @file frame_scheduler.h
+ * @brief Fixed-rate frame pacing with deadline and frame-time statistics.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The frame scheduler wakes a task at a fixed rate (vTaskDelayUntil style)
+ * instead of sleeping a fixed time after the work is done. It counts missed
+ * deadlines and keeps frame-time statistics so the achieved frame rate can be
+ * checked from the web interface.
+ */
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include "version.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @struct FrameStats
+ * @brief Frame pacing statistics since the scheduler was started.
+ */
+struct FrameStats {
+    uint32_t frames;            // Frames completed
+    uint32_t missed_deadlines;  // Frames whose work overran the frame period
+    uint32_t last_frame_us;     // Work time of the last frame
+    uint32_t max_frame_us;      // Longest work time seen
+    uint32_t avg_frame_us;      // Exponential moving average of the work time
+    float achieved_fps;         // Frames per second over the last second
+};
+
+/**
+ * @class FrameScheduler
+ * @brief Paces a render loop at a fixed target frame rate.
+ */
+class FrameScheduler {
+public:
+    /**
+     * @brief Starts pacing at the given rate.
+     *
+     * @param target_fps Target frames per second (clamped to 1..1000/tick).
+     */
+    void begin(int target_fps);
+
+    /**
+     * @brief Marks the start of a frame's work.
+     *
+     * @return Milliseconds since `begin()`, to be used as the render time.
+     */
+    uint32_t frame_start();
+
+    /**
+     * @brief Records the frame's work time and sleeps until the next deadline.
+     *
+     * A frame that overruns its period is counted as missed and the schedule
+     * is re-anchored instead of bursting to catch up.
+     */
+    void frame_end();
+
+    /**
+     * @brief Returns a copy of the current statistics.
+     */
+    FrameStats stats() const { return frame_stats; }
+
+    /**
+     * @brief Returns the frame period in milliseconds.
+     */
+    uint32_t period_ms() const { return frame_period_ms; }
+
+private:
+    TickType_t last_wake = 0;
+    TickType_t period_ticks = 1;
+    uint32_t frame_period_ms = 0;
+    uint32_t start_ms = 0;
+    int64_t work_start_us = 0;
+
+    uint32_t fps_window_start_ms = 0;
+    uint32_t fps_window_frames = 0;
+
+    FrameStats frame_stats = {};
+};
+
+#endif // FRAME_SCHEDULER_H
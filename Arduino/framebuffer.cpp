@@ -0,0 +1,113 @@
+/**
+ * @file framebuffer.cpp
+ * @brief Implementation of the LED framebuffer manager.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Buffers are allocated with heap_caps_malloc so their placement is explicit.
+ * PSRAM cannot be read while the flash cache is disabled, so anything the RMT
+ * interrupt reads stays in internal RAM.
+ */
+#include "framebuffer.h"
+#include "version.h"
+#include "sd_tasks.h"
+#include "logger.h"
+#include <esp_heap_caps.h>
+#include <string.h>
+
+static CRGB* buffers[LED_STRIP_COUNT][FB_KIND_COUNT];
+static int lengths[LED_STRIP_COUNT];
+static FrameBufferFootprint footprint = {0, 0};
+
+/**
+ * @brief Allocates a buffer in PSRAM if preferred and available, else internal RAM.
+ */
+static CRGB* allocate_buffer(int num_leds, bool prefer_psram) {
+    size_t size = num_leds * sizeof(CRGB);
+    void* buffer = NULL;
+
+#ifdef BOARD_HAS_PSRAM
+    if (prefer_psram) {
+        buffer = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (buffer != NULL) {
+            footprint.psram_bytes += size;
+        }
+    }
+#endif
+
+    if (buffer == NULL) {
+        buffer = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buffer != NULL) {
+            footprint.internal_bytes += size;
+        }
+    }
+
+    if (buffer != NULL) {
+        memset(buffer, 0, size);
+    }
+    return (CRGB*)buffer;
+}
+
+/**
+ * @brief Frees every allocated buffer, after a failed init.
+ */
+static void free_buffers() {
+    for (int s = 0; s < LED_STRIP_COUNT; s++) {
+        for (int kind = 0; kind < FB_KIND_COUNT; kind++) {
+            heap_caps_free(buffers[s][kind]);
+            buffers[s][kind] = NULL;
+        }
+    }
+    footprint = {0, 0};
+}
+
+/**
+ * @brief Allocates every framebuffer for the configured strip lengths.
+ */
+bool framebuffer_init(const int counts[LED_STRIP_COUNT]) {
+    for (int s = 0; s < LED_STRIP_COUNT; s++) {
+        lengths[s] = counts[s];
+        for (int kind = 0; kind < FB_KIND_COUNT; kind++) {
+            buffers[s][kind] = allocate_buffer(counts[s], kind == FB_SNAPSHOT || kind == FB_TARGET);
+            if (buffers[s][kind] == NULL) {
+                LOG_ERROR(LOG_LED, "Framebuffer allocation failed for strip %d", s);
+                free_buffers();
+                return false;
+            }
+        }
+    }
+
+    LOG_INFO(LOG_LED, "Framebuffers allocated: %u bytes internal, %u bytes PSRAM",
+             (unsigned)footprint.internal_bytes, (unsigned)footprint.psram_bytes);
+    return true;
+}
+
+/**
+ * @brief Returns one of a strip's buffers.
+ */
+CRGB* framebuffer_get(int strip, FrameBufferKind kind) {
+    return buffers[strip][kind];
+}
+
+/**
+ * @brief Returns the number of LEDs on a strip.
+ */
+int framebuffer_length(int strip) {
+    return lengths[strip];
+}
+
+/**
+ * @brief Copies one of a strip's buffers into its snapshot buffer.
+ */
+CRGB* framebuffer_snapshot(int strip, FrameBufferKind source) {
+    memcpy(buffers[strip][FB_SNAPSHOT], buffers[strip][source], lengths[strip] * sizeof(CRGB));
+    return buffers[strip][FB_SNAPSHOT];
+}
+
+/**
+ * @brief Returns how much internal RAM and PSRAM the framebuffers use.
+ */
+FrameBufferFootprint framebuffer_footprint() {
+    return footprint;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file framebuffer.h
+ * @brief Framebuffer manager for the LED strips.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * All per-strip pixel buffers are sized from the loaded configuration once at
+ * boot and placed by access frequency: buffers touched every frame (or read by
+ * the RMT interrupt) live in internal RAM, rarely used snapshots go to PSRAM
+ * when the board has it (`BOARD_HAS_PSRAM`). Nothing is allocated on a task
+ * stack or after boot.
+ */
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "version.h"
+#include "led_output.h"
+#include <FastLED.h>
+
+/**
+ * @enum FrameBufferKind
+ * @brief The buffers kept for every strip.
+ */
+enum FrameBufferKind {
+    FB_SCENE,       // Composited frame (ledsY/ledsYY/ledsX), every frame
+    FB_BASE,        // Compositor base layer, every frame
+    FB_FRONT,       // Output buffer pair, read by the RMT ISR; the output
+    FB_BACK,        // driver swaps their roles every submitted frame
+    FB_SNAPSHOT,    // Copy of the scene for crossfades, rarely used
+    FB_TARGET,      // Target frame of a crossfade, rarely used
+    FB_KIND_COUNT
+};
+
+/**
+ * @struct FrameBufferFootprint
+ * @brief Memory used by the framebuffers.
+ */
+struct FrameBufferFootprint {
+    size_t internal_bytes;
+    size_t psram_bytes;
+};
+
+/**
+ * @brief Allocates every framebuffer for the configured strip lengths.
+ *
+ * Must be called once at boot, before the LED output driver and task start.
+ *
+ * @param counts The number of LEDs on each strip.
+ * @return True if every buffer was allocated; on failure none is kept and
+ *         framebuffer_get() returns NULL.
+ */
+bool framebuffer_init(const int counts[LED_STRIP_COUNT]);
+
+/**
+ * @brief Returns one of a strip's buffers.
+ *
+ * @param strip The strip index (0=Y, 1=YY, 2=X).
+ * @param kind Which buffer to return.
+ */
+CRGB* framebuffer_get(int strip, FrameBufferKind kind);
+
+/**
+ * @brief Returns the number of LEDs on a strip.
+ */
+int framebuffer_length(int strip);
+
+/**
+ * @brief Copies one of a strip's buffers into its snapshot buffer.
+ *
+ * @param strip The strip index (0=Y, 1=YY, 2=X).
+ * @param source The buffer to copy, the composited scene by default.
+ * @return The snapshot buffer.
+ */
+CRGB* framebuffer_snapshot(int strip, FrameBufferKind source = FB_SCENE);
+
+/**
+ * @brief Returns how much internal RAM and PSRAM the framebuffers use.
+ */
+FrameBufferFootprint framebuffer_footprint();
+
+#endif // FRAMEBUFFER_H
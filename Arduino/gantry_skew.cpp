@@ -0,0 +1,55 @@
+/**
+ * @file gantry_skew.cpp
+ * @brief Implementation of the Y/YY gantry skew monitor.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "gantry_skew.h"
+#include "version.h"
+
+void SkewMonitor::configure(float counts_per_mm, float threshold_mm, float filter) {
+    this->counts_per_mm = counts_per_mm > 0.0f ? counts_per_mm : 1.0f;
+    this->threshold_mm = threshold_mm;
+    this->filter = (filter > 0.0f && filter <= 1.0f) ? filter : 1.0f;
+}
+
+bool SkewMonitor::update(int32_t y, uint32_t y_ms, int32_t yy, uint32_t yy_ms) {
+    float error_mm = (float)((int64_t)y - yy) / counts_per_mm;
+    uint32_t spread_ms = y_ms > yy_ms ? y_ms - yy_ms : yy_ms - y_ms;
+
+    if (skew_stats.pairs == 0) {
+        skew_stats.filtered_mm = error_mm;
+        skew_stats.min_mm = error_mm;
+        skew_stats.max_mm = error_mm;
+    } else {
+        skew_stats.filtered_mm += filter * (error_mm - skew_stats.filtered_mm);
+        if (error_mm < skew_stats.min_mm) skew_stats.min_mm = error_mm;
+        if (error_mm > skew_stats.max_mm) skew_stats.max_mm = error_mm;
+    }
+    skew_stats.error_mm = error_mm;
+    skew_stats.pairs++;
+    if (spread_ms > skew_stats.max_pair_spread_ms) skew_stats.max_pair_spread_ms = spread_ms;
+
+    float magnitude = error_mm < 0.0f ? -error_mm : error_mm;
+    float filtered_magnitude = skew_stats.filtered_mm < 0.0f ? -skew_stats.filtered_mm : skew_stats.filtered_mm;
+
+    if (threshold_mm > 0.0f) {
+        int bin = (int)(magnitude * SKEW_HISTOGRAM_BINS / (2.0f * threshold_mm));
+        if (bin >= SKEW_HISTOGRAM_BINS) bin = SKEW_HISTOGRAM_BINS - 1;
+        skew_stats.histogram[bin]++;
+    }
+
+    // Raise on the instantaneous error (one cycle latency), clear on the
+    // filtered error with hysteresis so noise cannot toggle the alarm
+    if (threshold_mm <= 0.0f) {
+        skew_stats.alarm = 0;
+    } else if (!skew_stats.alarm && magnitude > threshold_mm) {
+        skew_stats.alarm = 1;
+        skew_stats.alarms++;
+        return true;
+    } else if (skew_stats.alarm && magnitude < threshold_mm && filtered_magnitude < threshold_mm * 0.8f) {
+        skew_stats.alarm = 0;
+    }
+    return false;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file gantry_skew.h
+ * @brief Racking (skew) monitor for the ganged Y/YY gantry pair.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The servo task reads the Y and YY positions back to back in the same poll
+ * cycle and hands each pair to the monitor. The monitor converts the position
+ * difference to millimeters, filters it, keeps min/max and a histogram, and
+ * raises an alarm as soon as one pair exceeds the configured threshold, so the
+ * detection latency is at most one poll cycle. The alarm clears once the
+ * filtered error has dropped back below 80 % of the threshold.
+ */
+#ifndef GANTRY_SKEW_H
+#define GANTRY_SKEW_H
+
+#include "version.h"
+#include <stdint.h>
+
+// Histogram of |error| from 0 to twice the threshold; the last bin also
+// counts everything above
+#define SKEW_HISTOGRAM_BINS     16
+
+/**
+ * @struct SkewStats
+ * @brief Gantry skew statistics since boot.
+ */
+struct SkewStats {
+    float error_mm;                         // Last instantaneous Y - YY error
+    float filtered_mm;                      // Exponentially filtered error
+    float min_mm;                           // Most negative instantaneous error
+    float max_mm;                           // Most positive instantaneous error
+    uint32_t pairs;                         // Sample pairs evaluated
+    uint32_t max_pair_spread_ms;            // Largest time between the two samples of a pair
+    uint32_t alarms;                        // Times the alarm was raised
+    uint8_t alarm;                          // Alarm currently active
+    uint32_t histogram[SKEW_HISTOGRAM_BINS];
+};
+
+/**
+ * @class SkewMonitor
+ * @brief Evaluates paired Y/YY samples against the skew threshold.
+ */
+class SkewMonitor {
+public:
+    /**
+     * @brief Sets the scale, threshold and filter.
+     *
+     * @param counts_per_mm Encoder counts per millimeter of Y travel.
+     * @param threshold_mm Error that raises the alarm, <= 0 to disable it.
+     * @param filter Weight of a new sample in the filtered error (0-1].
+     */
+    void configure(float counts_per_mm, float threshold_mm, float filter);
+
+    /**
+     * @brief Evaluates one pair of samples taken in the same poll cycle.
+     *
+     * The caller brings both positions to the same time first; the
+     * timestamps only feed the pair spread statistics.
+     *
+     * @param y The Y position in counts.
+     * @param y_ms When the Y position was received.
+     * @param yy The YY position in counts.
+     * @param yy_ms When the YY position was received.
+     * @return True if this pair raised the alarm.
+     */
+    bool update(int32_t y, uint32_t y_ms, int32_t yy, uint32_t yy_ms);
+
+    bool alarm() const { return skew_stats.alarm; }
+
+    /**
+     * @brief Returns a copy of the statistics.
+     */
+    SkewStats stats() const { return skew_stats; }
+
+private:
+    float counts_per_mm = 1.0f;
+    float threshold_mm = 0.0f;
+    float filter = 0.2f;
+
+    SkewStats skew_stats = {};
+};
+
+#endif // GANTRY_SKEW_H
@@ -0,0 +1,43 @@
+/**
+ * @file led_blend.cpp
+ * @brief Implementation of the fixed-point blend kernel.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The kernel computes (from * (256 - w) + to * w) >> 8 in 16-bit lanes. With a
+ * weight of 256 the result is exactly `to`, so a fade always lands on its
+ * target. Keeping the loop free of branches and per-pixel structure lets GCC
+ * auto-vectorize it (the ESP32-S3 PIE unit works on 16-byte vectors).
+ *
+ * The firmware builds at -Os, which does not vectorize, and -O2's cheap cost
+ * model will not add the runtime check that `dst` does not partly overlap
+ * the inputs. The kernel therefore asks for the vectorizer with the dynamic
+ * cost model itself; tools/led_bench fails if it is not faster than blend().
+ */
+#include "led_blend.h"
+#include "version.h"
+
+#define BLEND_VECTORIZE __attribute__((optimize("O2", "tree-vectorize", "vect-cost-model=dynamic")))
+
+uint16_t blend_weight_q8(uint32_t elapsed, uint32_t duration) {
+    if (duration == 0 || elapsed >= duration) return 256;
+    return (uint16_t)(((uint64_t)elapsed << 8) / duration);
+}
+
+BLEND_VECTORIZE
+void blend_bytes_q8(uint8_t* dst, const uint8_t* from, const uint8_t* to, size_t num_bytes, uint16_t weight) {
+    if (weight > 256) weight = 256;
+    uint16_t inverse = 256 - weight;
+
+    for (size_t i = 0; i < num_bytes; i++) {
+        // Both products and their sum fit in 16 bits (at most 255 * 256)
+        uint16_t sum = (uint16_t)(from[i] * inverse) + (uint16_t)(to[i] * weight);
+        dst[i] = (uint8_t)(sum >> 8);
+    }
+}
+
+void crossfade_frame(CRGB* dst, const CRGB* from, const CRGB* to, int num_leds, uint16_t weight) {
+    if (num_leds <= 0) return;
+    blend_bytes_q8((uint8_t*)dst, (const uint8_t*)from, (const uint8_t*)to, num_leds * sizeof(CRGB), weight);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file led_blend.h
+ * @brief Fixed-point blend kernel for crossfades between LED frames.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Blends whole frames as flat byte arrays with a Q8 weight, so the inner loop
+ * is a straight multiply-add over bytes that the compiler can unroll and
+ * vectorize, instead of a float-to-int conversion per pixel.
+ */
+#ifndef LED_BLEND_H
+#define LED_BLEND_H
+
+#include "version.h"
+#include <FastLED.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Q8 weight of `elapsed` within `duration`: 0 at the start, 256 at the end.
+ */
+uint16_t blend_weight_q8(uint32_t elapsed, uint32_t duration);
+
+/**
+ * @brief Blends two byte arrays: dst = from + (to - from) * weight / 256.
+ *
+ * `dst` may be the same array as `from` or `to`.
+ *
+ * @param dst Output bytes.
+ * @param from Bytes at weight 0.
+ * @param to Bytes at weight 256.
+ * @param num_bytes Number of bytes to blend.
+ * @param weight Q8 weight, 0..256.
+ */
+void blend_bytes_q8(uint8_t* dst, const uint8_t* from, const uint8_t* to, size_t num_bytes, uint16_t weight);
+
+/**
+ * @brief Crossfades a whole LED frame between two frames.
+ *
+ * @param dst Output frame (may alias `from` or `to`).
+ * @param from Frame at weight 0.
+ * @param to Frame at weight 256.
+ * @param num_leds Number of LEDs in each frame.
+ * @param weight Q8 weight, 0..256.
+ */
+void crossfade_frame(CRGB* dst, const CRGB* from, const CRGB* to, int num_leds, uint16_t weight);
+
+#endif // LED_BLEND_H
@@ -0,0 +1,167 @@
+/**
+ * @file led_compositor.cpp
+ * @brief Implementation of the layered, dirty-region LED compositor.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Layers are applied bottom to top: base, fault alarm, limit alarm, then the
+ * position marker. Only dirty spans are recomposited, and each recomposited
+ * pixel is compared against the output buffer so unchanged frames are never
+ * re-transmitted. The marker is positioned in 1/256 LED steps and its edge
+ * pixels are blended by coverage, so it glides instead of jumping.
+ */
+#include "led_compositor.h"
+#include "version.h"
+#include "led_blend.h"
+
+/**
+ * @brief Grows the span to also cover [from, to).
+ */
+void LedSpan::include(int from, int to) {
+    if (from >= to) return;
+    if (empty()) {
+        start = from;
+        end = to;
+        return;
+    }
+    if (from < start) start = from;
+    if (to > end) end = to;
+}
+
+void LedCompositor::begin(int num_leds, CRGB* base, CRGB* output) {
+    this->num_leds = num_leds;
+    this->base = base;
+    this->output = output;
+    invalidate();
+}
+
+void LedCompositor::mark_dirty(int start, int end) {
+    if (start < 0) start = 0;
+    if (end > num_leds) end = num_leds;
+    dirty.include(start, end);
+}
+
+void LedCompositor::invalidate() {
+    mark_dirty(0, num_leds);
+}
+
+void LedCompositor::touch_base(int start, int end) {
+    mark_dirty(start, end);
+}
+
+void LedCompositor::fill_base(const CRGB& color) {
+    fill_solid(base, num_leds, color);
+    mark_dirty(0, num_leds);
+}
+
+void LedCompositor::set_fault_alarm(bool active, bool flash_on) {
+    bool now_on = active && flash_on;
+    if (now_on != fault_on) {
+        mark_dirty(0, num_leds);
+        fault_on = now_on;
+    }
+}
+
+void LedCompositor::set_limit_alarm(bool min_limit, bool max_limit, bool flash_on) {
+    // Only the end zones that are actually lit (or were lit) need recompositing
+    bool was_min = this->min_limit && this->flash_on;
+    bool was_max = this->max_limit && this->flash_on;
+    bool now_min = min_limit && flash_on;
+    bool now_max = max_limit && flash_on;
+
+    if (was_min != now_min) {
+        mark_dirty(0, LIMIT_ALARM_LEDS);
+    }
+    if (was_max != now_max) {
+        mark_dirty(num_leds - LIMIT_ALARM_LEDS, num_leds);
+    }
+
+    this->min_limit = min_limit;
+    this->max_limit = max_limit;
+    this->flash_on = flash_on;
+}
+
+int32_t counts_to_led_q8(int32_t counts, int num_leds, int64_t counts_per_rail) {
+    if (counts_per_rail <= 0 || num_leds <= 0) return -1;
+
+    // 64-bit so raw encoder counts times the strip length cannot overflow
+    int64_t led_q8 = ((int64_t)counts * num_leds * 256) / counts_per_rail;
+    int64_t last_q8 = (int64_t)(num_leds - 1) * 256;
+    if (led_q8 < 0) led_q8 = 0;
+    if (led_q8 > last_q8) led_q8 = last_q8;
+    return (int32_t)led_q8;
+}
+
+LedSpan LedCompositor::marker_span() const {
+    LedSpan span = {0, 0};
+    if (marker_center_q8 < 0) return span;
+
+    // The marker covers [center - half_width, center + half_width + 1) in LED units
+    int32_t start_q8 = marker_center_q8 - marker_half_width * 256;
+    int32_t end_q8 = marker_center_q8 + (marker_half_width + 1) * 256;
+    span.start = max(0, (int)(start_q8 >> 8));
+    span.end = min(num_leds, (int)((end_q8 + 255) >> 8));
+    return span;
+}
+
+uint16_t LedCompositor::marker_coverage(int i) const {
+    int32_t start_q8 = marker_center_q8 - marker_half_width * 256;
+    int32_t end_q8 = marker_center_q8 + (marker_half_width + 1) * 256;
+    int32_t pixel_start = i * 256;
+    int32_t overlap = min(end_q8, pixel_start + 256) - max(start_q8, pixel_start);
+    return overlap > 0 ? (uint16_t)overlap : 0;
+}
+
+void LedCompositor::set_marker(int center, int half_width, const CRGB& color) {
+    set_marker_q8(center < 0 ? -1 : center * 256, half_width, color);
+}
+
+void LedCompositor::set_marker_q8(int32_t center_q8, int half_width, const CRGB& color) {
+    if (center_q8 == marker_center_q8 && half_width == marker_half_width && color == marker_color) return;
+
+    // Restore the old span and draw the new one, nothing in between
+    LedSpan old_span = marker_span();
+    mark_dirty(old_span.start, old_span.end);
+
+    marker_center_q8 = center_q8;
+    marker_half_width = half_width;
+    marker_color = color;
+
+    LedSpan new_span = marker_span();
+    mark_dirty(new_span.start, new_span.end);
+}
+
+bool LedCompositor::render() {
+    changed.clear();
+    if (dirty.empty()) return false;
+
+    LedSpan marker = marker_span();
+    bool min_on = min_limit && flash_on;
+    bool max_on = max_limit && flash_on;
+    int max_zone_start = num_leds - LIMIT_ALARM_LEDS;
+
+    for (int i = dirty.start; i < dirty.end; i++) {
+        CRGB pixel;
+        if ((min_on && i < LIMIT_ALARM_LEDS) || (max_on && i >= max_zone_start)) {
+            pixel = CRGB::Red;
+        } else if (fault_on) {
+            pixel = FAULT_ALARM_COLOR;
+        } else {
+            pixel = base[i];
+        }
+
+        // Marker edge pixels are blended with what lies underneath by coverage
+        if (i >= marker.start && i < marker.end) {
+            crossfade_frame(&pixel, &pixel, &marker_color, 1, marker_coverage(i));
+        }
+
+        if (output[i] != pixel) {
+            output[i] = pixel;
+            changed.include(i, i + 1);
+        }
+    }
+
+    dirty.clear();
+    return !changed.empty();
+}
@@ -0,0 +1,165 @@
+/**
+ * @file led_compositor.h
+ * @brief Layered, dirty-region compositor for the WS2815 axis strips.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Each strip is built from a base layer, a fault-alarm layer, a limit-alarm
+ * layer and a position-marker layer. Brightness and idle dimming are applied
+ * afterwards by the output lookup tables (led_lut.h). Every layer records the span of LEDs it has
+ * touched since the last frame, and only that span is recomposited. A strip
+ * only needs to be re-transmitted when its composited output actually changed,
+ * so idle frames cost close to no CPU and no wire time.
+ */
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include "version.h"
+#include <FastLED.h>
+
+// Number of LEDs at each end of a strip used for the limit switch alarm
+#define LIMIT_ALARM_LEDS    20
+
+// Color of the whole-strip fault alarm, distinct from the red limit alarm
+#define FAULT_ALARM_COLOR   CRGB::Magenta
+
+/**
+ * @struct LedSpan
+ * @brief Half-open range [start, end) of LED indices. Empty when start >= end.
+ */
+struct LedSpan {
+    int start;
+    int end;
+
+    bool empty() const { return start >= end; }
+    void clear() { start = 0; end = 0; }
+    void include(int from, int to);
+};
+
+/**
+ * @class LedCompositor
+ * @brief Composites the layers of one LED strip into its output buffer.
+ */
+class LedCompositor {
+public:
+    /**
+     * @brief Binds the compositor to a strip.
+     *
+     * @param num_leds The number of LEDs in the strip.
+     * @param base Buffer for the base layer (num_leds entries, owned by the caller).
+     * @param output Buffer that is transmitted to the strip (num_leds entries).
+     */
+    void begin(int num_leds, CRGB* base, CRGB* output);
+
+    /**
+     * @brief Gives direct access to the base layer for effects.
+     *
+     * Callers must report what they changed with `touch_base()`.
+     */
+    CRGB* base_layer() { return base; }
+
+    /**
+     * @brief Marks a span of the base layer as modified.
+     */
+    void touch_base(int start, int end);
+
+    /**
+     * @brief Fills the whole base layer with one color.
+     */
+    void fill_base(const CRGB& color);
+
+    /**
+     * @brief Sets the state of the whole-strip fault alarm layer (e.g. gantry skew).
+     *
+     * @param active True while the fault is present.
+     * @param flash_on The current phase of the alarm flash.
+     */
+    void set_fault_alarm(bool active, bool flash_on);
+
+    /**
+     * @brief Sets the state of the limit switch alarm layer.
+     *
+     * @param min_limit True if the min limit switch is active.
+     * @param max_limit True if the max limit switch is active.
+     * @param flash_on The current phase of the alarm flash.
+     */
+    void set_limit_alarm(bool min_limit, bool max_limit, bool flash_on);
+
+    /**
+     * @brief Places the position marker on a whole LED.
+     *
+     * @param center The LED index at the center of the marker, or -1 to hide it.
+     * @param half_width The number of LEDs lit on either side of the center.
+     * @param color The marker color.
+     */
+    void set_marker(int center, int half_width, const CRGB& color);
+
+    /**
+     * @brief Places the position marker with sub-pixel precision.
+     *
+     * Only the old and the new marker spans are recomposited.
+     *
+     * @param center_q8 The marker center in 1/256 LED units, or -1 to hide it.
+     * @param half_width The number of LEDs lit on either side of the center.
+     * @param color The marker color.
+     */
+    void set_marker_q8(int32_t center_q8, int half_width, const CRGB& color);
+
+    /**
+     * @brief Recomposites every dirty span into the output buffer.
+     *
+     * @return True if any output pixel changed and the strip must be re-sent.
+     */
+    bool render();
+
+    /**
+     * @brief Forces the whole strip to be recomposited on the next render.
+     */
+    void invalidate();
+
+    /**
+     * @brief The span of output pixels changed by the last `render()`.
+     */
+    LedSpan changed_span() const { return changed; }
+
+    int size() const { return num_leds; }
+
+private:
+    void mark_dirty(int start, int end);
+    LedSpan marker_span() const;
+    uint16_t marker_coverage(int i) const;
+
+    int num_leds = 0;
+    CRGB* base = nullptr;
+    CRGB* output = nullptr;
+
+    // Each layer's contribution to the next frame
+    LedSpan dirty = {0, 0};
+    LedSpan changed = {0, 0};
+
+    bool fault_on = false;
+
+    bool min_limit = false;
+    bool max_limit = false;
+    bool flash_on = false;
+
+    int32_t marker_center_q8 = -1;
+    int marker_half_width = 0;
+    CRGB marker_color = CRGB::Green;
+};
+
+/**
+ * @brief Maps an encoder position onto a strip in 1/256 LED units.
+ *
+ * Computed in 64-bit so raw encoder counts cannot overflow. The result is
+ * clamped to the strip.
+ *
+ * @param counts The axis position in encoder counts.
+ * @param num_leds The number of LEDs on the strip.
+ * @param counts_per_rail Encoder counts over the full rail length.
+ * @return The LED position in Q8, or -1 if the rail length is not configured.
+ */
+int32_t counts_to_led_q8(int32_t counts, int num_leds, int64_t counts_per_rail);
+
+#endif // LED_COMPOSITOR_H
@@ -0,0 +1,146 @@
+/**
+ * @file led_effects.cpp
+ * @brief Effect engine and the built-in LED effects.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Built-in effects are "knight_rider" (used for the boot animation), "chasing"
+ * (the Alexa chasing effect), "crossfade" (used at shutdown) and
+ * "alarm_flash" (the SD error visual). All of them derive their state from
+ * the elapsed time only, so they never index outside their own strip.
+ */
+#include "led_effects.h"
+#include "version.h"
+#include "led_blend.h"
+#include <string.h>
+
+// Time the alarm flash flashes before it holds its color
+#define ALARM_FLASH_MS      10000
+
+// Head of the list of registered effects
+static EffectRegistration* effect_registry = nullptr;
+
+EffectRegistration::EffectRegistration(const char* name, Effect* (*create)(void* slot))
+    : name(name), create(create), next(effect_registry) {
+    effect_registry = this;
+}
+
+bool EffectEngine::start(int strip, const char* name, int num_leds, const EffectParams& params, uint32_t now_ms,
+                         const CRGB* snapshot, CRGB* scratch) {
+    if (strip < 0 || strip >= EFFECT_STRIP_COUNT) return false;
+
+    for (EffectRegistration* reg = effect_registry; reg != nullptr; reg = reg->next) {
+        if (strcmp(reg->name, name) != 0) continue;
+
+        stop(strip);
+        effects[strip] = reg->create(slots[strip]);
+        effects[strip]->start(num_leds, params, snapshot, scratch);
+        start_ms[strip] = now_ms;
+        duration_ms[strip] = params.duration_ms;
+        return true;
+    }
+    return false;
+}
+
+void EffectEngine::stop(int strip) {
+    if (effects[strip] == nullptr) return;
+    effects[strip]->~Effect();
+    effects[strip] = nullptr;
+}
+
+bool EffectEngine::render(int strip, CRGB* leds, uint32_t now_ms) {
+    Effect* effect = effects[strip];
+    if (effect == nullptr) return false;
+
+    uint32_t elapsed = now_ms - start_ms[strip];
+    if (duration_ms[strip] > 0 && elapsed >= duration_ms[strip]) {
+        stop(strip);
+        return false;
+    }
+    effect->render(leds, elapsed);
+    return true;
+}
+
+/**
+ * @class KnightRiderEffect
+ * @brief A single eye bouncing between both ends of the strip.
+ */
+class KnightRiderEffect : public Effect {
+public:
+    void render(CRGB* leds, uint32_t t_ms) override {
+        if (num_leds <= 0) return;
+        int step_ms = params.step_ms > 0 ? params.step_ms : 1;
+
+        // Clear the strip
+        fill_solid(leds, num_leds, CRGB::Black);
+
+        // Position along a back-and-forth path of 2 * (num_leds - 1) steps
+        uint32_t period = num_leds > 1 ? 2 * (num_leds - 1) : 1;
+        uint32_t step = (t_ms / step_ms) % period;
+        int head = step < (uint32_t)num_leds ? step : period - step;
+
+        // Draw the "eye"
+        leds[head] = params.color;
+    }
+};
+REGISTER_LED_EFFECT(KnightRiderEffect, "knight_rider");
+
+/**
+ * @class ChasingEffect
+ * @brief A single LED running from the start to the end of the strip and wrapping.
+ */
+class ChasingEffect : public Effect {
+public:
+    void render(CRGB* leds, uint32_t t_ms) override {
+        if (num_leds <= 0) return;
+        int step_ms = params.step_ms > 0 ? params.step_ms : 1;
+
+        fill_solid(leds, num_leds, CRGB::Black);
+        leds[(t_ms / step_ms) % num_leds] = params.color;
+    }
+};
+REGISTER_LED_EFFECT(ChasingEffect, "chasing");
+
+/**
+ * @class CrossfadeEffect
+ * @brief Fades from the strip's frame at start to a solid color.
+ *
+ * The whole fade is one "step", so it takes `step_ms`; the target is then held
+ * until the effect is stopped or its duration ends. The target frame is
+ * rendered into the scratch frame and blended with the snapshot into `leds`,
+ * so any target frame can be faded to the same way.
+ */
+class CrossfadeEffect : public Effect {
+public:
+    void render(CRGB* leds, uint32_t t_ms) override {
+        if (num_leds <= 0) return;
+        if (snapshot == nullptr || scratch == nullptr) {
+            fill_solid(leds, num_leds, params.color);
+            return;
+        }
+
+        fill_solid(scratch, num_leds, params.color);
+        crossfade_frame(leds, snapshot, scratch, num_leds, blend_weight_q8(t_ms, params.step_ms));
+    }
+};
+REGISTER_LED_EFFECT(CrossfadeEffect, "crossfade");
+
+/**
+ * @class AlarmFlashEffect
+ * @brief Flashes the whole strip between a color and black, then holds the color.
+ *
+ * Each phase lasts `step_ms`; after ALARM_FLASH_MS the color stays on until
+ * the effect is stopped.
+ */
+class AlarmFlashEffect : public Effect {
+public:
+    void render(CRGB* leds, uint32_t t_ms) override {
+        if (num_leds <= 0) return;
+        int step_ms = params.step_ms > 0 ? params.step_ms : 1;
+
+        bool lit = t_ms >= ALARM_FLASH_MS || (t_ms / step_ms) % 2 == 0;
+        fill_solid(leds, num_leds, lit ? params.color : CRGB(CRGB::Black));
+    }
+};
+REGISTER_LED_EFFECT(AlarmFlashEffect, "alarm_flash");
@@ -0,0 +1,144 @@
+/**
+ * @file led_effects.h
+ * @brief Effect engine with per-strip effect state for the LED strips.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Effects implement the small `Effect` interface and render a whole frame for
+ * a given time, without sleeping. Every strip runs its own effect instance,
+ * constructed in a fixed pool slot, so effects never share position state
+ * between strips of different lengths. Effects register themselves by name
+ * with `REGISTER_LED_EFFECT`, so new effects can be added in their own file
+ * without touching `led_task`.
+ */
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include "version.h"
+#include <FastLED.h>
+#include <new>
+
+// Number of strips the engine runs effects on (0=Y, 1=YY, 2=X)
+#define EFFECT_STRIP_COUNT  3
+
+// Size of a pool slot; every effect class must fit into one
+#define EFFECT_SLOT_SIZE    64
+
+/**
+ * @struct EffectParams
+ * @brief Parameters passed to an effect when it is started.
+ */
+struct EffectParams {
+    CRGB color;
+    int step_ms;            // Time per animation step
+    uint32_t duration_ms;   // 0 to run until stopped
+};
+
+/**
+ * @class Effect
+ * @brief Interface implemented by every LED effect.
+ */
+class Effect {
+public:
+    virtual ~Effect() {}
+
+    /**
+     * @brief Initializes the per-strip state.
+     *
+     * @param num_leds The number of LEDs on the strip the effect runs on.
+     * @param params The effect parameters.
+     * @param snapshot The strip's frame when the effect started; stays valid
+     *                 until the effect ends.
+     * @param scratch A frame of the strip's length the effect may use, e.g.
+     *                for a target frame; stays valid until the effect ends.
+     */
+    virtual void start(int num_leds, const EffectParams& params, const CRGB* snapshot, CRGB* scratch) {
+        this->num_leds = num_leds;
+        this->params = params;
+        this->snapshot = snapshot;
+        this->scratch = scratch;
+    }
+
+    /**
+     * @brief Renders the frame at `t_ms` milliseconds after the effect started.
+     *
+     * Must only write `leds[0, num_leds)` and must not block.
+     */
+    virtual void render(CRGB* leds, uint32_t t_ms) = 0;
+
+protected:
+    int num_leds = 0;
+    EffectParams params = {CRGB::Black, 1, 0};
+    const CRGB* snapshot = nullptr;
+    CRGB* scratch = nullptr;
+};
+
+/**
+ * @struct EffectRegistration
+ * @brief Entry in the list of named effects, created by `REGISTER_LED_EFFECT`.
+ */
+struct EffectRegistration {
+    const char* name;
+    Effect* (*create)(void* slot);
+    EffectRegistration* next;
+
+    EffectRegistration(const char* name, Effect* (*create)(void* slot));
+};
+
+/**
+ * @brief Registers an effect class under a name.
+ *
+ * The class must be default-constructible and fit into EFFECT_SLOT_SIZE bytes.
+ */
+#define REGISTER_LED_EFFECT(cls, effect_name) \
+    static_assert(sizeof(cls) <= EFFECT_SLOT_SIZE, #cls " does not fit an effect slot"); \
+    static Effect* create_##cls(void* slot) { return new (slot) cls(); } \
+    static EffectRegistration registration_##cls(effect_name, create_##cls)
+
+/**
+ * @class EffectEngine
+ * @brief Runs one effect per strip out of a fixed pool of slots.
+ */
+class EffectEngine {
+public:
+    /**
+     * @brief Starts a registered effect on a strip, replacing any running one.
+     *
+     * @param strip The strip index (0=Y, 1=YY, 2=X).
+     * @param name The registered effect name.
+     * @param num_leds The number of LEDs on the strip.
+     * @param params The effect parameters.
+     * @param now_ms The current render time.
+     * @param snapshot The strip's current frame, kept valid by the caller while the effect runs.
+     * @param scratch A scratch frame of the strip's length, kept valid by the caller while the effect runs.
+     * @return False if no effect with that name is registered.
+     */
+    bool start(int strip, const char* name, int num_leds, const EffectParams& params, uint32_t now_ms,
+               const CRGB* snapshot, CRGB* scratch);
+
+    /**
+     * @brief Stops the effect running on a strip.
+     */
+    void stop(int strip);
+
+    /**
+     * @brief Returns true if an effect is running on the strip.
+     */
+    bool active(int strip) const { return effects[strip] != nullptr; }
+
+    /**
+     * @brief Renders the strip's effect for the current time.
+     *
+     * @return False if no effect is running or the effect has just finished.
+     */
+    bool render(int strip, CRGB* leds, uint32_t now_ms);
+
+private:
+    alignas(8) uint8_t slots[EFFECT_STRIP_COUNT][EFFECT_SLOT_SIZE];
+    Effect* effects[EFFECT_STRIP_COUNT] = {};
+    uint32_t start_ms[EFFECT_STRIP_COUNT] = {};
+    uint32_t duration_ms[EFFECT_STRIP_COUNT] = {};
+};
+
+#endif // LED_EFFECTS_H
@@ -0,0 +1,70 @@
+/**
+ * @file led_lut.cpp
+ * @brief Implementation of the per-strip output lookup tables.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Tables are built with floating point once per input change; applying them
+ * only touches integer bytes.
+ */
+#include "led_lut.h"
+#include "version.h"
+#include <math.h>
+
+bool OutputLut::update(uint8_t brightness, uint8_t dim, const CRGB& correction, float gamma) {
+    // Other brightness, correction or gamma invalidate the tables of every dim level
+    if (current < 0 || brightness != this->brightness || correction != this->correction || gamma != this->gamma) {
+        for (int i = 0; i < LUT_CACHED_DIMS; i++) cache[i].built = false;
+        this->brightness = brightness;
+        this->correction = correction;
+        this->gamma = gamma;
+        current = -1;
+    }
+
+    if (current >= 0 && cache[current].dim == dim) return false;
+
+    for (int i = 0; i < LUT_CACHED_DIMS; i++) {
+        if (cache[i].built && cache[i].dim == dim) {
+            current = i;
+            return true;
+        }
+    }
+
+    // Replace the entry that is not in use
+    if (next == current) next = (next + 1) % LUT_CACHED_DIMS;
+    build(cache[next], dim);
+    current = next;
+    next = (next + 1) % LUT_CACHED_DIMS;
+    return true;
+}
+
+void OutputLut::build(DimTables& tables, uint8_t dim) const {
+    float gamma = this->gamma > 0.0f ? this->gamma : 1.0f;
+    float level = (brightness / 255.0f) * (dim / 255.0f);
+
+    for (int c = 0; c < 3; c++) {
+        float channel_scale = level * (correction[c] / 255.0f);
+        for (int v = 0; v < 256; v++) {
+            float linear = gamma == 1.0f ? v / 255.0f : powf(v / 255.0f, gamma);
+            tables.table[c][v] = (uint8_t)lroundf(linear * channel_scale * 255.0f);
+        }
+    }
+    tables.dim = dim;
+    tables.built = true;
+}
+
+void OutputLut::apply(const CRGB* src, CRGB* dst, int start, int end) const {
+    if (start >= end || current < 0) return;
+    const uint8_t (*table)[256] = cache[current].table;
+
+    const uint8_t* in = (const uint8_t*)(src + start);
+    uint8_t* out = (uint8_t*)(dst + start);
+    int num_bytes = (end - start) * 3;
+
+    for (int i = 0; i < num_bytes; i += 3) {
+        out[i] = table[0][in[i]];
+        out[i + 1] = table[1][in[i + 1]];
+        out[i + 2] = table[2][in[i + 2]];
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file led_lut.h
+ * @brief Precomputed per-strip output lookup tables for the LED path.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Gamma, color correction, per-strip brightness and the idle-dim factor are
+ * folded into one 256-entry table per color channel. The tables of the last
+ * LUT_CACHED_DIMS dim levels are kept, so switching between active and idle
+ * only selects another set; they are rebuilt when brightness, correction or
+ * gamma change (Alexa callback, config reload). The per-frame output stage is
+ * then one lookup per byte.
+ */
+#ifndef LED_LUT_H
+#define LED_LUT_H
+
+#include "version.h"
+#include <FastLED.h>
+
+// Dim levels whose tables are kept, the active and the idle one
+#define LUT_CACHED_DIMS     2
+
+/**
+ * @class OutputLut
+ * @brief Lookup tables mapping composited pixels to the values sent to a strip.
+ */
+class OutputLut {
+public:
+    /**
+     * @brief Selects the tables for the inputs, building them if not cached.
+     *
+     * @param brightness 0-255 strip brightness.
+     * @param dim 0-255 idle-dim factor, 255 when the axis is active.
+     * @param correction Color correction for the LED type (e.g. TypicalSMD5050).
+     * @param gamma Gamma exponent, 1.0 for linear output.
+     * @return True if other tables are in use and the whole strip must be re-sent.
+     */
+    bool update(uint8_t brightness, uint8_t dim, const CRGB& correction, float gamma);
+
+    /**
+     * @brief Maps `src[start, end)` through the tables into `dst`.
+     */
+    void apply(const CRGB* src, CRGB* dst, int start, int end) const;
+
+private:
+    /**
+     * @struct DimTables
+     * @brief The tables of one dim level.
+     */
+    struct DimTables {
+        uint8_t table[3][256];
+        uint8_t dim;
+        bool built;
+    };
+
+    void build(DimTables& tables, uint8_t dim) const;
+
+    DimTables cache[LUT_CACHED_DIMS] = {};
+    int current = -1;           // Index into cache of the tables in use
+    int next = 0;               // Cache entry the next build replaces
+
+    uint8_t brightness = 0;
+    CRGB correction;
+    float gamma = 0.0f;
+};
+
+#endif // LED_LUT_H
@@ -0,0 +1,150 @@
+/**
+ * @file led_output.cpp
+ * @brief Implementation of the parallel RMT output driver for the WS2815 strips.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Uses one legacy RMT TX channel per strip. Pixels are encoded into RMT items
+ * by a translator running from the RMT interrupt, which refills one half of the
+ * channel memory while the other half is on the wire (double-buffered encode).
+ * The ESP32-S3 only has DMA on a single RMT TX channel, so ping-pong refill is
+ * used for all three channels to keep them symmetrical.
+ */
+#include "led_output.h"
+#include "version.h"
+#include "pins.h"
+#include "sd_tasks.h"
+#include "logger.h"
+#include "framebuffer.h"
+#include <driver/rmt.h>
+
+// 80 MHz APB clock divided by 2 gives 25 ns per RMT tick
+#define LED_RMT_CLK_DIV     2
+
+// WS2815 bit timings in RMT ticks (T0H 300 ns, T0L 900 ns, T1H 900 ns, T1L 300 ns)
+#define WS2815_T0H_TICKS    12
+#define WS2815_T0L_TICKS    36
+#define WS2815_T1H_TICKS    36
+#define WS2815_T1L_TICKS    12
+
+static const rmt_channel_t led_channels[LED_STRIP_COUNT] = {RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_2};
+static const int led_pins[LED_STRIP_COUNT] = {LEDY_PIN, LEDYY_PIN, LEDX_PIN};
+
+// Front (on the wire) and back (being rendered) buffers per strip, owned by
+// the framebuffer manager
+static CRGB* led_buffers[LED_STRIP_COUNT][2];
+static uint8_t front_index[LED_STRIP_COUNT];
+static int led_counts[LED_STRIP_COUNT];
+
+// Strips that were started by the last submit and may still be transmitting
+static uint8_t in_flight_mask = 0;
+
+// Every channel was set up; nothing is sent otherwise
+static bool output_ready = false;
+
+/**
+ * @brief RMT translator converting CRGB pixels into WS2815 bit items.
+ *
+ * Runs in the RMT interrupt. Pixels are stored as R,G,B in memory but the
+ * WS2815 expects G,R,B on the wire, so whole pixels are translated at a time.
+ */
+static void IRAM_ATTR ws2815_translate(const void* src, rmt_item32_t* dest, size_t src_size,
+                                       size_t wanted_num, size_t* translated_size, size_t* item_num) {
+    const rmt_item32_t bit0 = {{{WS2815_T0H_TICKS, 1, WS2815_T0L_TICKS, 0}}};
+    const rmt_item32_t bit1 = {{{WS2815_T1H_TICKS, 1, WS2815_T1L_TICKS, 0}}};
+
+    const uint8_t* pixel = (const uint8_t*)src;
+    size_t size = 0;
+    size_t num = 0;
+
+    while (size + 3 <= src_size && num + 24 <= wanted_num) {
+        uint8_t grb[3] = {pixel[1], pixel[0], pixel[2]};
+        for (int c = 0; c < 3; c++) {
+            for (int bit = 7; bit >= 0; bit--) {
+                dest->val = (grb[c] & (1 << bit)) ? bit1.val : bit0.val;
+                dest++;
+            }
+        }
+        pixel += 3;
+        size += 3;
+        num += 24;
+    }
+
+    *translated_size = size;
+    *item_num = num;
+}
+
+/**
+ * @brief Configures the RMT channels on the framebuffer manager's output buffers.
+ */
+bool led_output_init(const int counts[LED_STRIP_COUNT]) {
+    for (int s = 0; s < LED_STRIP_COUNT; s++) {
+        led_counts[s] = counts[s];
+        led_buffers[s][0] = framebuffer_get(s, FB_FRONT);
+        led_buffers[s][1] = framebuffer_get(s, FB_BACK);
+        front_index[s] = 0;
+
+        rmt_config_t rmt_cfg = RMT_DEFAULT_CONFIG_TX((gpio_num_t)led_pins[s], led_channels[s]);
+        rmt_cfg.clk_div = LED_RMT_CLK_DIV;
+        rmt_cfg.mem_block_num = 1;
+        rmt_cfg.tx_config.idle_output_en = true;
+        rmt_cfg.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+        if (rmt_config(&rmt_cfg) != ESP_OK ||
+            rmt_driver_install(led_channels[s], 0, 0) != ESP_OK ||
+            rmt_translator_init(led_channels[s], ws2815_translate) != ESP_OK) {
+            LOG_ERROR(LOG_LED, "LED output: failed to set up RMT channel %d", s);
+            // Release the drivers installed so far, this channel's included
+            for (int i = 0; i <= s; i++) {
+                rmt_driver_uninstall(led_channels[i]);
+            }
+            return false;
+        }
+    }
+    output_ready = true;
+    return true;
+}
+
+/**
+ * @brief Returns the back buffer of a strip, to be filled with the next frame.
+ */
+CRGB* led_output_back_buffer(int strip) {
+    return led_buffers[strip][front_index[strip] ^ 1];
+}
+
+/**
+ * @brief Flips the selected strips and starts all of them transmitting together.
+ */
+bool led_output_submit(uint8_t strip_mask) {
+    if (!output_ready || !led_output_wait_done(0)) return false;
+
+    for (int s = 0; s < LED_STRIP_COUNT; s++) {
+        if (!(strip_mask & (1 << s))) continue;
+        front_index[s] ^= 1;
+        rmt_write_sample(led_channels[s], (const uint8_t*)led_buffers[s][front_index[s]],
+                         led_counts[s] * sizeof(CRGB), false);
+    }
+    in_flight_mask = strip_mask;
+    return true;
+}
+
+/**
+ * @brief Waits until every strip of the last submitted frame has been sent.
+ *
+ * The WS2815 latch (>280 us low) is provided by the idle level between frames.
+ */
+bool led_output_wait_done(TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+    for (int s = 0; s < LED_STRIP_COUNT; s++) {
+        if (!(in_flight_mask & (1 << s))) continue;
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t remaining = elapsed < timeout ? timeout - elapsed : 0;
+        if (rmt_wait_tx_done(led_channels[s], remaining) != ESP_OK) {
+            return false;
+        }
+        in_flight_mask &= ~(1 << s);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file led_output.h
+ * @brief Parallel, non-blocking RMT output driver for the WS2815 strips.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Each strip (LEDY_PIN, LEDYY_PIN, LEDX_PIN) is driven by its own RMT channel,
+ * and all channels are started together so a frame costs the wire time of the
+ * longest strip instead of the sum of all three. Every strip has a front buffer
+ * being transmitted and a back buffer the LED task renders the next frame into.
+ */
+#ifndef LED_OUTPUT_H
+#define LED_OUTPUT_H
+
+#include "version.h"
+#include <FastLED.h>
+#include <freertos/FreeRTOS.h>
+
+// Number of LED strips driven by the output driver (0=Y, 1=YY, 2=X)
+#define LED_STRIP_COUNT     3
+
+/**
+ * @brief Configures the RMT channels on the framebuffer manager's output buffers.
+ *
+ * `framebuffer_init()` must have been called first.
+ *
+ * @param counts The number of LEDs on each strip.
+ * @return True if every channel was set up successfully; on failure no
+ *         channel is left installed.
+ */
+bool led_output_init(const int counts[LED_STRIP_COUNT]);
+
+/**
+ * @brief Returns the back buffer of a strip, to be filled with the next frame.
+ *
+ * The buffer must not be touched between `led_output_submit()` and the
+ * moment `led_output_wait_done()` reports the frame as sent.
+ *
+ * @param strip The strip index (0=Y, 1=YY, 2=X).
+ */
+CRGB* led_output_back_buffer(int strip);
+
+/**
+ * @brief Flips the front/back buffers of the selected strips and starts sending them.
+ *
+ * All selected strips start transmitting at the same time. This call does not
+ * wait for the transmission to finish ("frame submitted").
+ *
+ * @param strip_mask Bit n set to send strip n.
+ * @return False if the previous frame is still being transmitted or the
+ *         driver is not set up.
+ */
+bool led_output_submit(uint8_t strip_mask);
+
+/**
+ * @brief Waits until the last submitted frame has been sent ("frame done").
+ *
+ * @param timeout Maximum time to wait, 0 to only poll.
+ * @return True if no strip is transmitting any more.
+ */
+bool led_output_wait_done(TickType_t timeout);
+
+#endif // LED_OUTPUT_H
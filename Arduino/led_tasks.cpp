@@ -13,6 +13,16 @@
 #include "config.h"
 #include "pins.h"
 #include "buzzer.h"
+#include "led_compositor.h"
+#include "led_output.h"
+#include "frame_scheduler.h"
+#include "led_effects.h"
+#include "led_lut.h"
+#include "framebuffer.h"
+#include "axis_mailbox.h"
+#include "motion_estimator.h"
+#include "servo_tasks.h"
+#include "logger.h"
 #include <FastLED.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -30,18 +40,6 @@ extern volatile uint8_t alexa_brightness_yy;
 extern volatile uint8_t alexa_brightness_x;
 extern TCA9554 tca9554;
 
-// FreeRTOS synchronization objects
-SemaphoreHandle_t ledEffectSemaphore;
-QueueHandle_t ledCommandQueue;
-
-// Global variables for tracking servo position and idle state
-int servoY_position = 0;
-int servoYY_position = 0;
-int servoX_position = 0;
-TickType_t last_move_time_Y = 0;
-TickType_t last_move_time_YY = 0;
-TickType_t last_move_time_X = 0;
-
 // Internal state for the LED effects
 enum LedEffect {
     NO_EFFECT,
@@ -54,32 +52,41 @@ volatile LedEffect currentEffect = BOOT_ANIMATION;
 volatile bool sd_error_active = false;
 volatile bool chasing_purple_active = false;
 
-// Backup arrays for storing LED state before position display
-CRGB ledsY_backup[config.LEDS_Y_COUNT];
-CRGB ledsYY_backup[config.LEDS_YY_COUNT];
-CRGB ledsX_backup[config.LEDS_X_COUNT];
+// Per-strip compositors and their base layers, indexed by strip id
+// (0=Y, 1=YY, 2=X). The compositors write into ledsY/ledsYY/ledsX, which are
+// then brightness-scaled into the output driver's back buffers.
+static LedCompositor compositors[3];
+static CRGB* base_layers[3];
+
+// Paces led_task at config.LEDS.TARGET_FPS
+static FrameScheduler frame_scheduler;
+
+// Runs one effect per strip on top of (in place of) the orange background
+static EffectEngine effect_engine;
+
+// Effect requested by other tasks, picked up by led_task on its next frame.
+// An empty name stops the running effects. Requests made before led_task
+// runs stay pending until it starts.
+static portMUX_TYPE effect_request_mux = portMUX_INITIALIZER_UNLOCKED;
+static char effect_request_name[24];
+static EffectParams effect_request_params;
+static bool effect_request_pending = false;
 
-// Variables to track the last drawn position
-int last_pos_Y = -1;
-int last_pos_YY = -1;
-int last_pos_X = -1;
+// Output lookup tables folding gamma, color correction, brightness and idle dim
+static OutputLut output_luts[3];
 
-// Limit switch status, updated by the queue
-bool min_limit_Y = false;
-bool max_limit_Y = false;
-bool min_limit_YY = false;
-bool max_limit_YY = false;
-bool min_limit_X = false;
-bool max_limit_X = false;
+// Predict each axis' position between servo samples for the marker
+static MotionEstimator motion_estimators[AXIS_COUNT];
+static uint32_t axis_versions[AXIS_COUNT];
+
+// Pixels changed by the last submitted frame, which the back buffer (the
+// previous front buffer) has not received yet
+static LedSpan pending_spans[3];
 
 
 // Helper functions for animations
-void knight_rider_effect(CRGB* leds, int num_leds, CRGB color, int speed);
-void chasing_effect(CRGB* leds, int num_leds, CRGB color, int speed);
-void dim_leds_on_idle(CRGB* leds, int num_leds, int idle_percent);
 void flash_onboard_led(int pin, CRGB color, int duration_ms, int speed_ms);
-void update_position_display_and_preserve(CRGB* leds, CRGB* backup_leds, int num_leds, int position, int rail_length, int led_count_around_center, int& last_pos);
-void flash_red_limits(CRGB* leds, int num_leds, bool min_limit, bool max_limit);
+void update_position_marker(LedCompositor& compositor, int32_t position, int rail_length, float counts_per_mm, int led_count_around_center);
 
 
 /**
@@ -96,227 +103,208 @@ void set_limit_visuals(int led_strip_index, bool min_limit, bool max_limit) {
 }
 
 /**
- * @brief Flashes red on limit switches and sets remaining LEDs to orange.
- * 
- * @param leds The FastLED array for the strip.
- * @param num_leds The total number of LEDs in the strip.
- * @param min_limit True if the min limit switch is active.
- * @param max_limit True if the max limit switch is active.
+ * @brief Asks the LED task to start a registered effect on all strips.
  */
-void flash_red_limits(CRGB* leds, int num_leds, bool min_limit, bool max_limit) {
-    static bool flash_state = false;
-    static unsigned long last_flash = 0;
-    const int flash_delay = 500; // milliseconds
-
-    if (millis() - last_flash > flash_delay) {
-        flash_state = !flash_state;
-        last_flash = millis();
-    }
-    
-    // Set all remaining LEDs to solid orange
-    fill_solid(leds, num_leds, CRGB::Orange);
-    
-    if (min_limit && flash_state) {
-        fill_solid(leds, 20, CRGB::Red); // First 20 LEDs flash red
-    } else if (min_limit && !flash_state) {
-        fill_solid(leds, 20, CRGB::Orange);
-    }
-    
-    if (max_limit && flash_state) {
-        fill_solid(leds + (num_leds - 20), 20, CRGB::Red); // Last 20 LEDs flash red
-    } else if (max_limit && !flash_state) {
-        fill_solid(leds + (num_leds - 20), 20, CRGB::Orange);
-    }
+void led_request_effect(const char* name, const EffectParams& params) {
+    portENTER_CRITICAL(&effect_request_mux);
+    strlcpy(effect_request_name, name ? name : "", sizeof(effect_request_name));
+    effect_request_params = params;
+    effect_request_pending = true;
+    portEXIT_CRITICAL(&effect_request_mux);
 }
 
-
 /**
  * @brief FreeRTOS task to manage all LED animations and effects.
  */
 void led_task(void* pvParameters) {
-    ledEffectSemaphore = xSemaphoreCreateBinary();
-    ledCommandQueue = xQueueCreate(10, sizeof(LimitStatusMessage)); // Create the queue
-
-    // Boot-up animation: Knight Rider on all strips
-    log_to_sd("Starting LED boot-up animation.");
-    long start_time = millis();
-    while (millis() - start_time < 10000) {
-        knight_rider_effect(ledsY, config.LEDS_Y_COUNT, CRGB::Blue, 50);
-        knight_rider_effect(ledsYY, config.LEDS_YY_COUNT, CRGB::Blue, 50);
-        knight_rider_effect(ledsX, config.LEDS_X_COUNT, CRGB::Blue, 50);
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(config.FLASH_SPEED));
+    frame_scheduler.begin(config.LEDS.TARGET_FPS);
+
+    // Hand the strips over to the compositors. The base layer is the solid
+    // orange background (or a running effect); alarms and the marker are drawn on top.
+    CRGB* scenes[3] = {ledsY, ledsYY, ledsX};
+    int counts[3] = {config.LEDS.LEDS_Y_COUNT, config.LEDS.LEDS_YY_COUNT, config.LEDS.LEDS_X_COUNT};
+    for (int s = 0; s < 3; s++) {
+        base_layers[s] = framebuffer_get(s, FB_BASE);
+        compositors[s].begin(counts[s], base_layers[s], scenes[s]);
+        compositors[s].fill_base(CRGB::Orange);
     }
-    log_to_sd("LED boot-up animation complete.");
-
-    // After boot-up, set LEDY and LEDYY to solid white
-    fill_solid(ledsY, config.LEDS_Y_COUNT, CRGB::White);
-    fill_solid(ledsYY, config.LEDS_YY_COUNT, CRGB::White);
-    FastLED.show();
-
-    // Make sure backup arrays are initialized
-    memcpy(ledsY_backup, ledsY, sizeof(CRGB) * config.LEDS_Y_COUNT);
-    memcpy(ledsYY_backup, ledsYY, sizeof(CRGB) * config.LEDS_YY_COUNT);
-    memcpy(ledsX_backup, ledsX, sizeof(CRGB) * config.LEDS_X_COUNT);
 
+    // Boot-up animation: Knight Rider on all strips for 10 seconds
+    LOG_INFO(LOG_LED, "Starting LED boot-up animation.");
+    EffectParams boot_params = {CRGB::Blue, config.LEDS.CHASE_SPEED, 10000};
+    for (int s = 0; s < 3; s++) {
+        effect_engine.start(s, "knight_rider", counts[s], boot_params, 0, framebuffer_snapshot(s, FB_SCENE),
+                            framebuffer_get(s, FB_TARGET));
+    }
+    bool boot_running = true;
 
     while (1) {
-        // Process incoming messages from other tasks
-        LimitStatusMessage msg;
-        if (xQueueReceive(ledCommandQueue, &msg, 0) == pdTRUE) {
-            switch (msg.strip_id) {
-                case 0: // LEDY
-                    min_limit_Y = msg.min_limit;
-                    max_limit_Y = msg.max_limit;
-                    break;
-                case 1: // LEDYY
-                    min_limit_YY = msg.min_limit;
-                    max_limit_YY = msg.max_limit;
-                    break;
-                case 2: // LEDX
-                    min_limit_X = msg.min_limit;
-                    max_limit_X = msg.max_limit;
+        uint32_t t = frame_scheduler.frame_start();
+
+        // Start or stop effects requested by other tasks
+        char name[sizeof(effect_request_name)];
+        EffectParams params;
+        portENTER_CRITICAL(&effect_request_mux);
+        bool requested = effect_request_pending;
+        if (requested) {
+            memcpy(name, effect_request_name, sizeof(name));
+            params = effect_request_params;
+            effect_request_pending = false;
+        }
+        portEXIT_CRITICAL(&effect_request_mux);
+
+        if (requested) {
+            for (int s = 0; s < 3; s++) {
+                if (name[0] == '\0') {
+                    effect_engine.stop(s);
+                    compositors[s].fill_base(CRGB::Orange);
+                } else if (!effect_engine.start(s, name, counts[s], params, t, framebuffer_snapshot(s, FB_SCENE),
+                                                framebuffer_get(s, FB_TARGET))) {
+                    LOG_WARN(LOG_LED, "Unknown LED effect requested: %s", name);
                     break;
+                }
             }
         }
 
-        // Apply limit switch visual indicators using the stored state
-        flash_red_limits(ledsY, config.LEDS_Y_COUNT, min_limit_Y, max_limit_Y);
-        flash_red_limits(ledsYY, config.LEDS_YY_COUNT, min_limit_YY, max_limit_YY);
-        flash_red_limits(ledsX, config.LEDS_X_COUNT, min_limit_X, max_limit_X);
-        
-        // Update servo position display
-        update_position_display_and_preserve(ledsY, ledsY_backup, config.LEDS_Y_COUNT, servoY_position, config.RAIL_Y_LENGTH_MM, config.AXIS_POSITION_DISPLAY_LEDS, last_pos_Y);
-        update_position_display_and_preserve(ledsYY, ledsYY_backup, config.LEDS_YY_COUNT, servoYY_position, config.RAIL_Y_LENGTH_MM, config.AXIS_POSITION_DISPLAY_LEDS, last_pos_YY);
-        update_position_display_and_preserve(ledsX, ledsX_backup, config.LEDS_X_COUNT, servoX_position, config.RAIL_X_LENGTH_MM, config.AXIS_POSITION_DISPLAY_LEDS, last_pos_X);
+        // Effects render into the base layer; finished effects restore the background
+        for (int s = 0; s < 3; s++) {
+            if (!effect_engine.active(s)) continue;
+            if (effect_engine.render(s, base_layers[s], t)) {
+                compositors[s].touch_base(0, counts[s]);
+            } else {
+                compositors[s].fill_base(CRGB::Orange);
+            }
+        }
+        if (boot_running && !effect_engine.active(0) && !effect_engine.active(1) && !effect_engine.active(2)) {
+            LOG_INFO(LOG_LED, "LED boot-up animation complete.");
+            boot_running = false;
+        }
+
+        // Newest consistent state of every axis, published by servo_task
+        AxisState axes[AXIS_COUNT];
+        int32_t positions[AXIS_COUNT];
+        uint32_t render_ms = millis();
+        for (int s = 0; s < AXIS_COUNT; s++) {
+            uint32_t version = axis_mailboxes[s].read(axes[s]);
+            // Stale states repeat the last known position and carry no new sample
+            if (version != axis_versions[s] && !axes[s].stale) {
+                motion_estimators[s].add_sample(axes[s].timestamp_ms, axes[s].position, axes[s].min_limit, axes[s].max_limit);
+            }
+            axis_versions[s] = version;
+            positions[s] = motion_estimators[s].position_at(render_ms);
+        }
+
+        // Gantry skew alarm on the Y/YY strips, flashing at 1 Hz
+        bool flash_on = (render_ms / 500) % 2;
+        bool skew_alarm = gantry_skew_alarm();
+        compositors[AXIS_Y].set_fault_alarm(skew_alarm, flash_on);
+        compositors[AXIS_YY].set_fault_alarm(skew_alarm, flash_on);
+
+        // Limit switch alarm layer, flashing at 1 Hz
+        for (int s = 0; s < 3; s++) {
+            compositors[s].set_limit_alarm(axes[s].min_limit, axes[s].max_limit, flash_on);
+        }
 
+        // Servo position marker layer, at the predicted position for this frame
+        update_position_marker(compositors[0], positions[AXIS_Y], config.TABLE.RAIL_Y_LENGTH, config.TABLE.COUNTS_PER_MM_Y, config.LEDS.AXIS_POSITION_DISPLAY_LEDS);
+        update_position_marker(compositors[1], positions[AXIS_YY], config.TABLE.RAIL_Y_LENGTH, config.TABLE.COUNTS_PER_MM_Y, config.LEDS.AXIS_POSITION_DISPLAY_LEDS);
+        update_position_marker(compositors[2], positions[AXIS_X], config.TABLE.RAIL_X_LENGTH, config.TABLE.COUNTS_PER_MM_X, config.LEDS.AXIS_POSITION_DISPLAY_LEDS);
 
-        // Idle dimming
-        if (xTaskGetTickCount() - last_move_time_Y > pdMS_TO_TICKS(config.IDLE_TIMEOUT_SECONDS * 1000)) {
-            dim_leds_on_idle(ledsY, config.LEDS_Y_COUNT, config.IDLE_DIM_PERCENT);
+        // Composite frame N+1 while frame N may still be on the wire
+        bool changed[3];
+        for (int s = 0; s < 3; s++) {
+            changed[s] = compositors[s].render();
         }
-        if (xTaskGetTickCount() - last_move_time_YY > pdMS_TO_TICKS(config.IDLE_TIMEOUT_SECONDS * 1000)) {
-            dim_leds_on_idle(ledsYY, config.LEDS_YY_COUNT, config.IDLE_DIM_PERCENT);
+
+        // Idle dimming and brightness only rebuild the lookup tables when they change
+        TickType_t now = xTaskGetTickCount();
+        TickType_t idle_ticks = pdMS_TO_TICKS(config.LEDS.LED_IDLE_SERVO_SECONDS * 1000);
+        uint8_t idle_dim = config.LEDS.LED_IDLE_SERVO_DIM;
+        uint8_t dim[3];
+        for (int s = 0; s < 3; s++) {
+            dim[s] = (now - axes[s].last_move_tick > idle_ticks) ? idle_dim : 255;
         }
-        if (xTaskGetTickCount() - last_move_time_X > pdMS_TO_TICKS(config.IDLE_TIMEOUT_SECONDS * 1000)) {
-            dim_leds_on_idle(ledsX, config.LEDS_X_COUNT, config.IDLE_DIM_PERCENT);
+        uint8_t brightness[3] = {alexa_brightness_y, alexa_brightness_yy, alexa_brightness_x};
+
+        // Only strips whose composited output or lookup tables changed are mapped
+        // into their back buffer, then all of them are started together
+        uint8_t strip_mask = 0;
+        led_output_wait_done(portMAX_DELAY);
+        for (int s = 0; s < 3; s++) {
+            LedSpan span = {0, 0};
+            if (output_luts[s].update(brightness[s], dim[s], TypicalSMD5050, config.LEDS.GAMMA)) {
+                span = {0, counts[s]};
+            } else if (changed[s]) {
+                span = compositors[s].changed_span();
+            } else {
+                continue;
+            }
+
+            // The back buffer is one frame behind, so it also needs the last frame's changes
+            LedSpan copy = span;
+            copy.include(pending_spans[s].start, pending_spans[s].end);
+            output_luts[s].apply(scenes[s], led_output_back_buffer(s), copy.start, copy.end);
+            pending_spans[s] = span;
+            strip_mask |= 1 << s;
         }
 
-        // Apply Alexa brightness
-        FastLED.setBrightness(alexa_brightness_y);
-        FastLED.show(ledsY, config.LEDS_Y_COUNT);
-        FastLED.setBrightness(alexa_brightness_yy);
-        FastLED.show(ledsYY, config.LEDS_YY_COUNT);
-        FastLED.setBrightness(alexa_brightness_x);
-        FastLED.show(ledsX, config.LEDS_X_COUNT);
+        if (strip_mask) {
+            led_output_submit(strip_mask);
+        }
 
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(100)); // Standard delay for the task loop
+        frame_scheduler.frame_end();
     }
 }
 
 /**
- * @brief Updates the LED strip to display the current servo position, preserving the previous state.
- * @param leds The FastLED array for the strip.
- * @param backup_leds The backup array for the strip.
- * @param num_leds The total number of LEDs in the strip.
- * @param position The current servo position in millimeters.
+ * @brief Returns the frame pacing statistics of the LED task.
+ */
+FrameStats led_frame_stats() {
+    return frame_scheduler.stats();
+}
+
+/**
+ * @brief Moves the position marker layer to the current servo position.
+ * @param compositor The compositor for the strip.
+ * @param position The current servo position in encoder counts.
  * @param rail_length The total rail length in millimeters.
+ * @param counts_per_mm Encoder counts per millimeter of travel.
  * @param led_count_around_center The number of green LEDs on either side of the center.
- * @param last_pos The last displayed position.
  */
-void update_position_display_and_preserve(CRGB* leds, CRGB* backup_leds, int num_leds, int position, int rail_length, int led_count_around_center, int& last_pos) {
-    if (rail_length <= 0) return;
-
-    // Calculate the current LED position
-    int led_pos = (position * num_leds) / rail_length;
-    
-    // If position has not changed, do nothing
-    if (led_pos == last_pos) return;
-
-    // Restore previous state if a previous position existed
-    if (last_pos != -1) {
-        int start_restore = max(0, last_pos - led_count_around_center);
-        int end_restore = min(num_leds - 1, last_pos + led_count_around_center);
-        for (int i = start_restore; i <= end_restore; i++) {
-            leds[i] = backup_leds[i];
-        }
-    }
-
-    // Save the state of the new LEDs before changing their color
-    int start_save = max(0, led_pos - led_count_around_center);
-    int end_save = min(num_leds - 1, led_pos + led_count_around_center);
-    for (int i = start_save; i <= end_save; i++) {
-        backup_leds[i] = leds[i];
-    }
-    
-    // Turn on the new green center
-    for (int i = start_save; i <= end_save; i++) {
-        leds[i] = CRGB::Green;
-    }
+void update_position_marker(LedCompositor& compositor, int32_t position, int rail_length, float counts_per_mm, int led_count_around_center) {
+    if (rail_length <= 0 || counts_per_mm <= 0.0f) return;
 
-    last_pos = led_pos;
+    // Sub-pixel LED position; the compositor ignores unchanged markers
+    int64_t counts_per_rail = llround((double)rail_length * counts_per_mm);
+    int32_t led_q8 = counts_to_led_q8(position, compositor.size(), counts_per_rail);
+    compositor.set_marker_q8(led_q8, led_count_around_center, CRGB::Green);
 }
 
 
 /**
  * @brief Displays a visual error state on all LED strips.
+ *
+ * Only led_task drives the strips, so the flashing is its "alarm_flash"
+ * effect; this call returns at once.
  */
 void trigger_sd_error_visual() {
-    log_to_sd("Triggering SD error visual.");
+    LOG_ERROR(LOG_LED, "Triggering SD error visual.");
     beep(BUZZER_PIN, 3);
-    long start_time = millis();
-    while (millis() - start_time < 10000) {
-        fill_solid(ledsY, config.LEDS_Y_COUNT, CRGB::Red);
-        fill_solid(ledsYY, config.LEDS_YY_COUNT, CRGB::Red);
-        fill_solid(ledsX, config.LEDS_X_COUNT, CRGB::Red);
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(config.FLASH_SPEED));
-        fill_solid(ledsY, config.LEDS_Y_COUNT, CRGB::Black);
-        fill_solid(ledsYY, config.LEDS_YY_COUNT, CRGB::Black);
-        fill_solid(ledsX, config.LEDS_X_COUNT, CRGB::Black);
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(config.FLASH_SPEED));
-    }
-    fill_solid(ledsY, config.LEDS_Y_COUNT, CRGB::Red);
-    fill_solid(ledsYY, config.LEDS_YY_COUNT, CRGB::Red);
-    fill_solid(ledsX, config.LEDS_X_COUNT, CRGB::Red);
-    FastLED.show();
+    EffectParams params = {CRGB::Red, config.LEDS.FLASH_SPEED, 0};
+    led_request_effect("alarm_flash", params);
 }
 
 /**
  * @brief Performs a crossfade animation to solid blue on all strips.
+ *
+ * The fade runs as a time-based effect inside the LED task's frame loop; this
+ * call only waits for it to finish.
  */
 void crossfade_to_blue(int duration_ms) {
-    const int num_steps = 100;
-    const int step_delay = duration_ms / num_steps;
-    
-    CRGB final_color = CRGB::Blue;
-    
-    CRGB initial_ledsY[config.LEDS_Y_COUNT];
-    CRGB initial_ledsYY[config.LEDS_YY_COUNT];
-    CRGB initial_ledsX[config.LEDS_X_COUNT];
-    
-    for (int i = 0; i < config.LEDS_Y_COUNT; i++) initial_ledsY[i] = ledsY[i];
-    for (int i = 0; i < config.LEDS_YY_COUNT; i++) initial_ledsYY[i] = ledsYY[i];
-    for (int i = 0; i < config.LEDS_X_COUNT; i++) initial_ledsX[i] = ledsX[i];
-    
-    for (int i = 0; i <= num_steps; i++) {
-        float blend_factor = (float)i / num_steps;
-
-        for (int j = 0; j < config.LEDS_Y_COUNT; j++) {
-            ledsY[j] = blend(initial_ledsY[j], final_color, blend_factor * 255);
-        }
-        for (int j = 0; j < config.LEDS_YY_COUNT; j++) {
-            ledsYY[j] = blend(initial_ledsYY[j], final_color, blend_factor * 255);
-        }
-        for (int j = 0; j < config.LEDS_X_COUNT; j++) {
-            ledsX[j] = blend(initial_ledsX[j], final_color, blend_factor * 255);
-        }
-
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(step_delay));
-    }
+    // Fade over duration_ms, then hold blue until restart
+    EffectParams params = {CRGB::Blue, duration_ms, 0};
+    led_request_effect("crossfade", params);
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
 }
 
 /**
@@ -342,57 +330,3 @@ void green_flash(int duration_ms) {
     delay(duration_ms);
     digitalWrite(ONBOARD_LED, LOW);
 }
-
-/**
- * @brief Runs a Knight Rider effect on an LED strip.
- */
-void knight_rider_effect(CRGB* leds, int num_leds, CRGB color, int speed) {
-    static int head = 0;
-    static bool forward = true;
-    
-    // Clear the strip
-    fill_solid(leds, num_leds, CRGB::Black);
-
-    // Draw the "eye"
-    leds[head] = color;
-    
-    // Move the eye
-    if (forward) {
-        head++;
-        if (head >= num_leds - 1) {
-            forward = false;
-        }
-    } else {
-        head--;
-        if (head <= 0) {
-            forward = true;
-        }
-    }
-    
-    // Delay for speed
-    vTaskDelay(pdMS_TO_TICKS(speed));
-}
-
-/**
- * @brief Runs a chasing effect on an LED strip.
- */
-void chasing_effect(CRGB* leds, int num_leds, CRGB color, int speed) {
-    static int pos = 0;
-    fill_solid(leds, num_leds, CRGB::Black);
-    leds[pos] = color;
-    pos = (pos + 1) % num_leds;
-    vTaskDelay(pdMS_TO_TICKS(speed));
-}
-
-
-/**
- * @brief Dims the LEDs on an idle axis.
- */
-void dim_leds_on_idle(CRGB* leds, int num_leds, int idle_percent) {
-    for (int i = 0; i < num_leds; i++) {
-        // Only dim white LEDs
-        if (leds[i] == CRGB::White) {
-            leds[i].nscale8(idle_percent);
-        }
-    }
-}
@@ -16,7 +16,8 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
-#include <freertos/queue.h>
+#include "frame_scheduler.h"
+#include "led_effects.h"
 
 // Global extern declarations for LED arrays
 extern CRGB* ledsY;
@@ -28,27 +29,6 @@ extern volatile uint8_t alexa_brightness_y;
 extern volatile uint8_t alexa_brightness_yy;
 extern volatile uint8_t alexa_brightness_x;
 
-// Extern declaration for the semaphore used to signal effects from Alexa callbacks
-extern SemaphoreHandle_t ledEffectSemaphore;
-
-// Global variables for tracking servo position and idle state
-extern int servoY_position;
-extern int servoYY_position;
-extern int servoX_position;
-extern TickType_t last_move_time_Y;
-extern TickType_t last_move_time_YY;
-extern TickType_t last_move_time_X;
-
-// Message structure for limit switch status changes
-struct LimitStatusMessage {
-    int strip_id;   // 0 for Y, 1 for YY, 2 for X
-    bool min_limit;
-    bool max_limit;
-};
-
-// Queue for communication between servo_tasks and led_tasks
-extern QueueHandle_t ledCommandQueue;
-
 /**
  * @brief FreeRTOS task to manage all LED animations and effects.
  *
@@ -59,18 +39,40 @@ extern QueueHandle_t ledCommandQueue;
  */
 void led_task(void* pvParameters);
 
+/**
+ * @brief Asks the LED task to start a registered effect on all strips.
+ *
+ * Safe to call from any task, e.g. Alexa callbacks, and before the LED task
+ * runs. The effect is started on the next frame (a request made during setup
+ * replaces the boot animation); when it finishes the strips return to their
+ * background. A newer request replaces one not yet started.
+ *
+ * @param name The registered effect name, or NULL/"" to stop the running effects.
+ * @param params The effect parameters.
+ */
+void led_request_effect(const char* name, const EffectParams& params);
+
+/**
+ * @brief Returns the frame pacing statistics of the LED task.
+ *
+ * @return Frame count, missed deadlines and frame-time statistics.
+ */
+FrameStats led_frame_stats();
+
 /**
  * @brief Displays a visual error state on all LED strips.
  *
  * Flashes all strips red for 10 seconds, then holds solid red. This is
- * used for critical errors like SD card failure.
+ * used for critical errors like SD card failure. The LED task draws it, so
+ * the call does not wait and never touches the strips itself.
  */
 void trigger_sd_error_visual();
 
 /**
  * @brief Performs a crossfade animation to solid blue on all strips.
  *
- * This function is non-blocking and used during system shutdown.
+ * The fade is rendered by the LED task; this call returns once it is done.
+ * Used during system shutdown.
  *
  * @param duration_ms The duration of the crossfade animation in milliseconds.
  */
@@ -0,0 +1,652 @@
+/**
+ * @file log_codec.cpp
+ * @brief Implementation of argument packing and the binary log format.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Packing and rendering parse the printf format the same way. Integers are
+ * rendered through a "ll" conversion and strings through "%.*s", so the
+ * rendered text matches what vsnprintf() would have produced.
+ */
+#include "log_codec.h"
+#include "version.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert((LOG_MESSAGE_IDS & (LOG_MESSAGE_IDS - 1)) == 0, "LOG_MESSAGE_IDS must be a power of two");
+static_assert(LOG_ENCODED_MAX < 0x4000 && LOG_ENCODED_MAX <= LOG_READ_BUFFER, "a record must fit a two-byte length and the read buffer");
+
+// Length modifiers of a conversion
+enum ArgLength : uint8_t {
+    ARG_INT = 0,    // none, hh, h (promoted to int)
+    ARG_CHAR,       // hh
+    ARG_SHORT,      // h
+    ARG_LONG,       // l
+    ARG_LONG_LONG,  // ll, q
+    ARG_INTMAX,     // j
+    ARG_SIZE,       // z
+    ARG_PTRDIFF,    // t
+    ARG_LONG_DOUBLE // L
+};
+
+/**
+ * @struct Conversion
+ * @brief One parsed printf conversion.
+ */
+struct Conversion {
+    char flags[8];
+    bool width_star;
+    int width;              // -1 if none
+    bool precision_star;
+    int precision;          // -1 if none
+    uint8_t length;         // ArgLength
+    char type;
+    const char* next;       // First character after the conversion
+};
+
+/**
+ * @brief Parses the conversion following a '%'.
+ *
+ * @return False for conversions this codec does not know.
+ */
+static bool parse_conversion(const char* p, Conversion* c) {
+    size_t flags = 0;
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        if (flags < sizeof(c->flags) - 1) c->flags[flags++] = *p;
+        p++;
+    }
+    c->flags[flags] = '\0';
+
+    c->width_star = false;
+    c->width = -1;
+    if (*p == '*') {
+        c->width_star = true;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        c->width = 0;
+        while (*p >= '0' && *p <= '9') {
+            if (c->width < 10000) c->width = c->width * 10 + (*p - '0');
+            p++;
+        }
+    }
+
+    c->precision_star = false;
+    c->precision = -1;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            c->precision_star = true;
+            p++;
+        } else {
+            c->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                if (c->precision < 10000) c->precision = c->precision * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+
+    c->length = ARG_INT;
+    if (p[0] == 'h' && p[1] == 'h') { c->length = ARG_CHAR; p += 2; }
+    else if (p[0] == 'h') { c->length = ARG_SHORT; p++; }
+    else if (p[0] == 'l' && p[1] == 'l') { c->length = ARG_LONG_LONG; p += 2; }
+    else if (p[0] == 'l') { c->length = ARG_LONG; p++; }
+    else if (p[0] == 'q') { c->length = ARG_LONG_LONG; p++; }
+    else if (p[0] == 'j') { c->length = ARG_INTMAX; p++; }
+    else if (p[0] == 'z') { c->length = ARG_SIZE; p++; }
+    else if (p[0] == 't') { c->length = ARG_PTRDIFF; p++; }
+    else if (p[0] == 'L') { c->length = ARG_LONG_DOUBLE; p++; }
+
+    if (*p == '\0' || strchr("diuoxXcspnfFeEgGaA%", *p) == NULL) return false;
+    c->type = *p;
+    c->next = p + 1;
+    return true;
+}
+
+static int64_t signed_arg(va_list* args, uint8_t length) {
+    switch (length) {
+        case ARG_CHAR:      return (signed char)va_arg(*args, int);
+        case ARG_SHORT:     return (short)va_arg(*args, int);
+        case ARG_LONG:      return va_arg(*args, long);
+        case ARG_LONG_LONG: return va_arg(*args, long long);
+        case ARG_INTMAX:    return va_arg(*args, intmax_t);
+        case ARG_SIZE:      return (ptrdiff_t)va_arg(*args, size_t);
+        case ARG_PTRDIFF:   return va_arg(*args, ptrdiff_t);
+        default:            return va_arg(*args, int);
+    }
+}
+
+static uint64_t unsigned_arg(va_list* args, uint8_t length) {
+    switch (length) {
+        case ARG_CHAR:      return (unsigned char)va_arg(*args, unsigned int);
+        case ARG_SHORT:     return (unsigned short)va_arg(*args, unsigned int);
+        case ARG_LONG:      return va_arg(*args, unsigned long);
+        case ARG_LONG_LONG: return va_arg(*args, unsigned long long);
+        case ARG_INTMAX:    return va_arg(*args, uintmax_t);
+        case ARG_SIZE:      return va_arg(*args, size_t);
+        case ARG_PTRDIFF:   return (size_t)va_arg(*args, ptrdiff_t);
+        default:            return va_arg(*args, unsigned int);
+    }
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_size(uint64_t value) {
+    size_t n = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Writes a varint; the caller guarantees room for it.
+ */
+static size_t write_varint(uint8_t* out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief Appends a varint at `*pos` if it fits.
+ */
+static bool put_varint(uint8_t* out, size_t capacity, size_t* pos, uint64_t value) {
+    if (*pos + varint_size(value) > capacity) return false;
+    *pos += write_varint(out + *pos, value);
+    return true;
+}
+
+/**
+ * @brief Reads a varint at `*pos`.
+ *
+ * @return False if it runs past `length` or is longer than 64 bits.
+ */
+static bool get_varint(const uint8_t* data, size_t length, size_t* pos, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *pos < length; shift += 7) {
+        uint8_t byte = data[(*pos)++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+size_t log_encode_args(uint8_t* out, size_t capacity, const char* format, va_list args) {
+    va_list ap;
+    va_copy(ap, args);
+    size_t pos = 0;
+    bool ok = true;
+
+    for (const char* p = format; ok && *p != '\0'; p++) {
+        if (*p != '%') continue;
+        Conversion c;
+        if (!parse_conversion(p + 1, &c)) break;
+        p = c.next - 1;
+        if (c.type == '%') continue;
+
+        int precision = c.precision;
+        if (c.width_star) ok = put_varint(out, capacity, &pos, zigzag(va_arg(ap, int)));
+        if (ok && c.precision_star) {
+            precision = va_arg(ap, int);
+            ok = put_varint(out, capacity, &pos, zigzag(precision));
+        }
+        if (!ok) break;
+
+        switch (c.type) {
+            case 'd':
+            case 'i':
+                ok = put_varint(out, capacity, &pos, zigzag(signed_arg(&ap, c.length)));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                ok = put_varint(out, capacity, &pos, unsigned_arg(&ap, c.length));
+                break;
+            case 'c':
+                ok = put_varint(out, capacity, &pos, (unsigned char)va_arg(ap, int));
+                break;
+            case 'p':
+                ok = put_varint(out, capacity, &pos, (uintptr_t)va_arg(ap, void*));
+                break;
+            case 'n':
+                va_arg(ap, void*);
+                break;
+            case 's': {
+                const char* text = va_arg(ap, const char*);
+                if (text == NULL) text = "(null)";
+                size_t n = 0;
+                while ((precision < 0 || n < (size_t)precision) && text[n] != '\0') n++;
+                // Shorten the string to the space left, keeping room for its length
+                size_t room = capacity - pos;
+                if (room == 0) {
+                    ok = false;
+                    break;
+                }
+                if (n > room - varint_size(room)) n = room - varint_size(room);
+                pos += write_varint(out + pos, n);
+                memcpy(out + pos, text, n);
+                pos += n;
+                break;
+            }
+            default: {
+                double value = c.length == ARG_LONG_DOUBLE ? (double)va_arg(ap, long double) : va_arg(ap, double);
+                if (pos + sizeof(value) > capacity) {
+                    ok = false;
+                    break;
+                }
+                memcpy(out + pos, &value, sizeof(value));
+                pos += sizeof(value);
+                break;
+            }
+        }
+    }
+    va_end(ap);
+    return pos;
+}
+
+size_t log_render_args(char* out, size_t capacity, const char* format, const uint8_t* args, size_t length) {
+    if (capacity == 0) return 0;
+    size_t n = 0;
+    size_t pos = 0;
+    bool missing = false;
+
+    const char* p = format;
+    while (*p != '\0' && n < capacity - 1) {
+        Conversion c;
+        if (*p != '%' || !parse_conversion(p + 1, &c)) {
+            out[n++] = *p++;
+            continue;
+        }
+        p = c.next;
+        if (c.type == '%') {
+            out[n++] = '%';
+            continue;
+        }
+
+        // Rebuild the conversion with the stars resolved and a fixed argument type
+        uint64_t value = 0;
+        int width = c.width;
+        int precision = c.precision;
+        if (!missing && c.width_star) {
+            missing = !get_varint(args, length, &pos, &value);
+            width = (int)unzigzag(value);
+        }
+        if (!missing && c.precision_star) {
+            missing = !get_varint(args, length, &pos, &value);
+            precision = (int)unzigzag(value);
+        }
+
+        char spec[48];
+        size_t s = (size_t)snprintf(spec, sizeof(spec), "%%%s", c.flags);
+        if (width >= 0 || c.width_star) s += snprintf(spec + s, sizeof(spec) - s, "%d", width);
+        if (precision >= 0 && c.type != 's') s += snprintf(spec + s, sizeof(spec) - s, ".%d", precision);
+
+        int written = 0;
+        char* at = out + n;
+        size_t room = capacity - n;
+        if (c.type == 'n') continue;
+        if (missing) {
+            written = snprintf(at, room, "?");
+        } else if (c.type == 's') {
+            uint64_t size;
+            missing = !get_varint(args, length, &pos, &size) || size > length - pos;
+            if (!missing) {
+                snprintf(spec + s, sizeof(spec) - s, ".*s");
+                written = snprintf(at, room, spec, (int)size, (const char*)args + pos);
+                pos += size;
+            }
+        } else if (strchr("fFeEgGaA", c.type) != NULL) {
+            double number;
+            missing = pos + sizeof(number) > length;
+            if (!missing) {
+                memcpy(&number, args + pos, sizeof(number));
+                pos += sizeof(number);
+                snprintf(spec + s, sizeof(spec) - s, "%c", c.type);
+                written = snprintf(at, room, spec, number);
+            }
+        } else {
+            missing = !get_varint(args, length, &pos, &value);
+            if (!missing) {
+                if (c.type == 'd' || c.type == 'i') {
+                    snprintf(spec + s, sizeof(spec) - s, "ll%c", c.type);
+                    written = snprintf(at, room, spec, (long long)unzigzag(value));
+                } else if (c.type == 'c') {
+                    snprintf(spec + s, sizeof(spec) - s, "c");
+                    written = snprintf(at, room, spec, (int)value);
+                } else if (c.type == 'p') {
+                    snprintf(spec + s, sizeof(spec) - s, "p");
+                    written = snprintf(at, room, spec, (void*)(uintptr_t)value);
+                } else {
+                    snprintf(spec + s, sizeof(spec) - s, "ll%c", c.type);
+                    written = snprintf(at, room, spec, (unsigned long long)value);
+                }
+            }
+        }
+        if (missing && written == 0) written = snprintf(at, room, "?");
+        if (written > 0) n += (size_t)written < room ? (size_t)written : room - 1;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+/**
+ * @brief Prefixes a payload built at `out + 2` with its length.
+ *
+ * @return The size of the whole record.
+ */
+static size_t finish_record(uint8_t* out, size_t payload) {
+    if (payload < 0x80) {
+        out[0] = (uint8_t)payload;
+        memmove(out + 1, out + 2, payload);
+        return payload + 1;
+    }
+    out[0] = (uint8_t)(payload | 0x80);
+    out[1] = (uint8_t)(payload >> 7);
+    return payload + 2;
+}
+
+void LogEncoder::reset() {
+    started = false;
+    entry_count = 0;
+    dictionary_bytes = 0;
+}
+
+int LogEncoder::find(const LogRecord& record, bool* found) {
+    uint32_t hash = (uint32_t)((uintptr_t)record.format >> 2) * 2654435761u;
+    hash ^= (uint32_t)record.level << 8 | record.module;
+    for (uint32_t i = 0; i < LOG_MESSAGE_IDS; i++) {
+        int slot = (hash + i) & (LOG_MESSAGE_IDS - 1);
+        const Entry& entry = entries[slot];
+        if (entry.format == NULL) {
+            *found = false;
+            return slot;
+        }
+        if (entry.format == record.format && entry.level == record.level && entry.module == record.module) {
+            *found = true;
+            return slot;
+        }
+    }
+    // Not reached: sessions restart before the table fills up
+    *found = false;
+    return -1;
+}
+
+size_t LogEncoder::begin_session(uint8_t* out, const LogRecord& record) {
+    memset(entries, 0, sizeof(entries));
+    entry_count = 0;
+    dictionary_bytes = 0;
+    started = true;
+    last_uptime = record.uptime_ms;
+    clock_set = record.time >= LOG_VALID_TIME;
+    clock_time = record.time;
+    clock_uptime = record.uptime_ms;
+
+    uint8_t* p = out + 2;
+    size_t n = write_varint(p, LOG_CODE_SESSION);
+    memcpy(p + n, LOG_SESSION_MAGIC, 4);
+    n += 4;
+    p[n++] = LOG_BINARY_VERSION;
+    n += write_varint(p + n, record.uptime_ms);
+    n += write_varint(p + n, clock_set ? record.time : 0);
+    return finish_record(out, n);
+}
+
+size_t LogEncoder::encode(uint8_t* out, size_t capacity, const LogRecord& record) {
+    if (capacity < LOG_ENCODED_MAX) return 0;
+    size_t format_length = record.format != NULL ? strlen(record.format) : 0;
+    bool text = record.format == NULL || format_length > LOG_FORMAT_MAX;
+    size_t n = 0;
+    uint8_t* p;
+    size_t m;
+
+    bool found = false;
+    int id = started && !text ? find(record, &found) : -1;
+    bool full = entry_count >= LOG_MESSAGE_IDS * 3 / 4 || dictionary_bytes + format_length + 1 > LOG_DICTIONARY_BYTES;
+    if (!started || (!text && !found && full)) {
+        n += begin_session(out, record);
+        if (!text) id = find(record, &found);
+    }
+
+    // Re-anchor the wall clock when it was set or drifted from the derived time
+    if (record.time >= LOG_VALID_TIME) {
+        uint32_t derived = clock_time + (record.uptime_ms - clock_uptime) / 1000;
+        int32_t error = (int32_t)(record.time - derived);
+        if (!clock_set || error > 1 || error < -1) {
+            p = out + n + 2;
+            m = write_varint(p, LOG_CODE_CLOCK);
+            m += write_varint(p + m, (uint32_t)(record.uptime_ms - last_uptime));
+            m += write_varint(p + m, record.time);
+            n += finish_record(out + n, m);
+            last_uptime = record.uptime_ms;
+            clock_set = true;
+            clock_time = record.time;
+            clock_uptime = record.uptime_ms;
+        }
+    }
+
+    if (!text && !found) {
+        entries[id] = {record.format, record.level, record.module};
+        entry_count++;
+        dictionary_bytes += format_length + 1;
+        p = out + n + 2;
+        m = write_varint(p, LOG_CODE_DEFINE);
+        m += write_varint(p + m, id);
+        p[m++] = record.level;
+        p[m++] = record.module;
+        memcpy(p + m, record.format, format_length);
+        m += format_length;
+        n += finish_record(out + n, m);
+    }
+
+    uint32_t delta = record.uptime_ms - last_uptime;
+    last_uptime = record.uptime_ms;
+    p = out + n + 2;
+    if (text) {
+        m = write_varint(p, LOG_CODE_TEXT);
+        m += write_varint(p + m, delta);
+        p[m++] = record.level;
+        p[m++] = record.module;
+        if (record.format != NULL) {
+            m += log_render_args((char*)p + m, LOG_RECORD_ARGS, record.format, record.args, record.length);
+        } else {
+            memcpy(p + m, record.args, record.length);
+            m += record.length;
+        }
+    } else {
+        m = write_varint(p, id);
+        m += write_varint(p + m, delta);
+        memcpy(p + m, record.args, record.length);
+        m += record.length;
+    }
+    n += finish_record(out + n, m);
+    return n;
+}
+
+void LogDecoder::reset() {
+    in_session = false;
+}
+
+LogDecodeStatus LogDecoder::decode(const uint8_t* data, size_t length, size_t* used, LogRecord* record) {
+    if (length == 0) return LOG_DECODE_INCOMPLETE;
+    size_t header = 1;
+    size_t payload = data[0] & 0x7F;
+    if (data[0] & 0x80) {
+        if (length < 2) return LOG_DECODE_INCOMPLETE;
+        if (data[1] & 0x80) return LOG_DECODE_CORRUPT;
+        payload |= (size_t)data[1] << 7;
+        header = 2;
+    }
+    if (payload == 0 || payload > LOG_ENCODED_MAX) return LOG_DECODE_CORRUPT;
+    if (header + payload > length) return LOG_DECODE_INCOMPLETE;
+
+    // A session starting inside the record means the record was cut off (power
+    // loss) and the next boot appended to the file; the session wins
+    size_t window = header + payload + 6 < length ? header + payload + 6 : length;
+    if (log_find_session(data + 1, window - 1) < header + payload - 1) return LOG_DECODE_CORRUPT;
+
+    const uint8_t* p = data + header;
+    size_t pos = 0;
+    uint64_t code;
+    uint64_t delta;
+    uint64_t value;
+    if (!get_varint(p, payload, &pos, &code)) return LOG_DECODE_CORRUPT;
+    *used = header + payload;
+
+    if (code == LOG_CODE_SESSION) {
+        if (pos + 5 > payload || memcmp(p + pos, LOG_SESSION_MAGIC, 4) != 0) return LOG_DECODE_CORRUPT;
+        if (p[pos + 4] != LOG_BINARY_VERSION) return LOG_DECODE_CORRUPT;
+        pos += 5;
+        if (!get_varint(p, payload, &pos, &delta) || !get_varint(p, payload, &pos, &value)) return LOG_DECODE_CORRUPT;
+        memset(definitions, 0, sizeof(definitions));
+        dictionary_used = 0;
+        in_session = true;
+        uptime = (uint32_t)delta;
+        clock_set = value != 0;
+        clock_time = (uint32_t)value;
+        clock_uptime = uptime;
+        return LOG_DECODE_META;
+    }
+    if (!in_session) return LOG_DECODE_CORRUPT;
+
+    if (code == LOG_CODE_DEFINE) {
+        if (!get_varint(p, payload, &pos, &value) || value >= LOG_MESSAGE_IDS || pos + 2 > payload) {
+            return LOG_DECODE_CORRUPT;
+        }
+        size_t format_length = payload - pos - 2;
+        if (format_length > LOG_FORMAT_MAX || dictionary_used + format_length + 1 > LOG_DICTIONARY_BYTES) {
+            return LOG_DECODE_CORRUPT;
+        }
+        Definition& definition = definitions[value];
+        definition.offset = (uint16_t)dictionary_used;
+        definition.level = p[pos];
+        definition.module = p[pos + 1];
+        definition.defined = true;
+        memcpy(dictionary + dictionary_used, p + pos + 2, format_length);
+        dictionary[dictionary_used + format_length] = '\0';
+        dictionary_used += format_length + 1;
+        return LOG_DECODE_META;
+    }
+
+    if (!get_varint(p, payload, &pos, &delta)) return LOG_DECODE_CORRUPT;
+    if (code == LOG_CODE_CLOCK) {
+        if (!get_varint(p, payload, &pos, &value)) return LOG_DECODE_CORRUPT;
+        uptime += (uint32_t)delta;
+        clock_set = true;
+        clock_time = (uint32_t)value;
+        clock_uptime = uptime;
+        return LOG_DECODE_META;
+    }
+
+    if (code == LOG_CODE_TEXT) {
+        if (pos + 2 > payload || payload - pos - 2 > LOG_RECORD_ARGS) return LOG_DECODE_CORRUPT;
+        record->format = NULL;
+        record->level = p[pos];
+        record->module = p[pos + 1];
+        pos += 2;
+    } else if (code < LOG_MESSAGE_IDS && definitions[code].defined) {
+        if (payload - pos > LOG_RECORD_ARGS) return LOG_DECODE_CORRUPT;
+        const Definition& definition = definitions[code];
+        record->format = dictionary + definition.offset;
+        record->level = definition.level;
+        record->module = definition.module;
+    } else {
+        return LOG_DECODE_CORRUPT;
+    }
+
+    uptime += (uint32_t)delta;
+    record->uptime_ms = uptime;
+    record->time = clock_set ? clock_time + (uptime - clock_uptime) / 1000 : 0;
+    record->length = (uint16_t)(payload - pos);
+    memcpy(record->args, p + pos, record->length);
+    return LOG_DECODE_MESSAGE;
+}
+
+size_t log_find_session(const uint8_t* data, size_t length) {
+    // Length byte, LOG_CODE_SESSION as a varint (0x80 0x01), magic
+    for (size_t i = 0; i + 7 <= length; i++) {
+        if (data[i] < 0x80 && data[i + 1] == 0x80 && data[i + 2] == 0x01 &&
+            memcmp(data + i + 3, LOG_SESSION_MAGIC, 4) == 0) {
+            return i;
+        }
+    }
+    return length;
+}
+
+void LogReader::begin(LogReadFn read, void* context) {
+    decoder.reset();
+    start = 0;
+    end = 0;
+    base = 0;
+    eof = false;
+    corrupt = 0;
+    read_fn = read;
+    read_context = context;
+}
+
+void LogReader::resume(LogReadFn read, void* context) {
+    eof = false;
+    read_fn = read;
+    read_context = context;
+}
+
+bool LogReader::fill() {
+    if (eof) return false;
+    memmove(buffer, buffer + start, end - start);
+    base += start;
+    end -= start;
+    start = 0;
+    size_t n = end < sizeof(buffer) ? read_fn(read_context, buffer + end, sizeof(buffer) - end) : 0;
+    if (n == 0) {
+        eof = true;
+        return false;
+    }
+    end += n;
+    return true;
+}
+
+bool LogReader::next(LogRecord* record) {
+    while (true) {
+        size_t used = 0;
+        switch (decoder.decode(buffer + start, end - start, &used, record)) {
+            case LOG_DECODE_MESSAGE:
+                start += used;
+                return true;
+            case LOG_DECODE_META:
+                start += used;
+                break;
+            case LOG_DECODE_INCOMPLETE:
+                if (!fill()) {
+                    // The file ends inside a record, e.g. cut off by a power loss
+                    corrupt += end - start;
+                    start = end;
+                    return false;
+                }
+                break;
+            case LOG_DECODE_CORRUPT: {
+                // A session record needs 7 bytes in view to be recognized
+                if (end - start < 8 && fill()) break;
+                decoder.reset();
+                size_t skip = 1 + log_find_session(buffer + start + 1, end - start - 1);
+                // Without a session in view, keep a tail that may start one
+                if (start + skip == end && skip > 7) skip -= 6;
+                corrupt += skip;
+                start += skip;
+                break;
+            }
+        }
+    }
+}
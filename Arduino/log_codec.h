@@ -0,0 +1,274 @@
+/**
+ * @file log_codec.h
+ * @brief Deferred message formatting and the compact binary log file format.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Log calls do not format their message. `log_encode_args()` walks the printf
+ * format and packs the arguments (varints, zigzag for signed values, doubles
+ * as 8 bytes, strings as a length and the bytes); the record keeps a pointer
+ * to the format literal. `log_render_args()` turns format and arguments back
+ * into text whenever text is needed.
+ *
+ * In the binary log file every record is a varint payload length followed by
+ * the payload, which starts with a varint code:
+ *
+ *   code < LOG_MESSAGE_IDS  message: uptime delta, packed arguments
+ *   LOG_CODE_SESSION        "FCLG", version, uptime, wall clock; resets all state
+ *   LOG_CODE_DEFINE         message ID, level, module, format string
+ *   LOG_CODE_CLOCK          uptime delta, wall clock seconds at that uptime
+ *   LOG_CODE_TEXT           uptime delta, level, module, plain text
+ *
+ * Message IDs are interned at runtime: the first time a format (with its
+ * level and module) occurs in a session, a DEFINE record carries its text.
+ * Each message stores only the milliseconds since the previous record; wall
+ * clock time is derived from the last CLOCK record, which is repeated only
+ * when the derived time is off by more than a second (e.g. after NTP sync).
+ * A session starts with every opened file and when the dictionary fills up,
+ * so a reader needs no state from earlier files. Decoders resynchronize on
+ * the next session after a damaged or truncated record.
+ *
+ * Both ends are pure C++: the firmware renders records for the web log view
+ * and SSH, and tools/log_decode turns log files into text on a host. Values
+ * are stored little-endian, as on both the ESP32 and x86 hosts.
+ */
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include "version.h"
+#include "logger.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Distinct messages per session; the session restarts when 3/4 are in use
+#define LOG_MESSAGE_IDS         128
+
+// Meta record codes, above the message IDs
+#define LOG_CODE_SESSION        128
+#define LOG_CODE_DEFINE         129
+#define LOG_CODE_CLOCK          130
+#define LOG_CODE_TEXT           131
+
+#define LOG_SESSION_MAGIC       "FCLG"
+#define LOG_BINARY_VERSION      1
+
+// Longest format interned; longer formats are stored as rendered text
+#define LOG_FORMAT_MAX          LOG_MESSAGE_MAX
+
+// Format text per session, bounded so decoders need a fixed dictionary
+#define LOG_DICTIONARY_BYTES    6144
+
+// Largest output of one LogEncoder::encode() call (session, clock, define and message)
+#define LOG_ENCODED_MAX         (64 + LOG_FORMAT_MAX + LOG_RECORD_ARGS)
+
+/**
+ * @brief Packs the arguments of a printf-style call.
+ *
+ * If the arguments do not fit, the last string is shortened and any further
+ * arguments are left out; they render as "?".
+ *
+ * @param out Output buffer.
+ * @param capacity Size of the output buffer.
+ * @param format printf-style format.
+ * @param args The arguments of `format`.
+ * @return The number of bytes written.
+ */
+size_t log_encode_args(uint8_t* out, size_t capacity, const char* format, va_list args);
+
+/**
+ * @brief Renders a format with arguments packed by log_encode_args().
+ *
+ * @param out Output buffer; always NUL-terminated if `capacity` > 0.
+ * @param capacity Size of the output buffer.
+ * @param format The format the arguments were packed for.
+ * @param args Packed arguments.
+ * @param length Size of the packed arguments.
+ * @return The text length, at most `capacity` - 1.
+ */
+size_t log_render_args(char* out, size_t capacity, const char* format, const uint8_t* args, size_t length);
+
+/**
+ * @class LogEncoder
+ * @brief Writer side of the binary log format: sessions, dictionary, time base.
+ */
+class LogEncoder {
+public:
+    LogEncoder() { reset(); }
+
+    /**
+     * @brief Forgets all state; the next record starts a new session.
+     *
+     * Call whenever the output continues in a new or reopened file.
+     */
+    void reset();
+
+    /**
+     * @brief Encodes one log record, with the meta records it needs first.
+     *
+     * @param out Output buffer.
+     * @param capacity Size of the output buffer, at least LOG_ENCODED_MAX.
+     * @param record The record to encode.
+     * @return The number of bytes written, 0 if `capacity` is too small.
+     */
+    size_t encode(uint8_t* out, size_t capacity, const LogRecord& record);
+
+private:
+    struct Entry {
+        const char* format;     // NULL for a free slot
+        uint8_t level;
+        uint8_t module;
+    };
+
+    int find(const LogRecord& record, bool* found);
+    size_t begin_session(uint8_t* out, const LogRecord& record);
+
+    Entry entries[LOG_MESSAGE_IDS];
+    uint16_t entry_count;
+    size_t dictionary_bytes;
+    bool started;
+    uint32_t last_uptime;       // Uptime the next delta is relative to
+    bool clock_set;
+    uint32_t clock_time;        // Wall clock seconds at clock_uptime
+    uint32_t clock_uptime;
+};
+
+/**
+ * @enum LogDecodeStatus
+ * @brief Outcome of LogDecoder::decode().
+ */
+enum LogDecodeStatus : uint8_t {
+    LOG_DECODE_MESSAGE = 0,     // A message was decoded into the record
+    LOG_DECODE_META,            // A session, define or clock record was consumed
+    LOG_DECODE_INCOMPLETE,      // More bytes are needed for the next record
+    LOG_DECODE_CORRUPT          // Invalid record; resynchronize with log_find_session()
+};
+
+/**
+ * @class LogDecoder
+ * @brief Reader side of the binary log format.
+ *
+ * Holds the dictionary of the current session; decoded records point into it,
+ * so they stay valid until the next session starts.
+ */
+class LogDecoder {
+public:
+    LogDecoder() { reset(); }
+
+    /**
+     * @brief Forgets the session; records are rejected until the next session.
+     */
+    void reset();
+
+    /**
+     * @brief Decodes the record at the start of `data`.
+     *
+     * @param data Bytes of the log file.
+     * @param length Number of bytes available.
+     * @param used Set to the bytes consumed for MESSAGE and META.
+     * @param record Filled for MESSAGE; `format` is NULL for plain text records.
+     * @return The outcome.
+     */
+    LogDecodeStatus decode(const uint8_t* data, size_t length, size_t* used, LogRecord* record);
+
+private:
+    struct Definition {
+        uint16_t offset;        // Format text in `dictionary`
+        uint8_t level;
+        uint8_t module;
+        bool defined;
+    };
+
+    Definition definitions[LOG_MESSAGE_IDS];
+    char dictionary[LOG_DICTIONARY_BYTES];
+    size_t dictionary_used;
+    bool in_session;
+    uint32_t uptime;
+    bool clock_set;
+    uint32_t clock_time;
+    uint32_t clock_uptime;
+};
+
+/**
+ * @brief Finds the next session record, to resynchronize after corruption.
+ *
+ * @return The offset of the session record, or `length` if none starts in `data`.
+ */
+size_t log_find_session(const uint8_t* data, size_t length);
+
+/**
+ * @brief Reads more bytes of a log file into `buffer`.
+ *
+ * @return The number of bytes read, 0 at the end of the file.
+ */
+typedef size_t (*LogReadFn)(void* context, uint8_t* buffer, size_t size);
+
+// Read buffer of LogReader; holds at least one whole record
+#define LOG_READ_BUFFER         1024
+
+/**
+ * @class LogReader
+ * @brief Iterates over the messages of a binary log file read in chunks.
+ *
+ * Skips meta records, and damaged bytes up to the next session.
+ */
+class LogReader {
+public:
+    /**
+     * @brief Starts reading a file from its current position.
+     *
+     * @param read Reads the next bytes of the file.
+     * @param context Passed to `read`.
+     */
+    void begin(LogReadFn read, void* context);
+
+    /**
+     * @brief Continues after the last message with a new read function, e.g. on a reopened file.
+     *
+     * Keeps the session and the buffered bytes; `read` must go on from
+     * read_offset(), and may find bytes appended since.
+     */
+    void resume(LogReadFn read, void* context);
+
+    /**
+     * @brief Decodes the next message.
+     *
+     * @param record Filled with the message; valid until the next call.
+     * @return False at the end of the file.
+     */
+    bool next(LogRecord* record);
+
+    /**
+     * @brief Bytes skipped as damaged or truncated so far.
+     */
+    uint32_t corrupt_bytes() const { return corrupt; }
+
+    /**
+     * @brief Bytes since begin() up to the end of the last message returned.
+     *
+     * A reader started again at the same place finds that message ending at
+     * this position, so a query can resume after it.
+     */
+    uint32_t position() const { return base + start; }
+
+    /**
+     * @brief Bytes since begin() taken from the read functions so far.
+     */
+    uint32_t read_offset() const { return base + end; }
+
+private:
+    bool fill();
+
+    LogDecoder decoder;
+    uint8_t buffer[LOG_READ_BUFFER];
+    size_t start;
+    size_t end;
+    uint32_t base;              // File bytes before buffer[0]
+    bool eof;
+    uint32_t corrupt;
+    LogReadFn read_fn;
+    void* read_context;
+};
+
+#endif // LOG_CODEC_H
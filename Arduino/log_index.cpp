@@ -0,0 +1,91 @@
+/**
+ * @file log_index.cpp
+ * @brief Implementation of the sparse log index.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "log_index.h"
+#include "version.h"
+#include "logger.h"
+#include "log_segments.h"
+#include <stdio.h>
+#include <string.h>
+
+size_t log_index_path(char* out, size_t capacity, uint32_t seq) {
+    int n = snprintf(out, capacity, LOG_SEGMENT_DIR "/%08lu.idx", (unsigned long)seq);
+    if (n < 0) return 0;
+    return (size_t)n < capacity ? (size_t)n : capacity - 1;
+}
+
+/**
+ * @brief Binary search for the last entry whose key is at or before `key`.
+ *
+ * An entry without a time, e.g. after a reopen before the clock was set, is
+ * judged by the next timed entry; the untimed ones in front of it were
+ * logged before it.
+ */
+static size_t find_last(LogIndexReadFn read, void* context, size_t count, uint32_t key, bool by_time) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        size_t probe = middle;
+        LogIndexEntry entry;
+        bool ok = read(context, probe, &entry);
+        while (ok && by_time && entry.time == 0 && probe + 1 < high) {
+            ok = read(context, ++probe, &entry);
+        }
+        if (!ok) {
+            // Unreadable tail, e.g. cut off by a reset: search before it
+            high = probe;
+            continue;
+        }
+        uint32_t value = by_time ? entry.time : entry.offset;
+        if (by_time && value == 0) {
+            // Nothing but untimed entries up to `high`: none of them is known to be early enough
+            high = middle;
+        } else if (value <= key) {
+            low = probe + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low > 0 ? low - 1 : count;
+}
+
+size_t log_index_find_time(LogIndexReadFn read, void* context, size_t count, uint32_t time) {
+    return find_last(read, context, count, time, true);
+}
+
+size_t log_index_find_offset(LogIndexReadFn read, void* context, size_t count, uint32_t offset) {
+    return find_last(read, context, count, offset, false);
+}
+
+void LogIndexer::restart() {
+    count = 0;
+    since_mark = 0;
+    due = true;
+}
+
+bool LogIndexer::mark(uint32_t time, size_t position) {
+    if (!due && since_mark < LOG_INDEX_STRIDE) return false;
+    // Without room the record is left out of the index; the index is sparse anyway
+    if (count == LOG_INDEX_PENDING) return false;
+    pending[count++] = {time >= LOG_VALID_TIME ? time : 0, (uint32_t)position};
+    since_mark = 0;
+    due = false;
+    return true;
+}
+
+size_t LogIndexer::take(size_t size, uint32_t offset, LogIndexEntry* out, size_t capacity) {
+    size_t taken = 0;
+    while (taken < count && pending[taken].offset < size) {
+        if (taken < capacity) out[taken] = {pending[taken].time, offset + pending[taken].offset};
+        taken++;
+    }
+    count -= taken;
+    memmove(pending, pending + taken, count * sizeof(LogIndexEntry));
+    for (size_t i = 0; i < count; i++) pending[i].offset -= (uint32_t)size;
+    return taken < capacity ? taken : capacity;
+}
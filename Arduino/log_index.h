@@ -0,0 +1,131 @@
+/**
+ * @file log_index.h
+ * @brief Sparse time index of the SD log segments.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Next to each segment the writer keeps "00000042.idx", an array of
+ * LogIndexEntry: the wall clock time of a record and its byte offset in the
+ * segment. A segment gets an entry for its first record, for the first record
+ * after a reopen, and then for the first record after every LOG_INDEX_STRIDE
+ * bytes. In binary segments every index point also starts a new session, so
+ * a reader can decode from any entry without the rest of the file.
+ *
+ * Queries seek with a binary search over the entries and read at most a
+ * stride of the segment before the first line they need: the last lines are
+ * read one stride at a time from the end, a time range from the entry before
+ * its start. The index file is appended after the log bytes it points to; an
+ * entry beyond the end of the segment, e.g. after a reset, is ignored.
+ */
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include "version.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Segment bytes between two index points
+#define LOG_INDEX_STRIDE        8192
+
+// Index points waiting for their batch to be written
+#define LOG_INDEX_PENDING       8
+
+/**
+ * @struct LogIndexEntry
+ * @brief One index point, stored as is (little-endian) in the index file.
+ */
+struct LogIndexEntry {
+    uint32_t time;              // Wall clock time of the record, 0 if the clock was not set
+    uint32_t offset;            // Offset of the record in the segment
+};
+
+static_assert(sizeof(LogIndexEntry) == 8, "index entries are stored as 8 bytes");
+
+/**
+ * @brief Writes the path of the index of a segment.
+ *
+ * @param out Output buffer, at least LOG_SEGMENT_PATH_MAX bytes.
+ * @param capacity Size of the output buffer.
+ * @param seq Sequence number of the segment.
+ * @return The path length.
+ */
+size_t log_index_path(char* out, size_t capacity, uint32_t seq);
+
+/**
+ * @brief Reads entry `index` of an index file.
+ *
+ * @return False if it cannot be read.
+ */
+typedef bool (*LogIndexReadFn)(void* context, size_t index, LogIndexEntry* entry);
+
+/**
+ * @brief Finds the last entry with a time at or before `time`.
+ *
+ * Times are taken to rise through the file; an entry without a time counts
+ * as late as the next timed entry, or as after `time` if none follows.
+ *
+ * @return The entry, or `count` if all entries are later.
+ */
+size_t log_index_find_time(LogIndexReadFn read, void* context, size_t count, uint32_t time);
+
+/**
+ * @brief Finds the last entry with an offset at or before `offset`.
+ *
+ * @return The entry, or `count` if all entries are later.
+ */
+size_t log_index_find_offset(LogIndexReadFn read, void* context, size_t count, uint32_t offset);
+
+/**
+ * @class LogIndexer
+ * @brief Writer side: picks the index points of the records in the batch buffer.
+ *
+ * Records are placed in the batch buffer before the file offset they will be
+ * written at is known. The indexer remembers index points by their position
+ * in the batch and turns them into entries once that part of the batch is
+ * written.
+ */
+class LogIndexer {
+public:
+    LogIndexer() { restart(); }
+
+    /**
+     * @brief Forgets the pending index points and makes the next record one.
+     *
+     * Call for a new or reopened file and when the buffered records are dropped.
+     */
+    void restart();
+
+    /**
+     * @brief Decides whether the next record is an index point.
+     *
+     * @param time Wall clock time of the record.
+     * @param position Where the record goes in the batch buffer.
+     * @return True if it is; a binary record must then start a new session.
+     */
+    bool mark(uint32_t time, size_t position);
+
+    /**
+     * @brief Counts the bytes of the record just appended to the batch buffer.
+     */
+    void appended(size_t bytes) { since_mark += bytes; }
+
+    /**
+     * @brief Takes the entries for the start of the batch buffer once it is written.
+     *
+     * @param size Bytes written from the start of the batch buffer.
+     * @param offset File offset they were written at.
+     * @param out Receives the entries; room for LOG_INDEX_PENDING always suffices.
+     * @param capacity Room in `out`.
+     * @return The number of entries; index points after `size` move down with the batch.
+     */
+    size_t take(size_t size, uint32_t offset, LogIndexEntry* out, size_t capacity);
+
+private:
+    LogIndexEntry pending[LOG_INDEX_PENDING];   // offset is the position in the batch
+    size_t count;
+    size_t since_mark;
+    bool due;
+};
+
+#endif // LOG_INDEX_H
@@ -0,0 +1,85 @@
+/**
+ * @file log_ring.cpp
+ * @brief Implementation of the lock-free log record ring.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * A cell whose sequence equals the enqueue position is free for that
+ * position; a producer claims it by advancing the position and publishes it by
+ * setting the sequence to position + 1. A consumer takes the cell at the
+ * dequeue position once its sequence is position + 1 and frees it for the
+ * next lap by setting it to position + LOG_RING_SLOTS.
+ */
+#include "log_ring.h"
+#include "version.h"
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+LogRing::LogRing() {
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+LogRecord* LogRing::reserve() {
+    uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & (LOG_RING_SLOTS - 1)];
+        int32_t diff = (int32_t)(cell.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &cell.record;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+LogRing::Cell* LogRing::cell_of(LogRecord* record) {
+    return &cells[((char*)record - (char*)&cells[0].record) / sizeof(Cell)];
+}
+
+void LogRing::commit(LogRecord* record) {
+    Cell* cell = cell_of(record);
+    uint32_t pos = cell->sequence.load(std::memory_order_relaxed);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+}
+
+LogRecord* LogRing::acquire() {
+    uint32_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & (LOG_RING_SLOTS - 1)];
+        int32_t diff = (int32_t)(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &cell.record;
+            }
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogRing::release(LogRecord* record) {
+    Cell* cell = cell_of(record);
+    // The cell was published as pos + 1; free it for position pos + LOG_RING_SLOTS
+    uint32_t pos = cell->sequence.load(std::memory_order_relaxed) - 1;
+    cell->sequence.store(pos + LOG_RING_SLOTS, std::memory_order_release);
+}
+
+size_t log_batch_size(uint32_t file_size, size_t buffered, bool force) {
+    if (force) return buffered;
+    if (buffered < LOG_BATCH_MIN) return 0;
+
+    // The largest write up to LOG_BATCH_MAX that ends on a sector boundary
+    size_t limit = buffered < LOG_BATCH_MAX ? buffered : LOG_BATCH_MAX;
+    uint32_t end = (uint32_t)((file_size + limit) / LOG_SECTOR_SIZE * LOG_SECTOR_SIZE);
+    return end > file_size ? end - file_size : 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file log_ring.h
+ * @brief Lock-free multi-producer log record ring and SD write batching.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Any task (network event handlers, the LED task, SNMP callbacks) reserves a
+ * record slot, fills it and commits it, without taking a lock and without
+ * waiting for the SD card. When the ring is full the message is counted as
+ * dropped instead of blocking the caller. The SD writer task takes the
+ * records out in order and writes them in large batches. Each slot carries a
+ * sequence number, so producers and consumers only ever contend on one
+ * compare-and-swap of a position counter.
+ */
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "version.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Record slots in the ring (power of two)
+#define LOG_RING_SLOTS          64
+
+// Packed message arguments per record (log_codec.h); longer ones are cut
+#define LOG_RECORD_ARGS         120
+
+// SD write batching: writes are whole sectors between the minimum and the
+// maximum size; anything left is written once it is older than the flush age
+#define LOG_SECTOR_SIZE         512
+#define LOG_BATCH_MIN           4096
+#define LOG_BATCH_MAX           16384
+#define LOG_FLUSH_AGE_MS        2000
+
+/**
+ * @struct LogRecord
+ * @brief One log message waiting for the SD writer.
+ */
+struct LogRecord {
+    uint32_t time;              // Wall clock seconds (time_t) when logged
+    uint32_t uptime_ms;         // millis() when logged
+    const char* format;         // printf format literal, NULL if `args` is plain text
+    uint8_t level;              // LOG_LEVEL_* (logger.h)
+    uint8_t module;             // LogModule (logger.h)
+    uint16_t length;            // Bytes used in `args`
+    uint8_t args[LOG_RECORD_ARGS];
+};
+
+/**
+ * @class LogRing
+ * @brief Bounded multi-producer, multi-consumer ring of log records.
+ */
+class LogRing {
+public:
+    LogRing();
+
+    /**
+     * @brief Claims a free slot for a new record.
+     *
+     * @return The slot to fill, or nullptr if the ring is full (the message
+     *         is counted as dropped).
+     */
+    LogRecord* reserve();
+
+    /**
+     * @brief Hands a filled slot from `reserve()` to the consumers.
+     */
+    void commit(LogRecord* record);
+
+    /**
+     * @brief Takes the oldest committed record.
+     *
+     * @return The record, or nullptr if none is ready.
+     */
+    LogRecord* acquire();
+
+    /**
+     * @brief Returns a slot from `acquire()` to the producers.
+     */
+    void release(LogRecord* record);
+
+    /**
+     * @brief Returns and resets the number of messages dropped on a full ring.
+     */
+    uint32_t take_dropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
+    Cell* cell_of(LogRecord* record);
+
+    Cell cells[LOG_RING_SLOTS];
+    std::atomic<uint32_t> enqueue_pos{0};
+    std::atomic<uint32_t> dequeue_pos{0};
+    std::atomic<uint32_t> dropped{0};
+};
+
+/**
+ * @brief Chooses how many buffered bytes to write to the log file now.
+ *
+ * Writes only end on a sector boundary of the file, so the card never has to
+ * read-modify-write a partial sector, unless a flush is forced.
+ *
+ * @param file_size The current size of the log file.
+ * @param buffered Bytes waiting in the batch buffer.
+ * @param force Write everything (flush age reached or shutdown).
+ * @return The number of bytes to write, 0 to keep buffering.
+ */
+size_t log_batch_size(uint32_t file_size, size_t buffered, bool force);
+
+#endif // LOG_RING_H
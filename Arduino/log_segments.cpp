@@ -0,0 +1,95 @@
+/**
+ * @file log_segments.cpp
+ * @brief Implementation of the SD log segment table.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The table is a sorted array: segments are found in directory order at
+ * boot, but afterwards only ever added at the new end and removed at the old
+ * end.
+ */
+#include "log_segments.h"
+#include "version.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_SEGMENT_DIGITS      8
+
+size_t log_segment_path(char* out, size_t capacity, uint32_t seq, bool binary) {
+    int n = snprintf(out, capacity, LOG_SEGMENT_DIR "/%08lu.%s", (unsigned long)seq, binary ? "bin" : "log");
+    if (n < 0) return 0;
+    return (size_t)n < capacity ? (size_t)n : capacity - 1;
+}
+
+bool log_segment_parse(const char* name, uint32_t* seq, bool* binary) {
+    const char* base = strrchr(name, '/');
+    base = base != NULL ? base + 1 : name;
+    if (strlen(base) != LOG_SEGMENT_DIGITS + 4 || base[LOG_SEGMENT_DIGITS] != '.') return false;
+
+    uint32_t value = 0;
+    for (int i = 0; i < LOG_SEGMENT_DIGITS; i++) {
+        if (base[i] < '0' || base[i] > '9') return false;
+        value = value * 10 + (uint32_t)(base[i] - '0');
+    }
+    const char* extension = base + LOG_SEGMENT_DIGITS + 1;
+    if (strcasecmp(extension, "log") == 0) {
+        *binary = false;
+    } else if (strcasecmp(extension, "bin") == 0) {
+        *binary = true;
+    } else {
+        return false;
+    }
+    *seq = value;
+    return value > 0;
+}
+
+bool log_segment_due(uint32_t bytes, uint32_t age_ms, uint32_t max_bytes, uint32_t max_age_ms) {
+    if (max_bytes > 0 && bytes >= max_bytes) return true;
+    return max_age_ms > 0 && age_ms >= max_age_ms;
+}
+
+void LogSegments::clear() {
+    used = 0;
+    total = 0;
+}
+
+bool LogSegments::add(const LogSegment& segment, LogSegment* evicted) {
+    if (used == LOG_SEGMENTS_MAX) {
+        if (segment.seq < segments[0].seq) {
+            *evicted = segment;
+            return false;
+        }
+        *evicted = segments[0];
+        remove_oldest();
+        add(segment, evicted);
+        return false;
+    }
+
+    // Insert in order; the new end unless read from the directory
+    size_t index = used;
+    while (index > 0 && segments[index - 1].seq > segment.seq) index--;
+    memmove(&segments[index + 1], &segments[index], (used - index) * sizeof(LogSegment));
+    segments[index] = segment;
+    used++;
+    total += segment.bytes;
+    return true;
+}
+
+void LogSegments::remove_oldest() {
+    if (used == 0) return;
+    total -= segments[0].bytes;
+    used--;
+    memmove(&segments[0], &segments[1], used * sizeof(LogSegment));
+}
+
+void LogSegments::set_newest_bytes(uint32_t bytes) {
+    if (used == 0) return;
+    total = total - segments[used - 1].bytes + bytes;
+    segments[used - 1].bytes = bytes;
+}
+
+bool LogSegments::over_budget(uint64_t budget) const {
+    if (used <= 1) return false;
+    return total > budget || used == LOG_SEGMENTS_MAX;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file log_segments.h
+ * @brief Numbered SD log segments and the retention budget.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The SD log is a series of files in LOG_SEGMENT_DIR named by an increasing
+ * sequence number, "00000042.log" for text and "00000042.bin" for the binary
+ * format (log_codec.h). Only the newest segment is ever written. The writer
+ * starts the next segment once the current one reaches SD.LOG_SEGMENT_KB or
+ * has been written to for SD.LOG_SEGMENT_HOURS, and deletes the oldest
+ * segments while all of them together exceed SD.LOG_RETAIN_MB.
+ *
+ * Rotating never renames or rewrites a file: the current segment is written
+ * out and closed, then the next number is created. A reset at any point
+ * leaves complete older segments and a newest one that is simply appended
+ * to after the restart, so at most the unwritten batch is lost.
+ */
+#ifndef LOG_SEGMENTS_H
+#define LOG_SEGMENTS_H
+
+#include "version.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Directory of the log segments on the SD card
+#define LOG_SEGMENT_DIR         "/logs"
+
+// Segments tracked; beyond this the oldest are deleted regardless of size
+#define LOG_SEGMENTS_MAX        128
+
+// LogSegment::first_time before the index of the segment was read
+#define LOG_SEGMENT_TIME_UNREAD UINT32_MAX
+
+// Longest segment path, "/logs/00000042.log" and the NUL
+#define LOG_SEGMENT_PATH_MAX    32
+
+/**
+ * @struct LogSegment
+ * @brief One log file on the card.
+ */
+struct LogSegment {
+    uint32_t seq;               // Sequence number, the file name
+    uint32_t bytes;             // File size
+    bool binary;                // Binary log format (.bin) rather than text (.log)
+    uint32_t first_time;        // Time of the first index entry (log_index.h), LOG_SEGMENT_TIME_UNREAD if not read yet
+};
+
+/**
+ * @brief Writes the path of a segment.
+ *
+ * @param out Output buffer, at least LOG_SEGMENT_PATH_MAX bytes.
+ * @param capacity Size of the output buffer.
+ * @param seq Sequence number.
+ * @param binary Binary log format.
+ * @return The path length.
+ */
+size_t log_segment_path(char* out, size_t capacity, uint32_t seq, bool binary);
+
+/**
+ * @brief Recognizes a segment file name.
+ *
+ * @param name File name, with or without the directory.
+ * @param seq Set to the sequence number.
+ * @param binary Set to whether the segment is in the binary format.
+ * @return False if the name is not a log segment.
+ */
+bool log_segment_parse(const char* name, uint32_t* seq, bool* binary);
+
+/**
+ * @brief Whether the segment being written should be closed for a new one.
+ *
+ * @param bytes Size the segment will have with the buffered messages.
+ * @param age_ms Time since the first record of the segment.
+ * @param max_bytes Segment size limit, 0 for none.
+ * @param max_age_ms Segment age limit, 0 for none.
+ */
+bool log_segment_due(uint32_t bytes, uint32_t age_ms, uint32_t max_bytes, uint32_t max_age_ms);
+
+/**
+ * @class LogSegments
+ * @brief The segments on the card, oldest first.
+ */
+class LogSegments {
+public:
+    LogSegments() { clear(); }
+
+    void clear();
+
+    /**
+     * @brief Adds a segment found on the card or just created.
+     *
+     * When the table is full, the oldest of its segments and the new one is
+     * left out and returned in `evicted`, so the caller can delete that file.
+     *
+     * @return False if a segment was evicted.
+     */
+    bool add(const LogSegment& segment, LogSegment* evicted);
+
+    /**
+     * @brief Forgets the oldest segment, once its file is deleted.
+     */
+    void remove_oldest();
+
+    /**
+     * @brief Sets the size of the newest segment after a write.
+     */
+    void set_newest_bytes(uint32_t bytes);
+
+    /**
+     * @brief Caches the time of the first index entry of segment `index`.
+     */
+    void set_first_time(size_t index, uint32_t time) { segments[index].first_time = time; }
+
+    size_t count() const { return used; }
+
+    /**
+     * @brief The segment at `index`, 0 for the oldest.
+     */
+    const LogSegment& at(size_t index) const { return segments[index]; }
+
+    /**
+     * @brief The segment being written, NULL if there is none.
+     */
+    const LogSegment* newest() const { return used > 0 ? &segments[used - 1] : nullptr; }
+
+    /**
+     * @brief Sequence number for a new segment.
+     */
+    uint32_t next_seq() const { return used > 0 ? segments[used - 1].seq + 1 : 1; }
+
+    /**
+     * @brief Bytes of all segments together.
+     */
+    uint64_t total_bytes() const { return total; }
+
+    /**
+     * @brief Whether the oldest segment has to go to stay within `budget` bytes.
+     *
+     * The newest segment is never due, even if it alone exceeds the budget.
+     */
+    bool over_budget(uint64_t budget) const;
+
+private:
+    LogSegment segments[LOG_SEGMENTS_MAX];
+    size_t used;
+    uint64_t total;
+};
+
+#endif // LOG_SEGMENTS_H
@@ -0,0 +1,129 @@
+/**
+ * @file logger.cpp
+ * @brief Level and module names and the text rendering of log records.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "logger.h"
+#include "version.h"
+#include "log_codec.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const module_names[LOG_MODULE_COUNT] = {
+    "SYS", "CONFIG", "NET", "LED", "SERVO", "MODBUS", "SD", "WEB", "SNMP", "SSH"
+};
+
+char log_level_letter(uint8_t level) {
+    static const char letters[] = {'E', 'W', 'I', 'D'};
+    return level < sizeof(letters) ? letters[level] : '?';
+}
+
+const char* log_module_name(uint8_t module) {
+    return module < LOG_MODULE_COUNT ? module_names[module] : "?";
+}
+
+size_t log_format_line(char* out, size_t capacity, const LogRecord& record) {
+    int n;
+    if (record.time >= LOG_VALID_TIME) {
+        struct tm timeinfo;
+        time_t timestamp = record.time;
+        localtime_r(&timestamp, &timeinfo);
+        char date[20];
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        n = snprintf(out, capacity, "[%s] %c %s: ", date, log_level_letter(record.level),
+                     log_module_name(record.module));
+    } else {
+        n = snprintf(out, capacity, "[+%lu.%03lu] %c %s: ", (unsigned long)(record.uptime_ms / 1000),
+                     (unsigned long)(record.uptime_ms % 1000), log_level_letter(record.level),
+                     log_module_name(record.module));
+    }
+    if (n < 0) return 0;
+
+    size_t length = (size_t)n < capacity ? (size_t)n : capacity - 1;
+    size_t room = capacity - length - 1;
+    if (room > LOG_MESSAGE_MAX + 1) room = LOG_MESSAGE_MAX + 1;
+    if (record.format != NULL) {
+        length += log_render_args(out + length, room, record.format, record.args, record.length);
+    } else {
+        size_t text = record.length;
+        if (text + 1 > room) text = room > 0 ? room - 1 : 0;
+        memcpy(out + length, record.args, text);
+        length += text;
+    }
+    if (length < capacity) out[length++] = '\n';
+    return length;
+}
+
+/**
+ * @brief Reads `count` decimal digits.
+ */
+static bool read_digits(const char* text, int count, int* value) {
+    *value = 0;
+    for (int i = 0; i < count; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        *value = *value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+static uint32_t local_time(int year, int month, int day, int hour, int minute, int second) {
+    struct tm timeinfo = {};
+    timeinfo.tm_year = year - 1900;
+    timeinfo.tm_mon = month - 1;
+    timeinfo.tm_mday = day;
+    timeinfo.tm_hour = hour;
+    timeinfo.tm_min = minute;
+    timeinfo.tm_sec = second;
+    timeinfo.tm_isdst = -1;
+    return (uint32_t)mktime(&timeinfo);
+}
+
+bool log_line_time(const char* line, size_t length, uint32_t* time) {
+    // "[2024-05-01 14:03:07]"
+    int year, month, day, hour, minute, second;
+    if (length < 21 || line[0] != '[' || line[5] != '-' || line[8] != '-' || line[11] != ' ' ||
+        line[14] != ':' || line[17] != ':' || line[20] != ']') {
+        return false;
+    }
+    if (!read_digits(line + 1, 4, &year) || !read_digits(line + 6, 2, &month) || !read_digits(line + 9, 2, &day) ||
+        !read_digits(line + 12, 2, &hour) || !read_digits(line + 15, 2, &minute) ||
+        !read_digits(line + 18, 2, &second)) {
+        return false;
+    }
+    *time = local_time(year, month, day, hour, minute, second);
+    return true;
+}
+
+bool log_parse_time(const char* text, uint32_t now, uint32_t* time) {
+    int year, month, day, hour, minute, second = 0;
+    int end = 0;
+    unsigned long seconds;
+
+    if (sscanf(text, "%4d-%2d-%2d%*1[ T]%2d:%2d%n:%2d%n", &year, &month, &day, &hour, &minute, &end, &second, &end) >= 5 &&
+        text[end] == '\0') {
+        *time = local_time(year, month, day, hour, minute, second);
+        return true;
+    }
+
+    end = 0;
+    second = 0;
+    if (sscanf(text, "%2d:%2d%n:%2d%n", &hour, &minute, &end, &second, &end) >= 2 && text[end] == '\0') {
+        struct tm today;
+        time_t timestamp = now;
+        localtime_r(&timestamp, &today);
+        *time = local_time(today.tm_year + 1900, today.tm_mon + 1, today.tm_mday, hour, minute, second);
+        // A time later today means yesterday
+        if (*time > now) *time = local_time(today.tm_year + 1900, today.tm_mon + 1, today.tm_mday - 1, hour, minute, second);
+        return true;
+    }
+
+    end = 0;
+    if (sscanf(text, "%lu%n", &seconds, &end) == 1 && text[end] == '\0') {
+        *time = (uint32_t)seconds;
+        return true;
+    }
+    return false;
+}
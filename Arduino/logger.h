@@ -0,0 +1,137 @@
+/**
+ * @file logger.h
+ * @brief Allocation-free, leveled log API for all modules.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The LOG_* macros take a module ID and a printf-style format. The caller only
+ * packs the arguments into a preallocated slot of the log ring (log_ring.h)
+ * together with the format pointer, level, module and timestamps; no String,
+ * no heap allocation and no formatting is involved. The SD log writer
+ * (sd_tasks.cpp) renders the slots into text lines, or stores them in the
+ * binary log format (log_codec.h), later. Formats must therefore be string
+ * literals.
+ *
+ * Messages above LOG_LEVEL are removed at compile time: their arguments are
+ * not even evaluated. Set the level with a build flag, e.g. -DLOG_LEVEL=3 to
+ * include debug messages.
+ *
+ * The level and module names and the line formatting are pure C++, so host
+ * tools can render records too.
+ */
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "version.h"
+#include "log_ring.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Log levels, most severe first
+#define LOG_LEVEL_ERROR     0
+#define LOG_LEVEL_WARN      1
+#define LOG_LEVEL_INFO      2
+#define LOG_LEVEL_DEBUG     3
+
+// Most verbose level compiled in
+#ifndef LOG_LEVEL
+#define LOG_LEVEL           LOG_LEVEL_INFO
+#endif
+
+// Wall clock times before this (2020-01-01) mean the clock was never set
+#define LOG_VALID_TIME      1577836800UL
+
+/**
+ * @enum LogModule
+ * @brief Module IDs stored with every message.
+ */
+enum LogModule : uint8_t {
+    LOG_SYSTEM = 0,
+    LOG_CONFIG,
+    LOG_NETWORK,
+    LOG_LED,
+    LOG_SERVO,
+    LOG_MODBUS,
+    LOG_SD,
+    LOG_WEB,
+    LOG_SNMP,
+    LOG_SSH,
+    LOG_MODULE_COUNT
+};
+
+#define LOG_AT(level, module, ...) \
+    do { if ((level) <= LOG_LEVEL) log_write((level), (module), __VA_ARGS__); } while (0)
+
+#define LOG_ERROR(module, ...)  LOG_AT(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+#define LOG_WARN(module, ...)   LOG_AT(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#define LOG_INFO(module, ...)   LOG_AT(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#define LOG_DEBUG(module, ...)  LOG_AT(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+
+/**
+ * @brief Formats a message into the log ring. Use the LOG_* macros instead.
+ *
+ * Thread-safe and never waits for the SD card; if the ring is full the
+ * message is dropped and counted. Arguments beyond LOG_RECORD_ARGS packed
+ * bytes are cut, and rendered messages end after LOG_MESSAGE_MAX characters.
+ * Implemented by the SD log writer (sd_tasks.cpp).
+ *
+ * @param level One of LOG_LEVEL_*.
+ * @param module One of LogModule.
+ * @param format printf-style format.
+ */
+void log_write(uint8_t level, uint8_t module, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Returns the one-letter tag of a level (E, W, I, D).
+ */
+char log_level_letter(uint8_t level);
+
+/**
+ * @brief Returns the name of a module, "?" for unknown IDs.
+ */
+const char* log_module_name(uint8_t module);
+
+/**
+ * @brief Renders a record as one text line, including the newline.
+ *
+ * The line starts with the wall clock time, or with the uptime if the clock
+ * was not set yet, followed by the level letter and the module:
+ * "[2024-05-01 14:03:07] W SD: message".
+ *
+ * @param out Output buffer.
+ * @param capacity Size of the output buffer; LOG_LINE_MAX always suffices.
+ * @param record The record to render.
+ * @return The line length, without a terminating NUL.
+ */
+size_t log_format_line(char* out, size_t capacity, const LogRecord& record);
+
+/**
+ * @brief Reads the wall clock time back from a line of log_format_line().
+ *
+ * @param line Start of the line; needs not be NUL-terminated.
+ * @param length Bytes available at `line`.
+ * @param time Set to the time of the line.
+ * @return False for lines logged before the clock was set, which carry the uptime.
+ */
+bool log_line_time(const char* line, size_t length, uint32_t* time);
+
+/**
+ * @brief Parses a local time given for a log query.
+ *
+ * Accepts seconds since the epoch, "YYYY-MM-DD HH:MM[:SS]" (also with a "T"
+ * between date and time), or "HH:MM[:SS]", meaning the latest such time up to
+ * `now`.
+ *
+ * @param text The time as typed.
+ * @param now The current wall clock time.
+ * @param time Set to the time.
+ * @return False if `text` is none of the forms.
+ */
+bool log_parse_time(const char* text, uint32_t now, uint32_t* time);
+
+// Longest rendered message text, and longest line log_format_line() produces
+#define LOG_MESSAGE_MAX     160
+#define LOG_LINE_MAX        (LOG_MESSAGE_MAX + 40)
+
+#endif // LOGGER_H
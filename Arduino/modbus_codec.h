@@ -0,0 +1,114 @@
+/**
+ * @file modbus_codec.h
+ * @brief Modbus RTU frame codec with a table-driven CRC16.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Encodes frames into caller-supplied buffers and decodes them in place:
+ * decoded register values are read straight out of the receive buffer
+ * through a ModbusRegisters view, without copying. Covers the Read Holding
+ * Registers function used by the servo task, for both the master and the
+ * slave side so host tools can simulate a servo.
+ */
+#ifndef MODBUS_CODEC_H
+#define MODBUS_CODEC_H
+
+#include "version.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODBUS_READ_HOLDING_REGISTERS   0x03
+#define MODBUS_EXCEPTION_FLAG           0x80
+
+// Largest RTU frame (address + PDU + CRC)
+#define MODBUS_MAX_FRAME                256
+
+// Frame sizes of a read request and of a read response for `count` registers
+#define MODBUS_READ_REQUEST_SIZE        8
+#define MODBUS_READ_RESPONSE_SIZE(count) (5 + (count) * 2)
+
+/**
+ * @enum ModbusStatus
+ * @brief Outcome of decoding a frame or of a whole request.
+ */
+enum ModbusStatus : uint8_t {
+    MODBUS_OK = 0,
+    MODBUS_TIMEOUT,         // No (complete) response within the response timeout
+    MODBUS_CRC_ERROR,       // Frame failed the CRC check
+    MODBUS_EXCEPTION,       // Slave answered with an exception code
+    MODBUS_BAD_RESPONSE,    // Wrong slave, function or length
+    MODBUS_EXPIRED          // Deadline passed before the request reached the bus
+};
+
+/**
+ * @struct ModbusRegisters
+ * @brief Read-only view of big-endian register values inside a frame buffer.
+ */
+struct ModbusRegisters {
+    const uint8_t* data;
+    uint16_t count;
+
+    uint16_t get(int i) const { return (data[i * 2] << 8) | data[i * 2 + 1]; }
+};
+
+/**
+ * @brief Computes the Modbus CRC16 (polynomial 0xA001, initial 0xFFFF).
+ *
+ * Uses a 256-entry table, one lookup per byte.
+ */
+uint16_t modbus_crc16(const uint8_t* data, size_t length);
+
+/**
+ * @brief Bit-by-bit reference implementation of the CRC16, for checking the table.
+ */
+uint16_t modbus_crc16_bitwise(const uint8_t* data, size_t length);
+
+/**
+ * @brief Encodes a Read Holding Registers request.
+ *
+ * @param frame Output buffer.
+ * @param capacity Size of the output buffer.
+ * @return The frame length, 0 if the buffer is too small.
+ */
+size_t modbus_encode_read_request(uint8_t* frame, size_t capacity, uint8_t slave_id,
+                                  uint16_t address, uint16_t count);
+
+/**
+ * @brief Checks a Read Holding Registers response against its request.
+ *
+ * @param frame The received frame.
+ * @param length The received length, 0 if nothing arrived.
+ * @param slave_id The slave the request was sent to.
+ * @param count The number of registers requested.
+ * @param registers Receives a view into `frame` if the result is MODBUS_OK.
+ * @param exception Receives the exception code if the result is MODBUS_EXCEPTION.
+ */
+ModbusStatus modbus_decode_read_response(const uint8_t* frame, size_t length, uint8_t slave_id,
+                                         uint16_t count, ModbusRegisters* registers, uint8_t* exception);
+
+/**
+ * @brief Decodes a Read Holding Registers request (slave side).
+ *
+ * @return MODBUS_OK, MODBUS_CRC_ERROR or MODBUS_BAD_RESPONSE for other functions.
+ */
+ModbusStatus modbus_decode_read_request(const uint8_t* frame, size_t length, uint8_t* slave_id,
+                                        uint16_t* address, uint16_t* count);
+
+/**
+ * @brief Encodes a Read Holding Registers response (slave side).
+ *
+ * @return The frame length, 0 if the buffer is too small.
+ */
+size_t modbus_encode_read_response(uint8_t* frame, size_t capacity, uint8_t slave_id,
+                                   const uint16_t* values, uint16_t count);
+
+/**
+ * @brief Encodes an exception response (slave side).
+ *
+ * @return The frame length, 0 if the buffer is too small.
+ */
+size_t modbus_encode_exception(uint8_t* frame, size_t capacity, uint8_t slave_id,
+                               uint8_t function, uint8_t exception);
+
+#endif // MODBUS_CODEC_H
@@ -0,0 +1,93 @@
+/**
+ * @file modbus_exchange.cpp
+ * @brief Implementation of the transport-independent Modbus RTU transaction.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "modbus_exchange.h"
+#include "version.h"
+
+// Length of an exception response: address, function, code and CRC
+#define MODBUS_EXCEPTION_SIZE       5
+
+uint32_t modbus_char_us(uint32_t baud) {
+    if (baud == 0) return 0;
+    return (MODBUS_CHAR_BITS * 1000000UL + baud - 1) / baud;
+}
+
+uint32_t modbus_frame_gap_us(uint32_t baud, uint32_t inter_frame_us) {
+    if (inter_frame_us > 0) return inter_frame_us;
+    if (baud == 0 || baud > 19200) return MODBUS_FAST_FRAME_GAP_US;
+    return (uint32_t)(7ULL * MODBUS_CHAR_BITS * 1000000ULL / (2ULL * baud));
+}
+
+bool ModbusExchange::begin(const ModbusRequest& request, uint32_t now_ms, uint64_t now_us, uint32_t gap_us) {
+    current = request;
+    length = 0;
+    idle = false;
+    lost = false;
+    this->gap_us = gap_us;
+    start_us = now_us;
+    last_byte_us = now_us;
+    expected = MODBUS_READ_RESPONSE_SIZE(request.count);
+    expired = (int32_t)(now_ms - request.deadline_ms) > 0;
+    request_size = expired ? 0 : modbus_encode_read_request(this->request, sizeof(this->request), request.slave_id,
+                                                            request.address, request.count);
+    return !expired;
+}
+
+uint8_t* ModbusExchange::receive_buffer(size_t* room) {
+    *room = sizeof(frame) - length;
+    return frame + length;
+}
+
+void ModbusExchange::received(size_t count, uint64_t now_us) {
+    if (count == 0) return;
+    length += count <= sizeof(frame) - length ? count : sizeof(frame) - length;
+    last_byte_us = now_us;
+}
+
+void ModbusExchange::line_idle() {
+    if (length > 0) idle = true;
+}
+
+void ModbusExchange::overrun() {
+    lost = true;
+}
+
+bool ModbusExchange::done(uint64_t now_us) const {
+    if (expired || lost || idle || length >= expected) return true;
+    // An exception is complete at its own, shorter length
+    if (length >= MODBUS_EXCEPTION_SIZE && (frame[1] & MODBUS_EXCEPTION_FLAG)) return true;
+    if (length > 0) return now_us - last_byte_us >= gap_us;
+    return now_us - start_us >= (uint64_t)current.timeout_ms * 1000;
+}
+
+uint32_t ModbusExchange::wait_us(uint64_t now_us) const {
+    if (done(now_us)) return 0;
+    uint64_t until = length > 0 ? last_byte_us + gap_us : start_us + (uint64_t)current.timeout_ms * 1000;
+    return (uint32_t)(until - now_us);
+}
+
+uint32_t ModbusExchange::quiet_us(uint64_t now_us) const {
+    if (expired) return 0;
+    uint64_t until = last_byte_us + gap_us;
+    return until > now_us ? (uint32_t)(until - now_us) : 0;
+}
+
+ModbusResponse ModbusExchange::finish(uint64_t now_us) {
+    ModbusResponse response = {MODBUS_OK, 0, {frame, 0}, 0};
+    if (expired) {
+        response.status = MODBUS_EXPIRED;
+        return response;
+    }
+    if (length == 0) {
+        response.status = MODBUS_TIMEOUT;
+    } else {
+        response.status = modbus_decode_read_response(frame, length, current.slave_id, current.count,
+                                                      &response.registers, &response.exception);
+    }
+    response.elapsed_us = (uint32_t)(now_us - start_us);
+    return response;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file modbus_exchange.h
+ * @brief One Modbus RTU master transaction, independent of the serial transport.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Holds the timing and response assembly of a read: whether the request is
+ * still worth sending, the request frame, the bytes received so far and the
+ * rules that end the response (its full length, an exception frame, the RX
+ * timeout of the UART, a 3.5-character silence after the last byte, or the
+ * response timeout before the first one), the silent gap the line needs
+ * before the next request, and the decoded outcome. The transport only moves
+ * bytes and reports time: modbus_rtu.cpp feeds it the ESP-IDF UART events,
+ * tools/servo_replay a host serial descriptor.
+ */
+#ifndef MODBUS_EXCHANGE_H
+#define MODBUS_EXCHANGE_H
+
+#include "version.h"
+#include "modbus_codec.h"
+#include "modbus_rtu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Bits of one character on the line: start, 8 data, parity or second stop, stop
+#define MODBUS_CHAR_BITS            11
+
+// Fixed inter-frame gap above 19200 baud, as the Modbus specification sets it
+#define MODBUS_FAST_FRAME_GAP_US    1750
+
+/**
+ * @brief Time one character takes on the wire.
+ */
+uint32_t modbus_char_us(uint32_t baud);
+
+/**
+ * @brief Silent time between frames: 3.5 characters, fixed at 1750 us above
+ *        19200 baud, unless configured explicitly.
+ *
+ * @param baud The bus baud rate.
+ * @param inter_frame_us Configured gap, 0 for the default.
+ */
+uint32_t modbus_frame_gap_us(uint32_t baud, uint32_t inter_frame_us);
+
+/**
+ * @class ModbusExchange
+ * @brief Request, response assembly and timing of one read on the bus.
+ *
+ * Usage: begin(); if it returns true, write request_frame(), then feed the
+ * received bytes into receive_buffer()/received() until done(), waiting at
+ * most wait_us() for the next ones; keep the line silent for quiet_us() and
+ * call finish(). The registers of the response point into the exchange and
+ * stay valid until the next begin().
+ */
+class ModbusExchange {
+public:
+    /**
+     * @brief Starts a request.
+     *
+     * @param request The request.
+     * @param now_ms The caller's millisecond clock, for the request deadline.
+     * @param now_us The microsecond clock all other times are taken from.
+     * @param gap_us The inter-frame gap of the line.
+     * @return False if the deadline has passed; finish() then reports MODBUS_EXPIRED.
+     */
+    bool begin(const ModbusRequest& request, uint32_t now_ms, uint64_t now_us, uint32_t gap_us);
+
+    const uint8_t* request_frame() const { return request; }
+    size_t request_length() const { return request_size; }
+
+    /**
+     * @brief Where the transport stores the next received bytes.
+     *
+     * @param room Set to the free space; bytes beyond a full frame are dropped.
+     */
+    uint8_t* receive_buffer(size_t* room);
+
+    /**
+     * @brief Accounts `count` bytes just stored into receive_buffer().
+     */
+    void received(size_t count, uint64_t now_us);
+
+    /**
+     * @brief The UART saw the line go quiet after the received bytes.
+     */
+    void line_idle();
+
+    /**
+     * @brief The receiver lost bytes; the response ends with what it has.
+     */
+    void overrun();
+
+    /**
+     * @brief True once the response is complete or has timed out.
+     */
+    bool done(uint64_t now_us) const;
+
+    /**
+     * @brief Longest the transport may wait for more bytes before done() changes.
+     */
+    uint32_t wait_us(uint64_t now_us) const;
+
+    /**
+     * @brief Silence the line still needs before the next request may be sent.
+     */
+    uint32_t quiet_us(uint64_t now_us) const;
+
+    /**
+     * @brief Decodes the response.
+     *
+     * @param now_us The end of the transaction, after the silent gap.
+     */
+    ModbusResponse finish(uint64_t now_us);
+
+private:
+    ModbusRequest current = {};
+    bool expired = false;
+    uint8_t request[MODBUS_READ_REQUEST_SIZE] = {};
+    size_t request_size = 0;
+    uint8_t frame[MODBUS_MAX_FRAME] = {};
+    size_t length = 0;
+    size_t expected = 0;
+    bool idle = false;
+    bool lost = false;
+    uint32_t gap_us = 0;
+    uint64_t start_us = 0;
+    uint64_t last_byte_us = 0;
+};
+
+#endif // MODBUS_EXCHANGE_H
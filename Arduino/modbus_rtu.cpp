@@ -0,0 +1,174 @@
+/**
+ * @file modbus_rtu.cpp
+ * @brief Implementation of the non-blocking Modbus RTU master.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Uses the ESP-IDF UART driver directly. The driver posts a UART_DATA event
+ * with `timeout_flag` set when the line has been silent for the RX timeout,
+ * which is how the end of a response frame is found without polling. The bus
+ * task is the only user of UART2 and blocks on the event queue while a
+ * response is outstanding, so callers never spin. When a frame ends, how long
+ * to wait and what the response is are decided by ModbusExchange
+ * (modbus_exchange.h), the same code the host replay harness runs.
+ */
+#include "modbus_rtu.h"
+#include "version.h"
+#include "modbus_exchange.h"
+#include "pins.h"
+#include "sd_tasks.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+#define MODBUS_UART             UART_NUM_2
+#define MODBUS_UART_BUFFER      512
+
+// RX timeout in character times marking the end of a frame (3.5 by the spec,
+// the hardware counts whole characters)
+#define MODBUS_RX_TIMEOUT_CHARS 3
+
+static QueueHandle_t request_queue = NULL;
+static QueueHandle_t uart_events = NULL;
+
+// Silent time required between frames, 3.5 characters (1750 us above 19200 baud)
+static uint32_t frame_gap_us = 0;
+
+// Baud rate the UART is set to, read by other tasks for reporting
+static volatile int line_baud = 0;
+
+/**
+ * @brief Collects the response of an exchange from the UART events until it is done.
+ */
+static void receive_frame(ModbusExchange& exchange) {
+    while (!exchange.done(esp_timer_get_time())) {
+        uint32_t wait_us = exchange.wait_us(esp_timer_get_time());
+        TickType_t wait = pdMS_TO_TICKS((wait_us + 999) / 1000);
+        uart_event_t event;
+        if (xQueueReceive(uart_events, &event, wait > 0 ? wait : 1) != pdTRUE) continue;
+
+        if (event.type == UART_DATA) {
+            size_t room;
+            uint8_t* into = exchange.receive_buffer(&room);
+            int n = uart_read_bytes(MODBUS_UART, into, event.size < room ? event.size : room, 0);
+            if (n > 0) exchange.received(n, esp_timer_get_time());
+            // Line went quiet: the frame is complete (or an exception was sent)
+            if (event.timeout_flag) exchange.line_idle();
+        } else if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+            uart_flush_input(MODBUS_UART);
+            xQueueReset(uart_events);
+            exchange.overrun();
+        }
+    }
+}
+
+/**
+ * @brief Bus task running queued requests one at a time.
+ */
+static void modbus_rtu_task(void* pvParameters) {
+    static ModbusExchange exchange;
+
+    while (1) {
+        ModbusRequest request;
+        if (xQueueReceive(request_queue, &request, portMAX_DELAY) != pdTRUE) continue;
+
+        if (exchange.begin(request, millis(), esp_timer_get_time(), frame_gap_us)) {
+            // Drop anything left over from a late answer to an earlier request
+            uart_flush_input(MODBUS_UART);
+            xQueueReset(uart_events);
+
+            uart_write_bytes(MODBUS_UART, (const char*)exchange.request_frame(), exchange.request_length());
+            receive_frame(exchange);
+
+            // Keep the bus silent for the inter-frame gap before the next request
+            delayMicroseconds(exchange.quiet_us(esp_timer_get_time()));
+        }
+        // The registers are decoded in place from the receive buffer
+        ModbusResponse response = exchange.finish(esp_timer_get_time());
+
+        if (request.callback) {
+            request.callback(request, response);
+        }
+    }
+}
+
+static uart_parity_t uart_parity(char parity) {
+    if (parity == 'E') return UART_PARITY_EVEN;
+    if (parity == 'O') return UART_PARITY_ODD;
+    return UART_PARITY_DISABLE;
+}
+
+/**
+ * @brief Configures UART2 for RS485 and starts the bus task.
+ */
+bool modbus_rtu_begin(int baud, char parity, int inter_frame_us) {
+    uart_config_t uart_cfg = {};
+    uart_cfg.baud_rate = baud;
+    uart_cfg.data_bits = UART_DATA_8_BITS;
+    uart_cfg.parity = uart_parity(parity);
+    uart_cfg.stop_bits = UART_STOP_BITS_1;
+    uart_cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_cfg.source_clk = UART_SCLK_APB;
+
+    if (uart_driver_install(MODBUS_UART, MODBUS_UART_BUFFER, 0, 16, &uart_events, 0) != ESP_OK ||
+        uart_param_config(MODBUS_UART, &uart_cfg) != ESP_OK ||
+        uart_set_pin(MODBUS_UART, RS485_TX_PIN, RS485_RX_PIN, RS485_RTS_PIN, UART_PIN_NO_CHANGE) != ESP_OK ||
+        uart_set_mode(MODBUS_UART, UART_MODE_RS485_HALF_DUPLEX) != ESP_OK ||
+        uart_set_rx_timeout(MODBUS_UART, MODBUS_RX_TIMEOUT_CHARS) != ESP_OK) {
+        LOG_ERROR(LOG_MODBUS, "Modbus RTU: failed to set up UART2");
+        return false;
+    }
+
+    frame_gap_us = modbus_frame_gap_us(baud, inter_frame_us > 0 ? inter_frame_us : 0);
+    line_baud = baud;
+
+    request_queue = xQueueCreate(MODBUS_QUEUE_LENGTH, sizeof(ModbusRequest));
+    xTaskCreate(modbus_rtu_task, "modbus_rtu_task", 4096, NULL, 2, NULL);
+    return true;
+}
+
+/**
+ * @brief Changes the line settings of a running master.
+ */
+bool modbus_rtu_set_line(int baud, char parity, int inter_frame_us) {
+    if (uart_set_baudrate(MODBUS_UART, baud) != ESP_OK ||
+        uart_set_parity(MODBUS_UART, uart_parity(parity)) != ESP_OK) {
+        return false;
+    }
+    frame_gap_us = modbus_frame_gap_us(baud, inter_frame_us > 0 ? inter_frame_us : 0);
+    line_baud = baud;
+    uart_flush_input(MODBUS_UART);
+    return true;
+}
+
+/**
+ * @brief Returns the baud rate the bus is running at.
+ */
+int modbus_rtu_baud() {
+    return line_baud;
+}
+
+/**
+ * @brief Queues a request. Never blocks.
+ */
+bool modbus_rtu_submit(const ModbusRequest& request) {
+    if (request_queue == NULL || request.count == 0 || MODBUS_READ_RESPONSE_SIZE(request.count) > MODBUS_MAX_FRAME) {
+        return false;
+    }
+    return xQueueSend(request_queue, &request, 0) == pdTRUE;
+}
+
+/**
+ * @brief Queues a request ahead of the waiting ones. Never blocks.
+ */
+bool modbus_rtu_submit_front(const ModbusRequest& request) {
+    if (request_queue == NULL || request.count == 0 || MODBUS_READ_RESPONSE_SIZE(request.count) > MODBUS_MAX_FRAME) {
+        return false;
+    }
+    return xQueueSendToFront(request_queue, &request, 0) == pdTRUE;
+}
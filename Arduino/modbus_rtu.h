@@ -0,0 +1,112 @@
+/**
+ * @file modbus_rtu.h
+ * @brief Non-blocking Modbus RTU master on the RS485 bus (UART2).
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Requests are queued with a deadline, a response timeout and a completion
+ * callback, and a dedicated bus task runs them one after the other. The UART
+ * runs in hardware RS485 half-duplex mode, so RS485_RTS_PIN drives the
+ * transceiver direction, and the UART RX timeout detects the silent gap that
+ * ends a response frame. A servo that does not answer only costs its own
+ * response timeout; requests for the other servos are still served.
+ */
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include "version.h"
+#include "modbus_codec.h"
+#include <stdint.h>
+
+// Requests that can be waiting for the bus
+#define MODBUS_QUEUE_LENGTH         16
+
+struct ModbusRequest;
+
+/**
+ * @struct ModbusResponse
+ * @brief Outcome of a request, passed to its callback.
+ */
+struct ModbusResponse {
+    ModbusStatus status;
+    uint8_t exception;          // Exception code if status is MODBUS_EXCEPTION
+    ModbusRegisters registers;  // View of the received registers if status is MODBUS_OK,
+                                // valid only during the callback
+    uint32_t elapsed_us;        // Bus time from the start of the request to its end, 0 if expired
+};
+
+/**
+ * @brief Completion callback, run from the bus task.
+ *
+ * @param request The completed request.
+ * @param response The outcome and the registers read.
+ */
+typedef void (*ModbusCallback)(const ModbusRequest& request, const ModbusResponse& response);
+
+/**
+ * @struct ModbusRequest
+ * @brief One Read Holding Registers request.
+ */
+struct ModbusRequest {
+    uint8_t slave_id;
+    uint16_t address;
+    uint16_t count;
+    uint16_t timeout_ms;        // Response timeout once the request is sent
+    uint32_t deadline_ms;       // millis() after which the request is not sent any more
+    ModbusCallback callback;
+    void* context;              // Caller data, untouched by the master
+};
+
+/**
+ * @brief Configures UART2 for RS485 and starts the bus task.
+ *
+ * @param baud The bus baud rate.
+ * @param parity 'N', 'E' or 'O'.
+ * @param inter_frame_us Silent time between frames, 0 for 3.5 characters.
+ * @return True if the UART driver was installed.
+ */
+bool modbus_rtu_begin(int baud, char parity, int inter_frame_us);
+
+/**
+ * @brief Changes the line settings of a running master.
+ *
+ * Only call while no request is queued or in progress.
+ *
+ * @param baud The bus baud rate.
+ * @param parity 'N', 'E' or 'O'.
+ * @param inter_frame_us Silent time between frames, 0 for 3.5 characters.
+ * @return True if the UART accepted the settings.
+ */
+bool modbus_rtu_set_line(int baud, char parity, int inter_frame_us);
+
+/**
+ * @brief Returns the baud rate the bus is running at, 0 before modbus_rtu_begin().
+ *
+ * Follows modbus_rtu_set_line(), so it reports the autotuned or fallback
+ * rate rather than the configured one.
+ */
+int modbus_rtu_baud();
+
+/**
+ * @brief Queues a request. Never blocks.
+ *
+ * Every accepted request gets exactly one callback.
+ *
+ * @param request The request.
+ * @return False if the queue is full or the master is not running.
+ */
+bool modbus_rtu_submit(const ModbusRequest& request);
+
+/**
+ * @brief Queues a request ahead of the waiting ones. Never blocks.
+ *
+ * For a retry from a completion callback: it goes out next, so reads queued
+ * back to back stay back to back.
+ *
+ * @param request The request.
+ * @return False if the queue is full or the master is not running.
+ */
+bool modbus_rtu_submit_front(const ModbusRequest& request);
+
+#endif // MODBUS_RTU_H
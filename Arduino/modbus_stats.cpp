@@ -0,0 +1,81 @@
+/**
+ * @file modbus_stats.cpp
+ * @brief Implementation of the per-slave Modbus statistics block.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "modbus_stats.h"
+#include "version.h"
+
+static ModbusSlaveStats slave_stats[AXIS_COUNT];
+static const uint32_t latency_bounds[MODBUS_LATENCY_BINS - 1] = MODBUS_LATENCY_BOUNDS;
+
+/**
+ * @brief Accounts one completed request.
+ */
+void modbus_stats_record(int axis, ModbusStatus status, uint8_t exception, uint32_t elapsed_us) {
+    if (axis < 0 || axis >= AXIS_COUNT) return;
+    ModbusSlaveStats& stats = slave_stats[axis];
+
+    switch (status) {
+        case MODBUS_OK: {
+            stats.success++;
+            int bin = 0;
+            while (bin < MODBUS_LATENCY_BINS - 1 && elapsed_us >= latency_bounds[bin]) bin++;
+            stats.latency_histogram[bin]++;
+            if (elapsed_us > stats.max_latency_us) stats.max_latency_us = elapsed_us;
+            break;
+        }
+        case MODBUS_TIMEOUT:
+            stats.timeouts++;
+            break;
+        case MODBUS_CRC_ERROR:
+            stats.crc_errors++;
+            break;
+        case MODBUS_EXCEPTION:
+            stats.exceptions++;
+            stats.last_exception = exception;
+            break;
+        case MODBUS_BAD_RESPONSE:
+            stats.bad_responses++;
+            break;
+        case MODBUS_EXPIRED:
+            stats.expired++;
+            break;
+    }
+}
+
+/**
+ * @brief Counts a retry of a failed request.
+ */
+void modbus_stats_retry(int axis) {
+    if (axis < 0 || axis >= AXIS_COUNT) return;
+    slave_stats[axis].retries++;
+}
+
+/**
+ * @brief Returns a copy of a slave's counters.
+ */
+ModbusSlaveStats modbus_stats(int axis) {
+    return slave_stats[axis];
+}
+
+/**
+ * @brief Returns one counter by field index.
+ */
+uint32_t modbus_stats_field(const ModbusSlaveStats& stats, int field) {
+    switch (field) {
+        case MODBUS_STAT_SUCCESS: return stats.success;
+        case MODBUS_STAT_TIMEOUT: return stats.timeouts;
+        case MODBUS_STAT_CRC_ERROR: return stats.crc_errors;
+        case MODBUS_STAT_EXCEPTION: return stats.exceptions;
+        case MODBUS_STAT_BAD_RESPONSE: return stats.bad_responses;
+        case MODBUS_STAT_EXPIRED: return stats.expired;
+        case MODBUS_STAT_RETRY: return stats.retries;
+    }
+    if (field >= MODBUS_STAT_LATENCY_BIN && field < MODBUS_STAT_FIELD_COUNT) {
+        return stats.latency_histogram[field - MODBUS_STAT_LATENCY_BIN];
+    }
+    return 0;
+}
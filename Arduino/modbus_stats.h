@@ -0,0 +1,86 @@
+/**
+ * @file modbus_stats.h
+ * @brief Per-slave Modbus bus health counters and latency histograms.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Every completed request is accounted to its slave (one per axis): the
+ * outcome is counted by kind, retries are counted separately, and successful
+ * round trips go into a fixed latency histogram. All storage is a static
+ * block; recording never allocates. The block is not synchronized: on the
+ * device the servo task records under its own lock and other tasks read
+ * copies through servo_modbus_stats().
+ */
+#ifndef MODBUS_STATS_H
+#define MODBUS_STATS_H
+
+#include "version.h"
+#include "modbus_codec.h"
+#include "axis_mailbox.h"
+#include <stdint.h>
+
+// Round-trip latency histogram bins; each bound is the exclusive upper edge
+// in microseconds, the last bin counts everything slower
+#define MODBUS_LATENCY_BINS     8
+#define MODBUS_LATENCY_BOUNDS   {2000, 5000, 10000, 20000, 30000, 50000, 100000}
+
+/**
+ * @enum ModbusStatField
+ * @brief Counter indices, as used for the SNMP OIDs (field + 1).
+ */
+enum ModbusStatField {
+    MODBUS_STAT_SUCCESS = 0,
+    MODBUS_STAT_TIMEOUT,
+    MODBUS_STAT_CRC_ERROR,
+    MODBUS_STAT_EXCEPTION,
+    MODBUS_STAT_BAD_RESPONSE,
+    MODBUS_STAT_EXPIRED,
+    MODBUS_STAT_RETRY,
+    MODBUS_STAT_LATENCY_BIN,    // First latency bin; MODBUS_LATENCY_BINS fields follow
+    MODBUS_STAT_FIELD_COUNT = MODBUS_STAT_LATENCY_BIN + MODBUS_LATENCY_BINS
+};
+
+/**
+ * @struct ModbusSlaveStats
+ * @brief Counters of one slave since boot.
+ */
+struct ModbusSlaveStats {
+    uint32_t success;
+    uint32_t timeouts;
+    uint32_t crc_errors;
+    uint32_t exceptions;
+    uint32_t bad_responses;
+    uint32_t expired;
+    uint32_t retries;
+    uint8_t last_exception;             // Code of the most recent exception response
+    uint32_t max_latency_us;            // Slowest successful round trip
+    uint32_t latency_histogram[MODBUS_LATENCY_BINS];
+};
+
+/**
+ * @brief Accounts one completed request.
+ *
+ * @param axis The slave's axis index.
+ * @param status The request outcome.
+ * @param exception The exception code if status is MODBUS_EXCEPTION.
+ * @param elapsed_us The bus time of the request.
+ */
+void modbus_stats_record(int axis, ModbusStatus status, uint8_t exception, uint32_t elapsed_us);
+
+/**
+ * @brief Counts a retry of a failed request.
+ */
+void modbus_stats_retry(int axis);
+
+/**
+ * @brief Returns a copy of a slave's counters.
+ */
+ModbusSlaveStats modbus_stats(int axis);
+
+/**
+ * @brief Returns one counter by field index (see ModbusStatField).
+ */
+uint32_t modbus_stats_field(const ModbusSlaveStats& stats, int field);
+
+#endif // MODBUS_STATS_H
@@ -0,0 +1,104 @@
+/**
+ * @file motion_estimator.cpp
+ * @brief Implementation of the per-axis position predictor.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The velocity is a least-squares fit over the sample history, which averages
+ * out the jitter of when each Modbus response actually arrived.
+ */
+#include "motion_estimator.h"
+#include "version.h"
+
+void MotionEstimator::reset() {
+    if (count > 1) {
+        times[0] = times[count - 1];
+        positions[0] = positions[count - 1];
+        count = 1;
+    }
+    velocity_per_ms = 0.0f;
+}
+
+void MotionEstimator::add_sample(uint32_t timestamp_ms, int32_t position, bool min_limit, bool max_limit) {
+    this->min_limit = min_limit;
+    this->max_limit = max_limit;
+
+    if (count > 0) {
+        // Repeated sample (same timestamp): just update it
+        if (timestamp_ms == times[count - 1]) {
+            positions[count - 1] = position;
+            fit_velocity();
+            return;
+        }
+
+        // A step against the current motion (or no step at all) is a reversal
+        // or a stop; old samples would make the fit overshoot, so start again
+        // from the last sample
+        int64_t step = (int64_t)position - positions[count - 1];
+        if ((step >= 0 && velocity_per_ms < 0.0f) || (step <= 0 && velocity_per_ms > 0.0f)) {
+            reset();
+        }
+    }
+
+    if (count == MOTION_HISTORY) {
+        for (int i = 1; i < MOTION_HISTORY; i++) {
+            times[i - 1] = times[i];
+            positions[i - 1] = positions[i];
+        }
+        count--;
+    }
+    times[count] = timestamp_ms;
+    positions[count] = position;
+    count++;
+
+    fit_velocity();
+}
+
+void MotionEstimator::fit_velocity() {
+    if (count < 2) {
+        velocity_per_ms = 0.0f;
+        return;
+    }
+
+    // Least-squares slope, relative to the newest sample to keep the sums small
+    uint32_t t0 = times[count - 1];
+    int32_t p0 = positions[count - 1];
+    float mean_t = 0.0f;
+    float mean_p = 0.0f;
+    for (int i = 0; i < count; i++) {
+        mean_t += (int32_t)(times[i] - t0);
+        mean_p += (float)((int64_t)positions[i] - p0);
+    }
+    mean_t /= count;
+    mean_p /= count;
+
+    float num = 0.0f;
+    float den = 0.0f;
+    for (int i = 0; i < count; i++) {
+        float dt = (int32_t)(times[i] - t0) - mean_t;
+        float dp = (float)((int64_t)positions[i] - p0) - mean_p;
+        num += dt * dp;
+        den += dt * dt;
+    }
+    velocity_per_ms = den > 0.0f ? num / den : 0.0f;
+}
+
+int32_t MotionEstimator::position_at(uint32_t now_ms) const {
+    if (count == 0) return 0;
+
+    int32_t newest = positions[count - 1];
+    int32_t ahead_ms = (int32_t)(now_ms - times[count - 1]);
+    if (ahead_ms <= 0) return newest;
+    if (ahead_ms > MOTION_MAX_PREDICTION_MS) ahead_ms = MOTION_MAX_PREDICTION_MS;
+
+    // Never predict further into an active limit switch
+    if ((min_limit && velocity_per_ms < 0.0f) || (max_limit && velocity_per_ms > 0.0f)) {
+        return newest;
+    }
+
+    int64_t predicted = newest + (int64_t)(velocity_per_ms * ahead_ms);
+    if (predicted > INT32_MAX) predicted = INT32_MAX;
+    if (predicted < INT32_MIN) predicted = INT32_MIN;
+    return (int32_t)predicted;
+}
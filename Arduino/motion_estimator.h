@@ -0,0 +1,73 @@
+/**
+ * @file motion_estimator.h
+ * @brief Per-axis position prediction between servo samples.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Servo positions arrive every few tens of milliseconds, while the LED task
+ * renders at its own frame rate. The estimator keeps the last few timestamped
+ * samples of an axis, fits a velocity to them, and predicts the position at
+ * render time so the marker glides instead of stepping. Prediction is capped
+ * to a short horizon, never runs further into an active limit switch, and the
+ * history is dropped whenever the axis reverses or stops.
+ */
+#ifndef MOTION_ESTIMATOR_H
+#define MOTION_ESTIMATOR_H
+
+#include "version.h"
+#include <stdint.h>
+
+// Samples used for the velocity fit
+#define MOTION_HISTORY              4
+
+// Longest time a position is predicted past the newest sample
+#define MOTION_MAX_PREDICTION_MS    150
+
+/**
+ * @class MotionEstimator
+ * @brief Velocity estimate and position prediction of one axis.
+ */
+class MotionEstimator {
+public:
+    /**
+     * @brief Adds a servo sample.
+     *
+     * @param timestamp_ms When the sample was taken.
+     * @param position The axis position in encoder counts.
+     * @param min_limit True if the min limit switch is active.
+     * @param max_limit True if the max limit switch is active.
+     */
+    void add_sample(uint32_t timestamp_ms, int32_t position, bool min_limit, bool max_limit);
+
+    /**
+     * @brief Predicts the position at a given time.
+     *
+     * @param now_ms The render time, on the same clock as the samples.
+     * @return The predicted position, or the newest sample if no motion is known.
+     */
+    int32_t position_at(uint32_t now_ms) const;
+
+    /**
+     * @brief Returns the estimated velocity in counts per millisecond.
+     */
+    float velocity() const { return velocity_per_ms; }
+
+    /**
+     * @brief Forgets the history, keeping only the newest sample.
+     */
+    void reset();
+
+private:
+    void fit_velocity();
+
+    uint32_t times[MOTION_HISTORY];
+    int32_t positions[MOTION_HISTORY];
+    int count = 0;          // Valid samples, newest at index count - 1
+
+    float velocity_per_ms = 0.0f;
+    bool min_limit = false;
+    bool max_limit = false;
+};
+
+#endif // MOTION_ESTIMATOR_H
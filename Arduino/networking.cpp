@@ -14,6 +14,7 @@
 #include "config.h"
 #include "pins.h"
 #include "sd_tasks.h"
+#include "logger.h"
 #include "led_tasks.h"
 #include "snmp_tasks.h"
 #include <WiFi.h>
@@ -34,7 +35,7 @@ static void init_network_stack();
  * @brief Initializes the ESP-IDF network event handlers and starts the networking flow.
  */
 static void init_network_stack() {
-    log_to_sd("Initializing network stack...");
+    LOG_INFO(LOG_NETWORK, "Initializing network stack...");
     
     // Register network event handlers
     esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, eth_event_handler, NULL);
@@ -47,7 +48,7 @@ static void init_network_stack() {
  * @brief Configures and starts the W5500 Ethernet interface.
  */
 void start_ethernet() {
-    log_to_sd("Attempting Ethernet connection...");
+    LOG_INFO(LOG_NETWORK, "Attempting Ethernet connection...");
     SPI.begin(ETH_SPI_SCK, ETH_SPI_MISO, ETH_SPI_MOSI, ETH_SPI_CS);
     ETH.begin(ETH_SPI_CS, ETH_PHY_RST, ETH_PHY_INT);
 }
@@ -65,9 +66,9 @@ void start_wifi(bool use_static_ip) {
         subnet.fromString(config.SUBNET);
         dns.fromString(config.DNS_SERVER);
         WiFi.config(local_ip, subnet, gateway, dns);
-        log_to_sd("Attempting Wi-Fi with static IP...");
+        LOG_INFO(LOG_NETWORK, "Attempting Wi-Fi with static IP...");
     } else {
-        log_to_sd("Attempting Wi-Fi with DHCP...");
+        LOG_INFO(LOG_NETWORK, "Attempting Wi-Fi with DHCP...");
         WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE, INADDR_NONE); // Clear any previous static config
     }
     WiFi.begin(config.WIFI_SSID.c_str(), config.WIFI_PASSWORD.c_str());
@@ -97,7 +98,7 @@ void update_ntp() {
     // Set fallback server and apply if DHCP doesn't provide
     sntp_setservername(0, config.NTP_SERVER.c_str());
 
-    log_to_sd("Attempting NTP synchronization...");
+    LOG_INFO(LOG_NETWORK, "Attempting NTP synchronization...");
     int retry_count = 0;
     while (sntp_get_sync_status() == SNTP_SYNC_STATUS_PENDING && retry_count < 10) {
         delay(1000);
@@ -111,9 +112,9 @@ void update_ntp() {
         localtime_r(&now, &timeinfo);
         char time_str[30];
         strftime(time_str, sizeof(time_str), "%c", &timeinfo);
-        log_to_sd("NTP synchronization successful. Time: " + String(time_str));
+        LOG_INFO(LOG_NETWORK, "NTP synchronization successful. Time: %s", time_str);
     } else {
-        log_to_sd("NTP synchronization failed. Using fallback server or no time sync.");
+        LOG_WARN(LOG_NETWORK, "NTP synchronization failed. Using fallback server or no time sync.");
     }
 }
 
@@ -126,14 +127,14 @@ void networking_task(void* pvParameters) {
     while (1) {
         // Only attempt to connect if not already connected
         if (!ethernet_connected && !wifi_connected) {
-            log_to_sd("Network disconnected. Attempting reconnection sequence.");
+            LOG_WARN(LOG_NETWORK, "Network disconnected. Attempting reconnection sequence.");
             
             // 1. Try last successful connection first
             if (last_connection_is_ethernet) {
                 start_ethernet();
                 vTaskDelay(pdMS_TO_TICKS(10000));
                 if (!ethernet_connected) {
-                    log_to_sd("Ethernet connection failed, trying Wi-Fi.");
+                    LOG_WARN(LOG_NETWORK, "Ethernet connection failed, trying Wi-Fi.");
                     start_wifi(false);
                     vTaskDelay(pdMS_TO_TICKS(15000));
                 }
@@ -141,7 +142,7 @@ void networking_task(void* pvParameters) {
                 start_wifi(false);
                 vTaskDelay(pdMS_TO_TICKS(15000));
                 if (!wifi_connected) {
-                    log_to_sd("Wi-Fi connection failed, trying Ethernet.");
+                    LOG_WARN(LOG_NETWORK, "Wi-Fi connection failed, trying Ethernet.");
                     start_ethernet();
                     vTaskDelay(pdMS_TO_TICKS(10000));
                 }
@@ -149,7 +150,7 @@ void networking_task(void* pvParameters) {
 
             // 2. Fallback to static IP if previous attempts failed
             if (!ethernet_connected && !wifi_connected) {
-                log_to_sd("All dynamic connection methods failed. Falling back to static IP.");
+                LOG_WARN(LOG_NETWORK, "All dynamic connection methods failed. Falling back to static IP.");
                 start_wifi(true);
                 vTaskDelay(pdMS_TO_TICKS(10000));
             }
@@ -163,18 +164,18 @@ void networking_task(void* pvParameters) {
 static void eth_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     switch (event_id) {
         case ETHERNET_EVENT_CONNECTED:
-            log_to_sd("Ethernet Link Up");
+            LOG_INFO(LOG_NETWORK, "Ethernet Link Up");
             ethernet_connected = true;
             break;
         case ETHERNET_EVENT_DISCONNECTED:
-            log_to_sd("Ethernet Link Down");
+            LOG_WARN(LOG_NETWORK, "Ethernet Link Down");
             ethernet_connected = false;
             break;
         case ETHERNET_EVENT_START:
-            log_to_sd("Ethernet Started");
+            LOG_INFO(LOG_NETWORK, "Ethernet Started");
             break;
         case ETHERNET_EVENT_STOP:
-            log_to_sd("Ethernet Stopped");
+            LOG_INFO(LOG_NETWORK, "Ethernet Stopped");
             break;
         default:
             break;
@@ -185,10 +186,10 @@ static void eth_event_handler(void *arg, esp_event_base_t event_base, int32_t ev
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     switch (event_id) {
         case WIFI_EVENT_STA_START:
-            log_to_sd("Wi-Fi STA Started");
+            LOG_INFO(LOG_NETWORK, "Wi-Fi STA Started");
             break;
         case WIFI_EVENT_STA_DISCONNECTED:
-            log_to_sd("Wi-Fi Disconnected");
+            LOG_WARN(LOG_NETWORK, "Wi-Fi Disconnected");
             wifi_connected = false;
             break;
         default:
@@ -202,12 +203,12 @@ static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id,
     if (event_base == IP_EVENT && event_id == IP_EVENT_ETH_GOT_IP) {
         last_connection_is_ethernet = true;
         ethernet_connected = true;
-        log_to_sd("Ethernet connected with IP: " + ETH.localIP().toString());
+        LOG_INFO(LOG_NETWORK, "Ethernet connected with IP: " IPSTR, IP2STR(&event->ip_info.ip));
         two_short_blue_flashes();
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         last_connection_is_ethernet = false;
         wifi_connected = true;
-        log_to_sd("Wi-Fi connected with IP: " + WiFi.localIP().toString());
+        LOG_INFO(LOG_NETWORK, "Wi-Fi connected with IP: " IPSTR, IP2STR(&event->ip_info.ip));
         if (event->ip_info.ip.toString() == config.STATIC_IP) {
             green_flash(3000);
         } else {
@@ -0,0 +1,62 @@
+/**
+ * @file poll_scheduler.cpp
+ * @brief Implementation of the adaptive servo polling scheduler.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "poll_scheduler.h"
+#include "version.h"
+
+void PollScheduler::set_mode(bool moving, bool near_limit) {
+    this->moving = moving;
+    this->near_limit = near_limit;
+}
+
+uint32_t PollScheduler::period_ms(PollItem item) const {
+    if (item == POLL_POSITION) {
+        return moving ? POLL_POSITION_MOVING_MS : POLL_POSITION_IDLE_MS;
+    }
+    if (near_limit) return POLL_STATUS_NEAR_LIMIT_MS;
+    return moving ? POLL_STATUS_MOVING_MS : POLL_STATUS_IDLE_MS;
+}
+
+bool PollScheduler::due(PollItem item, uint32_t now_ms) const {
+    if (!ever_polled[item]) return true;
+    return now_ms - last_poll_ms[item] >= period_ms(item);
+}
+
+void PollScheduler::polled(PollItem item, uint32_t now_ms) {
+    ever_polled[item] = true;
+    last_poll_ms[item] = now_ms;
+}
+
+void PollScheduler::sampled(PollItem item) {
+    window_samples[item]++;
+}
+
+void PollScheduler::add_bus_time(uint32_t elapsed_us) {
+    window_bus_us += elapsed_us;
+}
+
+void PollScheduler::update_stats(uint32_t now_ms) {
+    uint32_t elapsed_ms = now_ms - window_start_ms;
+    if (elapsed_ms < 1000) return;
+
+    poll_stats.position_hz = window_samples[POLL_POSITION] * 1000.0f / elapsed_ms;
+    poll_stats.status_hz = window_samples[POLL_STATUS] * 1000.0f / elapsed_ms;
+    poll_stats.bus_utilization = window_bus_us / (elapsed_ms * 1000.0f);
+    poll_stats.moving = moving;
+    poll_stats.near_limit = near_limit;
+
+    window_start_ms = now_ms;
+    window_samples[POLL_STATUS] = 0;
+    window_samples[POLL_POSITION] = 0;
+    window_bus_us = 0;
+}
+
+bool PollScheduler::near_rail_end(int32_t position, int64_t counts_per_rail) {
+    if (counts_per_rail <= 0) return false;
+    int64_t zone = counts_per_rail * POLL_LIMIT_ZONE_PERCENT / 100;
+    return position < zone || position > counts_per_rail - zone;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file poll_scheduler.h
+ * @brief Adaptive per-axis, per-register polling rates for the servo task.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Instead of reading every register of every servo at one fixed rate, each
+ * axis gets its own poll periods. A moving axis has its position read on every
+ * scheduler tick (as fast as the bus allows), an idle axis backs off, and the
+ * limit switch status is read on every tick while the axis is near either end
+ * of its rail. Each axis also keeps its achieved sample rates and its share of
+ * the bus time.
+ */
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include "version.h"
+#include <stdint.h>
+
+// Shortest scheduler tick; a tick lasts at least as long as the bus needs for
+// the reads planned in it (ServoPoller::tick_ms())
+#define POLL_TICK_MS                10
+
+// Poll periods in milliseconds, 0 means every tick
+#define POLL_POSITION_MOVING_MS     0
+#define POLL_POSITION_IDLE_MS       500
+#define POLL_STATUS_MOVING_MS       100
+#define POLL_STATUS_IDLE_MS         1000
+#define POLL_STATUS_NEAR_LIMIT_MS   0
+
+// An axis counts as idle this long after its position last changed
+#define POLL_IDLE_AFTER_MS          2000
+
+// Distance from either rail end, in percent of the rail, that counts as near a limit
+#define POLL_LIMIT_ZONE_PERCENT     5
+
+/**
+ * @enum PollItem
+ * @brief The register groups polled per axis.
+ */
+enum PollItem {
+    POLL_STATUS = 0,
+    POLL_POSITION = 1,
+    POLL_ITEM_COUNT
+};
+
+/**
+ * @struct PollStats
+ * @brief Achieved polling of one axis over the last second.
+ */
+struct PollStats {
+    float position_hz;          // Successful position samples per second
+    float status_hz;            // Successful status samples per second
+    float bus_utilization;      // Fraction of the bus time spent on this axis (0-1)
+    uint8_t moving;             // Axis is polled at the moving rates
+    uint8_t near_limit;         // Limit status is polled every tick
+};
+
+/**
+ * @class PollScheduler
+ * @brief Decides which registers of one axis are due and tracks its rates.
+ */
+class PollScheduler {
+public:
+    /**
+     * @brief Selects the poll periods for the axis' current state.
+     *
+     * @param moving True if the axis moved within POLL_IDLE_AFTER_MS.
+     * @param near_limit True if the axis is within the limit zone of a rail end.
+     */
+    void set_mode(bool moving, bool near_limit);
+
+    /**
+     * @brief Returns true if the item should be read this tick.
+     */
+    bool due(PollItem item, uint32_t now_ms) const;
+
+    /**
+     * @brief Records that the item was requested this tick.
+     */
+    void polled(PollItem item, uint32_t now_ms);
+
+    /**
+     * @brief Records a successful read of the item.
+     */
+    void sampled(PollItem item);
+
+    /**
+     * @brief Adds bus time used by this axis.
+     */
+    void add_bus_time(uint32_t elapsed_us);
+
+    /**
+     * @brief Closes the statistics window once a second has passed.
+     */
+    void update_stats(uint32_t now_ms);
+
+    /**
+     * @brief Returns a copy of the current statistics.
+     */
+    PollStats stats() const { return poll_stats; }
+
+    /**
+     * @brief Returns true if a position is within the limit zone of a rail.
+     *
+     * @param position The axis position in encoder counts.
+     * @param counts_per_rail Encoder counts over the full rail, <= 0 if unknown.
+     */
+    static bool near_rail_end(int32_t position, int64_t counts_per_rail);
+
+private:
+    uint32_t period_ms(PollItem item) const;
+
+    bool moving = false;
+    bool near_limit = false;
+
+    bool ever_polled[POLL_ITEM_COUNT] = {false, false};
+    uint32_t last_poll_ms[POLL_ITEM_COUNT] = {0, 0};
+
+    uint32_t window_start_ms = 0;
+    uint32_t window_samples[POLL_ITEM_COUNT] = {0, 0};
+    uint64_t window_bus_us = 0;
+
+    PollStats poll_stats = {};
+};
+
+#endif // POLL_SCHEDULER_H
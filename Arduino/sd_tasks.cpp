@@ -7,6 +7,29 @@
  *
  * This module handles logging to the SD card, monitoring SD card space,
  * and managing an in-memory ring buffer for recent logs.
+ *
+ * Logging is asynchronous: `log_write()` (the LOG_* macros of logger.h) only
+ * packs the message arguments into a slot of the lock-free log ring
+ * (log_ring.h) and returns. The SD writer task keeps the log file open,
+ * renders the records into a batch buffer and writes it in sector-aligned
+ * chunks of 4-16 KB, or whatever is buffered once the oldest line is
+ * LOG_FLUSH_AGE_MS old or a flush is requested at shutdown.
+ *
+ * With SD.LOG_BINARY set the writer stores the records in the binary format
+ * of log_codec.h instead of as text lines; the queries render both as text.
+ *
+ * The log is split into numbered segments (log_segments.h). The writer
+ * starts a new segment between two records, after writing out everything
+ * buffered for the old one, and deletes the oldest segment beyond the
+ * SD.LOG_RETAIN_MB budget, one per pass of its loop. Callers of the LOG_*
+ * macros never wait for either. The segment table is only changed under
+ * sdMutex, so the queries can read it from other tasks.
+ *
+ * Each segment has a sparse time index (log_index.h) written along with it.
+ * `sd_log_tail()` reads the last lines one index stride at a time from the
+ * end; `sd_log_seek()` and `sd_log_read()` return a time range in pieces,
+ * starting from the index point before it, so a longer log costs no more
+ * reads of the card.
  */
 #include "sd_tasks.h"
 #include "version.h"
@@ -14,9 +37,17 @@
 #include "pins.h"
 #include "led_tasks.h"
 #include "snmp_tasks.h"
+#include "log_ring.h"
+#include "logger.h"
+#include "log_codec.h"
+#include "log_segments.h"
+#include "log_index.h"
 #include <SD.h>
 #include <FS.h>
 #include <time.h>
+#include <atomic>
+#include <stdarg.h>
+#include <algorithm>
 
 #include "freertos/ringbuf.h"
 #include <string.h> // For memcpy
@@ -25,10 +56,84 @@
 RingbufHandle_t logBufferHandle;
 
 // Mutex to protect SD card access
-static SemaphoreHandle_t sdMutex;
+SemaphoreHandle_t sdMutex = NULL;
+
+// Binary single log file of earlier firmware; the text one is SD.LOG_FILE_PATH
+#define LOG_LEGACY_BINARY_PATH  "/system.bin"
+
+// How often the writer checks the flush age when no message arrives
+#define LOG_WRITER_POLL_MS      250
+
+// Binary segment bytes a range query decodes per call while holding sdMutex
+#define LOG_QUERY_SCAN_BYTES    (2 * LOG_INDEX_STRIDE)
+
+TaskHandle_t sd_log_task_handle = NULL;
+
+// Messages waiting for the writer task
+static LogRing log_ring;
+
+// Writer state, owned by the writer task: the open log file, its size, its
+// format and the encoded records waiting to be written
+static File log_file;
+static uint32_t log_file_size = 0;
+static bool log_binary = false;
+static LogEncoder log_encoder;
+static uint8_t log_batch[LOG_BATCH_MAX + LOG_ENCODED_MAX];
+static size_t log_buffered = 0;
+static uint32_t log_oldest_ms = 0;
+
+// Index of the open segment and the index points waiting in the batch buffer
+static File log_index_file;
+static LogIndexer log_indexer;
+
+// Segments on the card, changed under sdMutex; a closed newest segment is
+// complete and the next write starts a new one
+static LogSegments log_segments;
+static bool log_segments_loaded = false;
+static bool log_segment_closed = false;
+
+// Wall clock time of the open segment's first timed record, 0 until known;
+// its age survives reopening the segment and restarts
+static uint32_t log_segment_first_time = 0;
+
+static_assert(LOG_ENCODED_MAX >= LOG_LINE_MAX, "the batch buffer must hold a text line");
+
+// Reader for the log queries, used under sdMutex
+static LogReader log_reader;
+
+// Where a range query left log_reader, so the next piece continues there
+// instead of decoding again from the index point: the segment (0 if none),
+// the offset the reader began at, the cursor offset it stopped at and a
+// message decoded but not yet rendered
+static uint32_t log_reader_seq = 0;
+static uint32_t log_reader_begin = 0;
+static uint32_t log_reader_stop = 0;
+static bool log_reader_pending = false;
+static LogRecord log_reader_record;
+
+// Shutdown flush handshake with the writer task
+static std::atomic<bool> log_flush_requested{false};
+static SemaphoreHandle_t log_flush_done = NULL;
 
-// Name of the log file
-const char* LOG_FILE_PATH = "/system.log";
+// Set while the card is being formatted: the writer keeps the log closed
+static std::atomic<bool> log_suspended{false};
+
+/**
+ * @brief Creates the SD mutex.
+ */
+void sd_mutex_init() {
+    if (sdMutex == NULL) {
+        sdMutex = xSemaphoreCreateMutex();
+    }
+}
+
+/**
+ * @brief Starts the SD log writer task.
+ */
+void sd_init_tasks() {
+    log_flush_done = xSemaphoreCreateBinary();
+    xTaskCreate(sd_log_task, "sd_log_task", 4096, NULL, 1, &sd_log_task_handle);
+}
 
 /**
  * @brief Formats the SD card and creates the initial directory structure.
@@ -38,54 +143,810 @@ const char* LOG_FILE_PATH = "/system.log";
  */
 void format_sd_card() {
     snmp_trap_send("SD Card Format Initiated");
-    log_to_sd("SD Card formatting initiated.");
+    LOG_INFO(LOG_SD, "SD Card formatting initiated.");
 
     // Long buzzer beep to indicate formatting is in progress
     tone(BUZZER_PIN, 1000, 5000); 
 
+    // Close the log file before the file system goes away, and keep the
+    // writer from opening it again until the format is done
+    log_suspended = true;
+    sd_log_flush(pdMS_TO_TICKS(2000));
+
     if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        log_segments_loaded = false;
         if (SD.format()) {
-            log_to_sd("SD card formatted successfully.");
+            LOG_INFO(LOG_SD, "SD card formatted successfully.");
             snmp_trap_send("SD Card Format Successful");
         } else {
-            log_to_sd("SD card format failed.");
+            LOG_ERROR(LOG_SD, "SD card format failed.");
             snmp_trap_send("SD Card Format Failed");
         }
         xSemaphoreGive(sdMutex);
     }
+    log_suspended = false;
+    if (sd_log_task_handle != NULL) xTaskNotifyGive(sd_log_task_handle);
     
     // Stop the buzzer tone after formatting is complete
     noTone(BUZZER_PIN);
 }
 
 /**
- * @brief Appends a message to the log file on the SD card and the ring buffer.
+ * @brief Fills a log record; the arguments are packed, not formatted.
  */
-void log_to_sd(const String& message) {
-    if (sdMutex == NULL) {
-        sdMutex = xSemaphoreCreateMutex();
+static void fill_log_record(LogRecord* record, uint8_t level, uint8_t module, const char* format, va_list args) {
+    record->time = (uint32_t)time(NULL);
+    record->uptime_ms = millis();
+    record->format = format;
+    record->level = level;
+    record->module = module;
+    record->length = log_encode_args(record->args, LOG_RECORD_ARGS, format, args);
+}
+
+/**
+ * @brief Packs a message into the log ring; never waits for the card.
+ */
+void log_write(uint8_t level, uint8_t module, const char* format, ...) {
+    LogRecord* record = log_ring.reserve();
+    if (record == NULL) return;
+
+    va_list args;
+    va_start(args, format);
+    fill_log_record(record, level, module, format, args);
+    va_end(args);
+    log_ring.commit(record);
+
+    if (sd_log_task_handle != NULL) {
+        xTaskNotifyGive(sd_log_task_handle);
+    }
+}
+
+static uint32_t log_segment_max_bytes() {
+    return config.SD.LOG_SEGMENT_KB > 0 ? (uint32_t)config.SD.LOG_SEGMENT_KB * 1024 : 0;
+}
+
+static uint32_t log_segment_max_age_ms() {
+    return config.SD.LOG_SEGMENT_HOURS > 0 ? (uint32_t)config.SD.LOG_SEGMENT_HOURS * 3600000UL : 0;
+}
+
+/**
+ * @brief Wall clock age of the open segment since its first timed record, 0 while unknown.
+ */
+static uint32_t log_segment_age_ms() {
+    uint32_t now = (uint32_t)time(NULL);
+    if (log_segment_first_time < LOG_VALID_TIME || now < log_segment_first_time) return 0;
+    uint64_t age_ms = (uint64_t)(now - log_segment_first_time) * 1000;
+    return age_ms < UINT32_MAX ? (uint32_t)age_ms : UINT32_MAX;
+}
+
+static uint32_t segment_first_time(size_t index);
+
+/**
+ * @brief Deletes a segment and its index; call under sdMutex.
+ */
+static void remove_log_segment(const LogSegment& segment) {
+    char path[LOG_SEGMENT_PATH_MAX];
+    log_segment_path(path, sizeof(path), segment.seq, segment.binary);
+    SD.remove(path);
+    log_index_path(path, sizeof(path), segment.seq);
+    if (SD.exists(path)) SD.remove(path);
+}
+
+/**
+ * @brief Reads the segment table from the card; call under sdMutex.
+ *
+ * Creates the segment directory if needed and moves the single log file of
+ * earlier firmware (SD.LOG_FILE_PATH, or its binary twin) into it.
+ */
+static void load_log_segments() {
+    log_segments.clear();
+    log_reader_seq = 0;
+    if (!SD.exists(LOG_SEGMENT_DIR)) SD.mkdir(LOG_SEGMENT_DIR);
+
+    LogSegment segment;
+    LogSegment evicted;
+    File dir = SD.open(LOG_SEGMENT_DIR);
+    if (dir) {
+        File entry;
+        while ((entry = dir.openNextFile())) {
+            bool found = !entry.isDirectory() && log_segment_parse(entry.name(), &segment.seq, &segment.binary);
+            segment.bytes = entry.size();
+            segment.first_time = LOG_SEGMENT_TIME_UNREAD;
+            entry.close();
+            if (found && !log_segments.add(segment, &evicted)) remove_log_segment(evicted);
+        }
+        dir.close();
+    }
+
+    const char* legacy_paths[] = {LOG_LEGACY_BINARY_PATH, config.SD.LOG_FILE_PATH};
+    for (const char* legacy : legacy_paths) {
+        if (legacy[0] == '\0' || !SD.exists(legacy)) continue;
+        File file = SD.open(legacy, FILE_READ);
+        if (!file) continue;
+        segment = {log_segments.next_seq(), (uint32_t)file.size(), strstr(legacy, ".bin") != NULL, LOG_SEGMENT_TIME_UNREAD};
+        file.close();
+        char path[LOG_SEGMENT_PATH_MAX];
+        log_segment_path(path, sizeof(path), segment.seq, segment.binary);
+        if (SD.rename(legacy, path) && !log_segments.add(segment, &evicted)) remove_log_segment(evicted);
+    }
+    log_segments_loaded = true;
+}
+
+/**
+ * @brief Opens the newest segment and its index for appending, or starts a new one; call under sdMutex.
+ *
+ * A new segment is started if the newest is closed, full or in the other
+ * format. After a format of the card the table is read again.
+ */
+static void open_log_segment() {
+    if (!log_segments_loaded || !SD.exists(LOG_SEGMENT_DIR)) load_log_segments();
+
+    const LogSegment* newest = log_segments.newest();
+    if (newest == NULL || log_segment_closed || newest->binary != log_binary ||
+        log_segment_due(newest->bytes, 0, log_segment_max_bytes(), 0)) {
+        LogSegment segment = {log_segments.next_seq(), 0, log_binary, LOG_SEGMENT_TIME_UNREAD};
+        LogSegment evicted;
+        if (!log_segments.add(segment, &evicted)) remove_log_segment(evicted);
+        newest = log_segments.newest();
+    } else {
+        // A reopened segment keeps the age of its first record
+        uint32_t first_time = segment_first_time(log_segments.count() - 1);
+        if (first_time >= LOG_VALID_TIME) log_segment_first_time = first_time;
+    }
+    log_segment_closed = false;
+
+    char path[LOG_SEGMENT_PATH_MAX];
+    log_segment_path(path, sizeof(path), newest->seq, newest->binary);
+    log_file = SD.open(path, FILE_APPEND);
+    log_file_size = log_file ? log_file.size() : 0;
+    log_segments.set_newest_bytes(log_file_size);
+
+    log_index_path(path, sizeof(path), newest->seq);
+    if (log_file) log_index_file = SD.open(path, FILE_APPEND);
+}
+
+/**
+ * @brief Closes the segment and its index; call under sdMutex.
+ *
+ * The next record starts a binary session and an index point in whatever
+ * file is opened next.
+ */
+static void close_log_segment() {
+    log_file.close();
+    log_index_file.close();
+    log_encoder.reset();
+    log_indexer.restart();
+    log_segment_first_time = 0;
+}
+
+/**
+ * @brief Appends the index entries of the batch bytes just written; call under sdMutex.
+ *
+ * The entries follow the log bytes they point to. If they cannot be written
+ * the segment only gets sparser; queries read further instead.
+ */
+static void write_log_index(size_t size, uint32_t offset) {
+    LogIndexEntry entries[LOG_INDEX_PENDING];
+    size_t count = log_indexer.take(size, offset, entries, LOG_INDEX_PENDING);
+    if (count > 0 && log_index_file) {
+        log_index_file.write((const uint8_t*)entries, count * sizeof(LogIndexEntry));
+        log_index_file.flush();
+    }
+}
+
+/**
+ * @brief Writes the first `size` bytes of the batch buffer to the log file.
+ *
+ * The file is kept open between writes. If the write fails, everything
+ * buffered is dropped, so a missing card cannot stall the writer, and the file
+ * is reopened on the next write, starting a new binary log session.
+ */
+static void write_log_batch(size_t size) {
+    bool ok = false;
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        if (!log_file) open_log_segment();
+        if (log_file) {
+            ok = log_file.write((const uint8_t*)log_batch, size) == size;
+            log_file.flush();
+            if (ok) {
+                write_log_index(size, log_file_size);
+                log_file_size += size;
+                log_segments.set_newest_bytes(log_file_size);
+            } else {
+                close_log_segment();
+            }
+        }
+        xSemaphoreGive(sdMutex);
+    }
+    if (!ok) {
+        // SNMP Trap for SD write failure
+        snmp_trap_send("SD Card Write Failed");
+        // The rest of the batch may depend on the lost session and dictionary
+        size = log_buffered;
+        log_encoder.reset();
+        log_indexer.restart();
+    }
+
+    log_buffered -= size;
+    memmove(log_batch, log_batch + size, log_buffered);
+    log_oldest_ms = millis();
+}
+
+/**
+ * @brief Writes out and closes the current segment; the next write starts a new one.
+ *
+ * Called between two records, so the new segment, and its binary session,
+ * starts with the next record.
+ */
+static void rotate_log_segment() {
+    if (log_buffered > 0) write_log_batch(log_buffered);
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        close_log_segment();
+        log_segment_closed = true;
+        xSemaphoreGive(sdMutex);
     }
+}
 
+/**
+ * @brief Deletes the oldest segment if the segments exceed SD.LOG_RETAIN_MB.
+ *
+ * One segment per call, so deleting a backlog of old files does not hold up
+ * the log writes for long.
+ */
+static void prune_log_segments() {
+    uint64_t budget = config.SD.LOG_RETAIN_MB > 0 ? (uint64_t)config.SD.LOG_RETAIN_MB * 1024 * 1024 : UINT64_MAX;
     if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
-        // Get current timestamp
-        struct tm timeinfo;
-        time_t now;
-        time(&now);
-        localtime_r(&now, &timeinfo);
-        char timestamp_str[20];
-        strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%d %H:%M:%S", &timeinfo);
-
-        // Append to file
-        File logFile = SD.open(LOG_FILE_PATH, FILE_APPEND);
-        if (logFile) {
-            logFile.printf("[%s] %s\n", timestamp_str, message.c_str());
-            logFile.close();
+        if (log_segments.over_budget(budget)) {
+            remove_log_segment(log_segments.at(0));
+            log_segments.remove_oldest();
+        }
+        xSemaphoreGive(sdMutex);
+    }
+}
+
+/**
+ * @brief Encodes one record into the batch buffer, writing out a full batch first.
+ *
+ * Starts a new segment first if the current one is full or old enough.
+ */
+static void append_log_record(const LogRecord& record) {
+    if (log_file && log_segment_due(log_file_size + log_buffered, log_segment_age_ms(), log_segment_max_bytes(),
+                                    log_segment_max_age_ms())) {
+        rotate_log_segment();
+    }
+    if (log_segment_first_time < LOG_VALID_TIME && record.time >= LOG_VALID_TIME) {
+        log_segment_first_time = record.time;
+    }
+    if (log_buffered + LOG_ENCODED_MAX > sizeof(log_batch)) {
+        write_log_batch(log_batch_size(log_file_size, log_buffered, false));
+    }
+    if (log_buffered == 0) {
+        log_oldest_ms = millis();
+        // The format can only change while no file is open and nothing is buffered
+        if (!log_file) log_binary = config.SD.LOG_BINARY;
+    }
+    // A binary index point starts a session, so it can be decoded on its own
+    if (log_indexer.mark(record.time, log_buffered) && log_binary) log_encoder.reset();
+    size_t n;
+    if (log_binary) {
+        n = log_encoder.encode(log_batch + log_buffered, LOG_ENCODED_MAX, record);
+    } else {
+        n = log_format_line((char*)log_batch + log_buffered, LOG_LINE_MAX, record);
+    }
+    log_buffered += n;
+    log_indexer.appended(n);
+}
+
+/**
+ * @brief Appends a message of the writer itself.
+ */
+static void append_log_note(uint8_t level, uint8_t module, const char* format, ...) {
+    LogRecord note;
+    va_list args;
+    va_start(args, format);
+    fill_log_record(&note, level, module, format, args);
+    va_end(args);
+    append_log_record(note);
+}
+
+/**
+ * @brief FreeRTOS task writing the queued log messages to the SD card.
+ */
+void sd_log_task(void* pvParameters) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_WRITER_POLL_MS));
+        bool flush = log_flush_requested.exchange(false);
+
+        // While the card is formatted the messages wait in the ring; only the
+        // flush that closes the log still runs
+        if (log_suspended && !flush) continue;
+
+        // Move every queued message into the batch buffer
+        LogRecord* record;
+        while ((record = log_ring.acquire()) != NULL) {
+            append_log_record(*record);
+            log_ring.release(record);
+        }
+
+        uint32_t dropped = log_ring.take_dropped();
+        if (dropped > 0) {
+            append_log_note(LOG_LEVEL_WARN, LOG_SD, "%u messages dropped", (unsigned)dropped);
+        }
+
+        // Whole sectors once a batch is large enough; everything on age or flush
+        bool aged = log_buffered > 0 && millis() - log_oldest_ms >= LOG_FLUSH_AGE_MS;
+        size_t size;
+        while ((size = log_batch_size(log_file_size, log_buffered, flush || aged)) > 0) {
+            write_log_batch(size);
+        }
+
+        // After a flush the file is closed, so a restart or format finds it complete
+        if (flush) {
+            if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+                close_log_segment();
+                xSemaphoreGive(sdMutex);
+            }
+            xSemaphoreGive(log_flush_done);
+        }
+
+        prune_log_segments();
+    }
+}
+
+/**
+ * @brief Writes every queued log message to the SD card.
+ */
+bool sd_log_flush(TickType_t timeout) {
+    if (sd_log_task_handle == NULL) return false;
+    xSemaphoreTake(log_flush_done, 0);
+    log_flush_requested = true;
+    xTaskNotifyGive(sd_log_task_handle);
+    return xSemaphoreTake(log_flush_done, timeout) == pdTRUE;
+}
+
+/**
+ * @struct LogFileRange
+ * @brief A file read up to a limit, for LogReader.
+ */
+struct LogFileRange {
+    File* file;
+    uint32_t remaining;
+};
+
+static size_t read_log_range(void* context, uint8_t* buffer, size_t size) {
+    LogFileRange* range = (LogFileRange*)context;
+    if (size > range->remaining) size = range->remaining;
+    size_t n = size > 0 ? range->file->read(buffer, size) : 0;
+    range->remaining -= n;
+    return n;
+}
+
+static bool read_index_entry(void* context, size_t index, LogIndexEntry* entry) {
+    File* file = (File*)context;
+    return file->seek(index * sizeof(LogIndexEntry)) &&
+           file->read((uint8_t*)entry, sizeof(LogIndexEntry)) == sizeof(LogIndexEntry);
+}
+
+/**
+ * @struct LogSegmentFiles
+ * @brief A segment and its index, open for a query.
+ */
+struct LogSegmentFiles {
+    File data;
+    File index;
+    uint32_t size;              // Segment bytes
+    size_t entries;             // Index entries that point into the segment
+};
+
+/**
+ * @brief Opens a segment and its index for reading; call under sdMutex.
+ *
+ * @return False if the segment cannot be opened; a missing index leaves `entries` 0.
+ */
+static bool open_segment_files(const LogSegment& segment, LogSegmentFiles* files) {
+    char path[LOG_SEGMENT_PATH_MAX];
+    log_segment_path(path, sizeof(path), segment.seq, segment.binary);
+    files->data = SD.open(path, FILE_READ);
+    files->size = files->data ? files->data.size() : 0;
+    files->entries = 0;
+
+    log_index_path(path, sizeof(path), segment.seq);
+    if (files->data && SD.exists(path)) {
+        files->index = SD.open(path, FILE_READ);
+        size_t count = files->index ? files->index.size() / sizeof(LogIndexEntry) : 0;
+        // Entries beyond the end of the segment, e.g. after a reset, do not count
+        size_t last = files->size > 0 ? log_index_find_offset(read_index_entry, &files->index, count, files->size - 1) : count;
+        files->entries = last < count ? last + 1 : 0;
+    }
+    return (bool)files->data;
+}
+
+static void close_segment_files(LogSegmentFiles* files) {
+    files->data.close();
+    files->index.close();
+}
+
+static size_t count_lines(const char* text, size_t length) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\n') count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Copies the last `lines` lines of a text segment into `out`.
+ *
+ * Reads only as much of the end of the segment as fits into `out`. `whole`
+ * is set if that is the entire segment, so older lines may follow.
+ */
+static size_t tail_text_log(LogSegmentFiles& files, char* out, size_t capacity, size_t lines, bool* whole) {
+    size_t size = files.size;
+    size_t length = size < capacity - 1 ? size : capacity - 1;
+    files.data.seek(size - length);
+    length = files.data.read((uint8_t*)out, length);
+
+    // Skip a partial first line, then keep the last `lines` lines
+    size_t begin = 0;
+    if (length < size) {
+        while (begin < length && out[begin] != '\n') begin++;
+        if (begin < length) begin++;
+    }
+    size_t count = 0;
+    for (size_t i = length; i > begin; i--) {
+        if (out[i - 1] == '\n' && i != length && ++count == lines) {
+            begin = i;
+            break;
+        }
+    }
+    *whole = begin == 0 && length == size;
+    memmove(out, out + begin, length - begin);
+    return length - begin;
+}
+
+/**
+ * @brief Renders the last `lines` messages between two offsets of a binary segment.
+ *
+ * `begin` is an index point, where a session starts. The range is decoded
+ * once; `out` holds the newest lines as a ring, the oldest dropped as newer
+ * ones arrive, and is straightened at the end. `whole` is set if all
+ * messages of the range are in `out`.
+ */
+static size_t tail_binary_range(File& file, uint32_t begin, uint32_t end, char* out, size_t capacity, size_t lines,
+                                bool* whole) {
+    *whole = true;
+    size_t ring = capacity - 1;
+    if (ring == 0 || lines == 0) return 0;
+
+    LogRecord record;
+    LogFileRange range = {&file, end - begin};
+    file.seek(begin);
+    log_reader.begin(read_log_range, &range);
+    log_reader_seq = 0;
+    size_t head = 0;
+    size_t length = 0;
+    size_t count = 0;
+    char line[LOG_LINE_MAX];
+    while (log_reader.next(&record)) {
+        size_t n = log_format_line(line, sizeof(line), record);
+        if (n > ring) {
+            *whole = false;
+            continue;
+        }
+        // Drop the oldest lines until the new one fits and at most `lines` remain
+        while (length > 0 && (length + n > ring || count >= lines)) {
+            size_t drop = 0;
+            while (drop < length && out[(head + drop) % ring] != '\n') drop++;
+            drop = drop < length ? drop + 1 : length;
+            head = (head + drop) % ring;
+            length -= drop;
+            count--;
+            *whole = false;
+        }
+        size_t tail = (head + length) % ring;
+        size_t first = std::min(n, ring - tail);
+        memcpy(out + tail, line, first);
+        memcpy(out, line + first, n - first);
+        length += n;
+        count++;
+    }
+    std::rotate(out, out + head, out + ring);
+    return length;
+}
+
+/**
+ * @brief Renders the last `lines` messages of a binary segment into `out`.
+ *
+ * Walks the index backwards and decodes one stride at a time, from the last
+ * index point to the end of the segment first, until it has enough lines.
+ * Without an index the whole segment is one stride, decoded once. `whole`
+ * is set if the entire segment is in `out`.
+ */
+static size_t tail_binary_log(LogSegmentFiles& files, char* out, size_t capacity, size_t lines, bool* whole) {
+    size_t length = 0;
+    size_t found = 0;
+    uint32_t end = files.size;
+    size_t entry_index = files.entries;
+    *whole = true;
+    while (end > 0 && *whole) {
+        if (found == lines || length + 1 >= capacity) {
+            *whole = false;
+            break;
+        }
+        LogIndexEntry entry = {0, 0};
+        if (entry_index > 0 && !read_index_entry(&files.index, --entry_index, &entry)) entry.offset = 0;
+        if (entry.offset >= end) continue;
+
+        char* older = out + length;
+        size_t n = tail_binary_range(files.data, entry.offset, end, older, capacity - length, lines - found, whole);
+        found += count_lines(older, n);
+        std::rotate(out, older, older + n);
+        length += n;
+        end = entry.offset;
+    }
+    return length;
+}
+
+/**
+ * @brief Renders the last lines of the log as text.
+ *
+ * Goes back through the segments, newest first, until it has enough lines or
+ * the buffer is full. Each older segment is rendered into the free end of
+ * the buffer and rotated in front of the newer text; a segment that did not
+ * fit entirely is the last one.
+ */
+size_t sd_log_tail(char* out, size_t capacity, size_t lines) {
+    if (capacity == 0) return 0;
+    size_t length = 0;
+    if (lines > 0 && xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        if (!log_segments_loaded) load_log_segments();
+        size_t found = 0;
+        bool whole = true;
+        for (size_t i = log_segments.count(); i-- > 0 && whole && found < lines && length + 1 < capacity;) {
+            const LogSegment& segment = log_segments.at(i);
+            LogSegmentFiles files;
+            if (!open_segment_files(segment, &files)) continue;
+            char* older = out + length;
+            size_t n = segment.binary ? tail_binary_log(files, older, capacity - length, lines - found, &whole)
+                                      : tail_text_log(files, older, capacity - length, lines - found, &whole);
+            close_segment_files(&files);
+            found += count_lines(older, n);
+            std::rotate(out, older, older + n);
+            length += n;
+        }
+        xSemaphoreGive(sdMutex);
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Time of the first timed index entry of segment `index`, read once; call under sdMutex.
+ *
+ * Entries logged before the clock was set are skipped. 0 for a segment
+ * without an index or without a timed entry.
+ */
+static uint32_t segment_first_time(size_t index) {
+    const LogSegment& segment = log_segments.at(index);
+    if (segment.first_time != LOG_SEGMENT_TIME_UNREAD) return segment.first_time;
+
+    LogIndexEntry entry = {0, 0};
+    char path[LOG_SEGMENT_PATH_MAX];
+    log_index_path(path, sizeof(path), segment.seq);
+    File file = SD.exists(path) ? SD.open(path, FILE_READ) : File();
+    size_t count = file ? file.size() / sizeof(LogIndexEntry) : 0;
+    for (size_t i = 0; i < count && entry.time == 0; i++) {
+        if (!read_index_entry(&file, i, &entry)) entry.time = 0;
+    }
+    file.close();
+    // The segment being written may not have its first timed entry yet
+    if (entry.time != 0 || index + 1 < log_segments.count()) log_segments.set_first_time(index, entry.time);
+    return entry.time;
+}
+
+/**
+ * @brief Positions a cursor at the first message logged at or after `since`.
+ *
+ * A binary search over the first index times of the segments picks the
+ * segment, one over its index the stride. sd_log_read() skips the earlier
+ * messages in that stride.
+ */
+void sd_log_seek(LogCursor* cursor, uint32_t since, uint32_t until) {
+    cursor->seq = 0;
+    cursor->offset = 0;
+    cursor->since = since;
+    cursor->until = until;
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) != pdTRUE) return;
+    if (!log_segments_loaded) load_log_segments();
+
+    // Without a time to look for, start with the oldest segment
+    size_t low = 0;
+    size_t high = since >= LOG_VALID_TIME ? log_segments.count() : 0;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        // A segment without a time is judged by the next one that has one
+        size_t probe = middle;
+        uint32_t first_time = segment_first_time(probe);
+        while (first_time == 0 && probe + 1 < high) first_time = segment_first_time(++probe);
+        if (first_time != 0 && first_time <= since) {
+            low = probe + 1;
         } else {
-            // SNMP Trap for SD write failure
-            snmp_trap_send("SD Card Write Failed");
+            high = middle;
+        }
+    }
+    if (log_segments.count() > 0) {
+        const LogSegment& segment = log_segments.at(low > 0 ? low - 1 : 0);
+        cursor->seq = segment.seq;
+        LogSegmentFiles files;
+        if (low > 0 && open_segment_files(segment, &files)) {
+            size_t found = log_index_find_time(read_index_entry, &files.index, files.entries, since);
+            LogIndexEntry entry;
+            if (found < files.entries && read_index_entry(&files.index, found, &entry)) cursor->offset = entry.offset;
+        }
+        close_segment_files(&files);
+    }
+    xSemaphoreGive(sdMutex);
+}
+
+/**
+ * @brief Applies the time range of a cursor to a message.
+ *
+ * @return False once the message is past the end of the range.
+ */
+static bool log_cursor_accepts(LogCursor* cursor, bool timed, uint32_t time, bool* keep) {
+    if (timed && time > cursor->until) return false;
+    // Messages from before the clock was set count as part of the range once it started
+    if (cursor->since != 0 && timed && time >= cursor->since) cursor->since = 0;
+    *keep = cursor->since == 0;
+    return true;
+}
+
+/**
+ * @brief Copies the next lines of a text segment in the range of `cursor`.
+ */
+static size_t read_text_range(LogSegmentFiles& files, LogCursor* cursor, char* out, size_t capacity) {
+    size_t want = files.size - cursor->offset;
+    if (want > capacity - 1) want = capacity - 1;
+    files.data.seek(cursor->offset);
+    size_t n = files.data.read((uint8_t*)out, want);
+
+    size_t length = 0;
+    size_t position = 0;
+    while (position < n) {
+        char* newline = (char*)memchr(out + position, '\n', n - position);
+        if (newline == NULL) {
+            // A line cut off at the end of the segment, or garbage without line breaks
+            if (n == files.size - cursor->offset || n - position >= LOG_LINE_MAX) position = n;
+            break;
+        }
+        size_t line = newline + 1 - (out + position);
+        uint32_t time = 0;
+        bool timed = log_line_time(out + position, line, &time);
+        bool keep;
+        if (!log_cursor_accepts(cursor, timed, time, &keep)) {
+            cursor->seq = 0;
+            break;
+        }
+        if (keep) {
+            memmove(out + length, out + position, line);
+            length += line;
+        }
+        position += line;
+    }
+    cursor->offset += position;
+    return length;
+}
+
+/**
+ * @brief Renders the next messages of a binary segment in the range of `cursor`.
+ *
+ * Decodes from the index point before the cursor, so the session and its
+ * dictionary are known, and skips the messages before the cursor. Stops
+ * after LOG_QUERY_SCAN_BYTES, so a long stretch outside the range does not
+ * hold sdMutex for long. If the reader is still where the previous piece
+ * stopped it continues from there, so a segment without an index is decoded
+ * once per query, not once per piece.
+ */
+static size_t read_binary_range(LogSegmentFiles& files, LogCursor* cursor, char* out, size_t capacity) {
+    LogFileRange range;
+    LogRecord record;
+    bool pending = false;
+    if (log_reader_seq == cursor->seq && log_reader_stop == cursor->offset) {
+        uint32_t resume = log_reader_begin + log_reader.read_offset();
+        range = {&files.data, files.size > resume ? files.size - resume : 0};
+        files.data.seek(resume);
+        log_reader.resume(read_log_range, &range);
+        pending = log_reader_pending;
+        record = log_reader_record;
+    } else {
+        size_t found = log_index_find_offset(read_index_entry, &files.index, files.entries, cursor->offset);
+        LogIndexEntry entry = {0, 0};
+        if (found >= files.entries || !read_index_entry(&files.index, found, &entry)) entry.offset = 0;
+
+        log_reader_begin = entry.offset;
+        range = {&files.data, files.size - entry.offset};
+        files.data.seek(entry.offset);
+        log_reader.begin(read_log_range, &range);
+    }
+    log_reader_seq = 0;
+
+    uint32_t scan_end = cursor->offset + LOG_QUERY_SCAN_BYTES;
+    size_t length = 0;
+    char line[LOG_LINE_MAX];
+    while (true) {
+        if (!pending && !log_reader.next(&record)) {
+            cursor->offset = files.size;
+            break;
+        }
+        pending = false;
+        uint32_t end = log_reader_begin + log_reader.position();
+        if (end <= cursor->offset) continue;
+
+        bool keep;
+        if (!log_cursor_accepts(cursor, record.time >= LOG_VALID_TIME, record.time, &keep)) {
+            cursor->seq = 0;
+            break;
+        }
+        if (keep) {
+            size_t n = log_format_line(line, sizeof(line), record);
+            if (length + n > capacity - 1) {
+                pending = true;
+                break;
+            }
+            memcpy(out + length, line, n);
+            length += n;
+        }
+        cursor->offset = end;
+        if (end >= scan_end) break;
+    }
+
+    // Stopped inside the segment: the next piece continues from here
+    if (cursor->seq != 0 && cursor->offset < files.size) {
+        log_reader_seq = cursor->seq;
+        log_reader_stop = cursor->offset;
+        log_reader_pending = pending;
+        log_reader_record = record;
+    }
+    return length;
+}
+
+/**
+ * @brief Renders the next lines of a time range.
+ */
+size_t sd_log_read(LogCursor* cursor, char* out, size_t capacity) {
+    if (capacity == 0) return 0;
+    size_t length = 0;
+    if (cursor->seq != 0 && xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        if (!log_segments_loaded) load_log_segments();
+
+        // The segment of the cursor, or the next one if it was deleted meanwhile
+        size_t i = 0;
+        while (i < log_segments.count() && log_segments.at(i).seq < cursor->seq) i++;
+        if (i == log_segments.count()) {
+            cursor->seq = 0;
+        } else {
+            const LogSegment& segment = log_segments.at(i);
+            if (segment.seq != cursor->seq) {
+                cursor->seq = segment.seq;
+                cursor->offset = 0;
+            }
+            LogSegmentFiles files;
+            open_segment_files(segment, &files);
+            if (cursor->offset < files.size) {
+                length = segment.binary ? read_binary_range(files, cursor, out, capacity)
+                                        : read_text_range(files, cursor, out, capacity);
+            }
+            // Continue in the next segment; the range ends with the newest
+            if (cursor->seq != 0 && cursor->offset >= files.size) {
+                cursor->seq = i + 1 < log_segments.count() ? log_segments.at(i + 1).seq : 0;
+                cursor->offset = 0;
+            }
+            close_segment_files(&files);
         }
         xSemaphoreGive(sdMutex);
     }
+    out[length] = '\0';
+    return length;
 }
 
 /**
@@ -93,32 +954,42 @@ void log_to_sd(const String& message) {
  */
 void sd_monitor_task(void* pvParameters) {
     // Initial check on startup
-    if (SD.cardSize() > 0) {
-        uint64_t totalBytes = SD.cardSize() / (1024 * 1024);
-        uint64_t usedBytes = SD.usedBytes() / (1024 * 1024);
-        int usagePercent = (usedBytes * 100) / totalBytes;
-        log_to_sd("SD Card: Total " + String(totalBytes) + " MB, Used " + String(usedBytes) + " MB (" + String(usagePercent) + "%)");
+    if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
+        if (SD.cardSize() > 0) {
+            uint64_t totalBytes = SD.cardSize() / (1024 * 1024);
+            uint64_t usedBytes = SD.usedBytes() / (1024 * 1024);
+            int usagePercent = (usedBytes * 100) / totalBytes;
+            LOG_INFO(LOG_SD, "SD Card: Total %llu MB, Used %llu MB (%d%%)", totalBytes, usedBytes, usagePercent);
+        }
+        xSemaphoreGive(sdMutex);
     }
 
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(config.SD_MONITOR_INTERVAL * 1000));
 
+        // Only the card queries need the mutex; the 20 s LED alert must not
+        // hold off the log writer and the web server
+        bool available = false;
+        int usagePercent = 0;
         if (xSemaphoreTake(sdMutex, portMAX_DELAY) == pdTRUE) {
             if (SD.cardSize() > 0) {
                 uint64_t totalBytes = SD.cardSize() / (1024 * 1024);
                 uint64_t usedBytes = SD.usedBytes() / (1024 * 1024);
-                int usagePercent = (usedBytes * 100) / totalBytes;
-
-                if (usagePercent > config.SD_USAGE_THRESHOLD) {
-                    log_to_sd("WARNING: SD card storage is over " + String(config.SD_USAGE_THRESHOLD) + "% full. Used: " + String(usagePercent) + "%.");
-                    // Blink onboard LED red and fast for 20 seconds
-                    flash_onboard_led(ONBOARD_LED, CRGB::Red, 20000, 100);
-                }
-            } else {
-                log_to_sd("SD card not available during monitor check.");
-                snmp_trap_send("SD Card Monitor Failed");
+                usagePercent = (usedBytes * 100) / totalBytes;
+                available = true;
             }
             xSemaphoreGive(sdMutex);
+        } else {
+            continue;
+        }
+
+        if (!available) {
+            LOG_ERROR(LOG_SD, "SD card not available during monitor check.");
+            snmp_trap_send("SD Card Monitor Failed");
+        } else if (usagePercent > config.SD_USAGE_THRESHOLD) {
+            LOG_WARN(LOG_SD, "SD card storage is over %d%% full. Used: %d%%.", config.SD_USAGE_THRESHOLD, usagePercent);
+            // Blink onboard LED red and fast for 20 seconds
+            flash_onboard_led(ONBOARD_LED, CRGB::Red, 20000, 100);
         }
     }
 }
@@ -126,7 +997,7 @@ void sd_monitor_task(void* pvParameters) {
 // Function to write initial website files if they don't exist
 void setup_web_files() {
     if (!SD.exists("/www")) {
-        log_to_sd("Creating /www directory on SD card.");
+        LOG_INFO(LOG_SD, "Creating /www directory on SD card.");
         SD.mkdir("/www");
     }
 }
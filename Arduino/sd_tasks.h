@@ -15,6 +15,9 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/ringbuf.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Task handles
 extern TaskHandle_t sd_log_task_handle;
@@ -23,22 +26,94 @@ extern TaskHandle_t sd_monitor_task_handle;
 // Ring buffer handle
 extern RingbufHandle_t log_ring_buffer;
 
+// Guards every access to the SD card; created by sd_mutex_init()
+extern SemaphoreHandle_t sdMutex;
+
+/**
+ * @brief Creates sdMutex.
+ *
+ * Call first thing in setup(), before anything touches the card.
+ */
+void sd_mutex_init();
 
 /**
  * @brief Initializes SD card and creates SD-related tasks.
+ *
+ * Starts the SD log writer; call once the card is mounted and sdMutex exists. Messages logged
+ * before that are kept in the log ring until the writer starts.
  */
 void sd_init_tasks();
 
 
 
 /**
- * @brief Appends a message to the log file on the SD card and the ring buffer.
+ * @brief FreeRTOS task writing the queued log messages to the SD card in batches.
+ *
+ * @param pvParameters Standard FreeRTOS task parameters (not used).
+ */
+void sd_log_task(void* pvParameters);
+
+/**
+ * @brief Writes every queued log message to the SD card, e.g. before a restart.
+ *
+ * @param timeout Maximum time to wait for the writer.
+ * @return True if the writer confirmed the flush in time.
+ */
+bool sd_log_flush(TickType_t timeout);
+
+/**
+ * @brief Renders the last lines of the SD log as text, for the web log view and SSH.
+ *
+ * Reads back through the log segments, text or binary, newest first, and a
+ * binary segment one index stride at a time, so the time taken depends on
+ * the lines requested rather than on the size of the log. Messages still
+ * waiting in the writer's batch buffer are not included.
+ *
+ * @param out Output buffer; always NUL-terminated.
+ * @param capacity Size of the output buffer; the oldest lines are left out if
+ *        the requested lines do not fit.
+ * @param lines Number of lines to return.
+ * @return The text length.
+ */
+size_t sd_log_tail(char* out, size_t capacity, size_t lines);
+
+/**
+ * @struct LogCursor
+ * @brief Position of a time range query in the SD log.
+ */
+struct LogCursor {
+    uint32_t seq;       // Segment read next, 0 once the range is complete
+    uint32_t offset;    // Offset in that segment after the last message read
+    uint32_t since;     // Start of the range, 0 once reached
+    uint32_t until;     // End of the range, inclusive
+};
+
+/**
+ * @brief Starts a query for the messages logged between two times.
+ *
+ * Finds the segment and its index stride with binary searches, so it costs
+ * the same for any log size. Messages logged before the clock was set have no
+ * time; they are returned where they fall inside the range.
+ *
+ * @param cursor The query to start.
+ * @param since Wall clock time of the first message.
+ * @param until Wall clock time of the last message, UINT32_MAX for no end.
+ */
+void sd_log_seek(LogCursor* cursor, uint32_t since, uint32_t until);
+
+/**
+ * @brief Renders the next messages of a query as text lines.
  *
- * This function is thread-safe and can be called from any task.
+ * Takes sdMutex for one piece of the log, so the query can be sent out in
+ * chunks while the writer keeps logging. May return no text before the range
+ * is complete, e.g. while skipping the messages before its start.
  *
- * @param message The message to log.
+ * @param cursor The query; `cursor->seq` is 0 once it is complete.
+ * @param out Output buffer; always NUL-terminated.
+ * @param capacity Size of the output buffer, more than LOG_LINE_MAX.
+ * @return The text length.
  */
-void log_to_sd(const String& message);
+size_t sd_log_read(LogCursor* cursor, char* out, size_t capacity);
 
 /**
  * @brief FreeRTOS task for monitoring SD card usage.
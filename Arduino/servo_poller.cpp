@@ -0,0 +1,176 @@
+/**
+ * @file servo_poller.cpp
+ * @brief Implementation of the per-tick servo polling logic.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "servo_poller.h"
+#include "version.h"
+#include "modbus_stats.h"
+
+void ServoPoller::begin(const uint8_t slave_ids[AXIS_COUNT], const int64_t counts_per_rail[AXIS_COUNT]) {
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        this->slave_ids[axis] = slave_ids[axis];
+        this->counts_per_rail[axis] = counts_per_rail[axis];
+    }
+}
+
+int ServoPoller::plan(uint32_t now_ms) {
+    // Decide which registers are due this tick
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        PollScheduler& scheduler = schedulers[axis];
+        bool moving = now_ms - last_move[axis] < POLL_IDLE_AFTER_MS;
+        scheduler.set_mode(moving, PollScheduler::near_rail_end(last_position[axis], counts_per_rail[axis]));
+        wanted[axis][POLL_STATUS] = scheduler.due(POLL_STATUS, now_ms);
+        wanted[axis][POLL_POSITION] = scheduler.due(POLL_POSITION, now_ms);
+    }
+
+    // The gantry pair is always read together, back to back, for the skew monitor
+    gantry_pair = wanted[AXIS_Y][POLL_POSITION] || wanted[AXIS_YY][POLL_POSITION];
+    wanted[AXIS_Y][POLL_POSITION] = gantry_pair;
+    wanted[AXIS_YY][POLL_POSITION] = gantry_pair;
+
+    // Only the registers that are due, coalesced per servo
+    num_reads = 0;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        PollScheduler& scheduler = schedulers[axis];
+        RegisterMap& map = register_maps[axis];
+        map.reset();
+        if (wanted[axis][POLL_STATUS]) {
+            map.add(SERVO_REG_STATUS, 1);
+            scheduler.polled(POLL_STATUS, now_ms);
+        }
+        if (wanted[axis][POLL_POSITION]) {
+            map.add(SERVO_REG_POSITION, 2);
+            scheduler.polled(POLL_POSITION, now_ms);
+        }
+        map.plan();
+        dropped += map.dropped_count();
+
+        for (int i = 0; i < map.span_count(); i++) {
+            ServoRead& read = reads[num_reads++];
+            read = {axis, i, slave_ids[axis], map.span(i).start, map.span(i).count, 0, false, 0, now_ms};
+        }
+    }
+    return num_reads;
+}
+
+uint32_t ServoPoller::tick_ms() const {
+    uint32_t bus_us = 0;
+    for (int i = 0; i < num_reads; i++) {
+        bus_us += modbus_read_wire_us(reads[i].count, baud) + turnaround_us;
+    }
+    uint32_t planned_ms = (bus_us + 999) / 1000;
+    return planned_ms > POLL_TICK_MS ? planned_ms : POLL_TICK_MS;
+}
+
+void ServoPoller::account(int i, const ModbusResponse& response) {
+    modbus_stats_record(reads[i].axis, response.status, response.exception, response.elapsed_us);
+    reads[i].elapsed_us += response.elapsed_us;
+}
+
+bool ServoPoller::retry(int i, ModbusStatus status) {
+    if (status != MODBUS_TIMEOUT && status != MODBUS_CRC_ERROR) return false;
+    if (reads[i].retries >= SERVO_MAX_RETRIES) return false;
+    reads[i].retries++;
+    return true;
+}
+
+void ServoPoller::complete(int i, const ModbusResponse& response, uint32_t done_ms) {
+    ServoRead& read = reads[i];
+    read.ok = response.status == MODBUS_OK;
+    read.done_ms = done_ms;
+    if (read.ok) {
+        register_maps[read.axis].store(read.span, response.registers);
+    }
+}
+
+bool ServoPoller::finish() {
+    int read_index = 0;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        RegisterMap& map = register_maps[axis];
+        PollScheduler& scheduler = schedulers[axis];
+        ServoAxisResult& result = results[axis];
+        result = {};
+        if (map.span_count() == 0) continue;
+
+        result.polled = true;
+        result.position_read = wanted[axis][POLL_POSITION];
+        result.ok = true;
+        bool span_ok[REGISTER_MAP_MAX_RANGES] = {};
+        for (int i = 0; i < map.span_count(); i++) {
+            const ServoRead& read = reads[read_index++];
+            span_ok[i] = read.ok;
+            result.ok = result.ok && read.ok;
+            result.sample_ms = read.done_ms;
+            result.latency_us += read.elapsed_us;
+            scheduler.add_bus_time(read.elapsed_us);
+
+            // Learn the round trip beyond the wire time from first-attempt
+            // answers: follow a slower one at once, decay slowly otherwise
+            uint32_t wire_us = modbus_read_wire_us(read.count, baud);
+            if (read.ok && read.retries == 0 && read.elapsed_us > wire_us) {
+                uint32_t extra_us = read.elapsed_us - wire_us;
+                if (extra_us > turnaround_us) turnaround_us = extra_us;
+                else turnaround_us -= (turnaround_us - extra_us) / 16;
+            }
+        }
+        // A failed read keeps the last known values and marks the axis stale;
+        // the values carried by the other reads of the axis are still taken
+        stale[axis] = !result.ok;
+        int status_span = map.span_of(SERVO_REG_STATUS);
+        int position_span = map.span_of(SERVO_REG_POSITION);
+        result.status_ok = wanted[axis][POLL_STATUS] && status_span >= 0 && span_ok[status_span];
+        result.position_ok = wanted[axis][POLL_POSITION] && position_span >= 0 && span_ok[position_span];
+
+        if (result.status_ok) {
+            status[axis] = map.get_u16(SERVO_REG_STATUS);
+            scheduler.sampled(POLL_STATUS);
+        }
+        if (wanted[axis][POLL_POSITION]) {
+            position_ok[axis] = result.position_ok;
+            if (result.position_ok) {
+                int32_t position = map.get_i32(SERVO_REG_POSITION);
+                if (position != last_position[axis]) {
+                    last_position[axis] = position;
+                    last_move[axis] = result.sample_ms;
+                }
+                position_time[axis] = result.sample_ms;
+                motion[axis].add_sample(result.sample_ms, position, status[axis] & 0x01, status[axis] & 0x02);
+                scheduler.sampled(POLL_POSITION);
+            }
+        }
+    }
+
+    // Both gantry positions were read in this tick: check the racking error.
+    // The reads complete one after the other, so the earlier sample is moved
+    // forward to the time of the later one; otherwise motion reads as skew.
+    if (gantry_pair && position_ok[AXIS_Y] && position_ok[AXIS_YY]) {
+        int32_t y = last_position[AXIS_Y];
+        int32_t yy = last_position[AXIS_YY];
+        uint32_t y_ms = position_time[AXIS_Y];
+        uint32_t yy_ms = position_time[AXIS_YY];
+        if ((int32_t)(yy_ms - y_ms) > 0) y = motion[AXIS_Y].position_at(yy_ms);
+        else if ((int32_t)(y_ms - yy_ms) > 0) yy = motion[AXIS_YY].position_at(y_ms);
+        return skew.update(y, y_ms, yy, yy_ms);
+    }
+    return false;
+}
+
+AxisState ServoPoller::state(int axis) const {
+    AxisState state = {};
+    state.position = last_position[axis];
+    state.status = status[axis];
+    state.min_limit = (status[axis] & 0x01) ? 1 : 0;
+    state.max_limit = (status[axis] & 0x02) ? 1 : 0;
+    state.timestamp_ms = position_time[axis];
+    state.stale = stale[axis];
+    return state;
+}
+
+void ServoPoller::update_stats(uint32_t now_ms) {
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        schedulers[axis].update_stats(now_ms);
+    }
+}
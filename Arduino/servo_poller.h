@@ -0,0 +1,215 @@
+/**
+ * @file servo_poller.h
+ * @brief Per-tick servo polling logic, independent of the bus and the RTOS.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * One poll tick is planned, its reads are carried out by whatever transport
+ * the caller has, and the tick is then finished. Planning asks the poll
+ * schedulers which registers are due and coalesces them into one read per
+ * register span. Finishing decodes the responses, tracks motion and the stale
+ * flag, and feeds the gantry pair to the skew monitor, brought to a common
+ * time with each axis' estimated velocity. On the device,
+ * servo_task drives it through the asynchronous RS485 master (modbus_rtu.h).
+ * The host replay harness in tools/ drives it against the LC10e simulator.
+ */
+#ifndef SERVO_POLLER_H
+#define SERVO_POLLER_H
+
+#include "version.h"
+#include "axis_mailbox.h"
+#include "servo_registers.h"
+#include "poll_scheduler.h"
+#include "gantry_skew.h"
+#include "motion_estimator.h"
+#include "modbus_rtu.h"
+#include <stdint.h>
+
+// Times a timed-out or corrupted read is sent again within its deadline
+#define SERVO_MAX_RETRIES       1
+
+// Most reads a single tick can plan
+#define SERVO_MAX_READS         (AXIS_COUNT * REGISTER_MAP_MAX_RANGES)
+
+// Initial allowance per read for the drive's response delay and the frame
+// detection; afterwards it tracks the slowest recent round trips
+#define SERVO_TURNAROUND_US     1000
+
+/**
+ * @struct ServoRead
+ * @brief One register span read planned for the current tick.
+ */
+struct ServoRead {
+    int axis;
+    int span;                   // Span index in the axis' register map
+    uint8_t slave_id;
+    uint16_t address;
+    uint16_t count;
+    int retries;
+    bool ok;
+    uint32_t elapsed_us;        // Bus time of all attempts
+    uint32_t done_ms;           // When the last attempt completed
+};
+
+/**
+ * @struct ServoAxisResult
+ * @brief What the finished tick did for one axis.
+ */
+struct ServoAxisResult {
+    bool polled;                // Any register of the axis was read
+    bool position_read;         // The position was due this tick
+    bool ok;                    // Every read of the axis succeeded
+    bool status_ok;             // The read holding the status register succeeded
+    bool position_ok;           // The read holding the position registers succeeded
+    uint32_t sample_ms;         // Completion time of the axis' last read
+    uint32_t latency_us;        // Bus time of the axis' reads
+};
+
+/**
+ * @class ServoPoller
+ * @brief Plans, accounts and decodes the servo reads of one poll tick.
+ */
+class ServoPoller {
+public:
+    /**
+     * @brief Sets the slave addresses and rail lengths.
+     *
+     * @param slave_ids The Modbus slave ID of each axis.
+     * @param counts_per_rail Encoder counts over each rail, <= 0 if unknown.
+     */
+    void begin(const uint8_t slave_ids[AXIS_COUNT], const int64_t counts_per_rail[AXIS_COUNT]);
+
+    /**
+     * @brief Sets the bus baud rate the tick length is planned with.
+     */
+    void set_baud(uint32_t baud) { this->baud = baud; }
+
+    /**
+     * @brief Marks registers a slave answers beyond the ones used, so reads
+     *        of its status and position can be merged across them.
+     *
+     * @return False if the axis' register map is full.
+     */
+    bool allow(int axis, uint16_t address, uint16_t count) { return register_maps[axis].allow(address, count); }
+
+    /**
+     * @brief Gives access to the gantry skew monitor, e.g. to configure it.
+     */
+    SkewMonitor& skew_monitor() { return skew; }
+
+    /**
+     * @brief Plans the reads that are due this tick.
+     *
+     * @param now_ms The current time in milliseconds.
+     * @return The number of reads to carry out.
+     */
+    int plan(uint32_t now_ms);
+
+    int read_count() const { return num_reads; }
+    const ServoRead& read(int i) const { return reads[i]; }
+
+    /**
+     * @brief Length of the planned tick: the wire time of its reads plus the
+     *        learned turnaround of each, at least POLL_TICK_MS.
+     */
+    uint32_t tick_ms() const;
+
+    /**
+     * @brief Accounts one attempt of read `i` in the Modbus statistics.
+     */
+    void account(int i, const ModbusResponse& response);
+
+    /**
+     * @brief Returns true if read `i` should be sent again after this outcome.
+     *
+     * Counts the attempt against SERVO_MAX_RETRIES.
+     */
+    bool retry(int i, ModbusStatus status);
+
+    /**
+     * @brief Completes read `i` and stores its registers.
+     *
+     * @param i The read index.
+     * @param response The final response; its registers are copied.
+     * @param done_ms When the response was received.
+     */
+    void complete(int i, const ModbusResponse& response, uint32_t done_ms);
+
+    /**
+     * @brief Decodes the completed reads.
+     *
+     * Status and position are each taken from the read whose span holds
+     * them, so a failed read only loses the registers it carried. A failed
+     * read keeps the last known values and marks the axis stale.
+     *
+     * @return True if the gantry pair raised the skew alarm in this tick.
+     */
+    bool finish();
+
+    /**
+     * @brief Returns what the last finished tick did for an axis.
+     */
+    const ServoAxisResult& result(int axis) const { return results[axis]; }
+
+    /**
+     * @brief Returns the newest state of an axis.
+     *
+     * `last_move_tick` is left at 0; the caller fills it in its own time base
+     * from `last_move_ms()`.
+     */
+    AxisState state(int axis) const;
+
+    /**
+     * @brief Returns when the position of an axis last changed.
+     */
+    uint32_t last_move_ms(int axis) const { return last_move[axis]; }
+
+    PollStats poll_stats(int axis) const { return schedulers[axis].stats(); }
+
+    /**
+     * @brief Returns the register map of an axis as planned for the current tick.
+     */
+    const RegisterMap& register_map(int axis) const { return register_maps[axis]; }
+
+    /**
+     * @brief Returns how many wanted register ranges planning has left out so far.
+     */
+    uint32_t dropped_ranges() const { return dropped; }
+
+    /**
+     * @brief Closes the statistics windows of the poll schedulers.
+     */
+    void update_stats(uint32_t now_ms);
+
+private:
+    uint8_t slave_ids[AXIS_COUNT] = {};
+    int64_t counts_per_rail[AXIS_COUNT] = {};
+    uint32_t baud = 0;
+    uint32_t turnaround_us = SERVO_TURNAROUND_US;   // Recent slow round trip beyond the wire time
+
+    PollScheduler schedulers[AXIS_COUNT];
+    RegisterMap register_maps[AXIS_COUNT];
+    SkewMonitor skew;
+
+    bool wanted[AXIS_COUNT][POLL_ITEM_COUNT] = {};
+    bool gantry_pair = false;
+    ServoRead reads[SERVO_MAX_READS];
+    int num_reads = 0;
+    uint32_t dropped = 0;
+
+    // Last decoded registers and move bookkeeping per axis
+    uint16_t status[AXIS_COUNT] = {0, 0, 0};
+    int32_t last_position[AXIS_COUNT] = {0, 0, 0};
+    uint32_t position_time[AXIS_COUNT] = {0, 0, 0};
+    uint32_t last_move[AXIS_COUNT] = {0, 0, 0};
+    bool position_ok[AXIS_COUNT] = {false, false, false};
+    bool stale[AXIS_COUNT] = {true, true, true};
+
+    // Velocity of each axis, to align the two gantry samples in time
+    MotionEstimator motion[AXIS_COUNT];
+
+    ServoAxisResult results[AXIS_COUNT] = {};
+};
+
+#endif // SERVO_POLLER_H
@@ -0,0 +1,150 @@
+/**
+ * @file servo_registers.cpp
+ * @brief Implementation of the coalescing servo register map.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "servo_registers.h"
+#include "version.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t modbus_read_wire_us(uint16_t count, uint32_t baud) {
+    if (baud == 0) return 0;
+    uint64_t chars = MODBUS_READ_OVERHEAD_CHARS + 2 * (uint32_t)count;
+    return (uint32_t)((chars * MODBUS_BITS_PER_CHAR * 1000000ULL + baud - 1) / baud);
+}
+
+bool register_range_parse(const char* text, RegisterSpan* span) {
+    if (text == NULL || text[0] == '\0') return false;
+    char* end;
+    unsigned long first = strtoul(text, &end, 10);
+    if (end == text || *end != '-') return false;
+    const char* rest = end + 1;
+    unsigned long last = strtoul(rest, &end, 10);
+    if (end == rest || *end != '\0' || last < first || last > 0xFFFF) return false;
+    *span = {(uint16_t)first, (uint16_t)(last - first + 1)};
+    return true;
+}
+
+bool RegisterMap::add(uint16_t address, uint16_t count) {
+    if (num_ranges >= REGISTER_MAP_MAX_RANGES || count == 0) return false;
+    ranges[num_ranges++] = {address, count};
+    return true;
+}
+
+bool RegisterMap::allow(uint16_t address, uint16_t count) {
+    if (num_allowed >= REGISTER_MAP_MAX_RANGES || count == 0) return false;
+    allowed[num_allowed++] = {address, count};
+    return true;
+}
+
+void RegisterMap::reset() {
+    num_ranges = 0;
+    num_spans = 0;
+    num_dropped = 0;
+}
+
+/**
+ * @brief Returns true if every register in [from, to) is wanted or allowed.
+ */
+bool RegisterMap::readable(uint32_t from, uint32_t to) const {
+    while (from < to) {
+        uint32_t covered = from;
+        for (int i = 0; i < num_ranges; i++) {
+            uint32_t end = ranges[i].start + ranges[i].count;
+            if (from >= ranges[i].start && from < end && end > covered) covered = end;
+        }
+        for (int i = 0; i < num_allowed; i++) {
+            uint32_t end = allowed[i].start + allowed[i].count;
+            if (from >= allowed[i].start && from < end && end > covered) covered = end;
+        }
+        if (covered == from) return false;
+        from = covered;
+    }
+    return true;
+}
+
+int RegisterMap::plan(int overhead_chars) {
+    // Sort the wanted ranges by start address (the map is tiny)
+    RegisterSpan sorted[REGISTER_MAP_MAX_RANGES];
+    memcpy(sorted, ranges, num_ranges * sizeof(RegisterSpan));
+    for (int i = 1; i < num_ranges; i++) {
+        RegisterSpan r = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j].start > r.start) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = r;
+    }
+
+    num_spans = 0;
+    num_dropped = 0;
+    uint16_t offset = 0;
+    for (int i = 0; i < num_ranges; i++) {
+        uint32_t start = sorted[i].start;
+        uint32_t end = start + sorted[i].count;
+
+        if (num_spans > 0) {
+            RegisterSpan& last = spans[num_spans - 1];
+            uint32_t last_end = last.start + last.count;
+            uint32_t merged_end = end > last_end ? end : last_end;
+            int gap = start > last_end ? (int)(start - last_end) : 0;
+
+            // Each unused register costs two characters in the response
+            if (gap * 2 < overhead_chars && readable(last_end, start) &&
+                merged_end - last.start <= MODBUS_MAX_READ_REGISTERS &&
+                offset + (merged_end - last_end) <= REGISTER_MAP_MAX_REGISTERS) {
+                offset += merged_end - last_end;
+                last.count = merged_end - last.start;
+                continue;
+            }
+        }
+
+        if (end - start > MODBUS_MAX_READ_REGISTERS || offset + (end - start) > REGISTER_MAP_MAX_REGISTERS) {
+            num_dropped++;
+            continue;
+        }
+        span_offset[num_spans] = offset;
+        spans[num_spans++] = {(uint16_t)start, (uint16_t)(end - start)};
+        offset += end - start;
+    }
+
+    clear_values();
+    return num_spans;
+}
+
+void RegisterMap::store(int i, const ModbusRegisters& registers) {
+    for (int r = 0; r < spans[i].count; r++) {
+        image[span_offset[i] + r] = registers.get(r);
+    }
+}
+
+void RegisterMap::clear_values() {
+    memset(image, 0, sizeof(image));
+}
+
+int RegisterMap::span_of(uint16_t address) const {
+    for (int i = 0; i < num_spans; i++) {
+        if (address >= spans[i].start && address < spans[i].start + spans[i].count) return i;
+    }
+    return -1;
+}
+
+int RegisterMap::image_index(uint16_t address) const {
+    int i = span_of(address);
+    return i < 0 ? -1 : span_offset[i] + (address - spans[i].start);
+}
+
+uint16_t RegisterMap::get_u16(uint16_t address) const {
+    int index = image_index(address);
+    return index < 0 ? 0 : image[index];
+}
+
+int32_t RegisterMap::get_i32(uint16_t address) const {
+    uint32_t high_word = get_u16(address);
+    uint32_t low_word = get_u16(address + 1);
+    return (int32_t)((high_word << 16) | low_word);
+}
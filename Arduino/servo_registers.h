@@ -0,0 +1,167 @@
+/**
+ * @file servo_registers.h
+ * @brief Register map of the LC10e servo drivers with coalesced read planning.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Every register the servo task wants from a slave is added to a RegisterMap.
+ * The map merges them into the fewest contiguous holding-register spans worth
+ * reading in one transaction: a gap between two wanted ranges is read along
+ * when transferring the unused registers is cheaper than the framing and
+ * turnaround of an extra transaction, and every one of them is known to be
+ * readable on that slave. A drive answers a read touching an unmapped
+ * register with an exception, so nothing is read along unless allowed.
+ * Responses are stored into a register image and decoded from there in one
+ * pass.
+ */
+#ifndef SERVO_REGISTERS_H
+#define SERVO_REGISTERS_H
+
+#include "version.h"
+#include "modbus_codec.h"
+#include <stdint.h>
+
+// LC10e holding registers used by the servo task
+#define SERVO_REG_STATUS            10  // Limit switch status word
+#define SERVO_REG_POSITION          20  // 32-bit position, high word first (20-21)
+
+// Modbus limit on registers per Read Holding Registers request
+#define MODBUS_MAX_READ_REGISTERS   125
+
+// Wire cost of one read transaction beyond its payload, in characters:
+// 8-byte request, 5 bytes of response header/CRC and two 3.5-character gaps
+#define MODBUS_READ_OVERHEAD_CHARS  20
+
+// Bits per character on the bus: start, 8 data, parity and stop bit
+#define MODBUS_BITS_PER_CHAR        11
+
+#define REGISTER_MAP_MAX_RANGES     8
+#define REGISTER_MAP_MAX_REGISTERS  64
+
+/**
+ * @struct RegisterSpan
+ * @brief A contiguous block of holding registers [start, start + count).
+ */
+struct RegisterSpan {
+    uint16_t start;
+    uint16_t count;
+};
+
+/**
+ * @brief Bus time of one read of `count` registers: both frames and their gaps.
+ *
+ * @param count The number of registers read.
+ * @param baud The bus baud rate.
+ * @return Microseconds, without the drive's own response delay.
+ */
+uint32_t modbus_read_wire_us(uint16_t count, uint32_t baud);
+
+/**
+ * @brief Parses an inclusive register range written as "first-last".
+ *
+ * @param text The range, e.g. "10-21".
+ * @param span Set to the registers of the range.
+ * @return False for an empty or invalid range.
+ */
+bool register_range_parse(const char* text, RegisterSpan* span);
+
+/**
+ * @class RegisterMap
+ * @brief The registers wanted from one slave and the spans they are read with.
+ */
+class RegisterMap {
+public:
+    /**
+     * @brief Adds registers to read. Call `plan()` afterwards.
+     *
+     * @param address The first register.
+     * @param count The number of registers.
+     * @return False if the map is full.
+     */
+    bool add(uint16_t address, uint16_t count);
+
+    /**
+     * @brief Marks registers the slave is known to answer, so `plan()` may
+     *        read them along to bridge a gap. Kept across `reset()`.
+     *
+     * @return False if the map is full.
+     */
+    bool allow(uint16_t address, uint16_t count);
+
+    /**
+     * @brief Removes all wanted registers and spans, to plan a different set.
+     */
+    void reset();
+
+    /**
+     * @brief Merges the wanted registers into read spans.
+     *
+     * Two ranges are merged when the registers in between are all readable
+     * (wanted or allowed) and cost fewer characters on the wire than another
+     * transaction. Ranges that do not fit the register image or a single
+     * request are left out and counted in `dropped_count()`.
+     *
+     * @param overhead_chars Cost of one extra transaction in characters.
+     * @return The number of spans, i.e. transactions per read cycle.
+     */
+    int plan(int overhead_chars = MODBUS_READ_OVERHEAD_CHARS);
+
+    int span_count() const { return num_spans; }
+    const RegisterSpan& span(int i) const { return spans[i]; }
+
+    /**
+     * @brief Returns the number of wanted ranges the last `plan()` left out.
+     */
+    int dropped_count() const { return num_dropped; }
+
+    int range_count() const { return num_ranges; }
+    const RegisterSpan& range(int i) const { return ranges[i]; }
+
+    /**
+     * @brief Returns the index of the read span holding `address`, -1 if none does.
+     */
+    int span_of(uint16_t address) const;
+
+    /**
+     * @brief Stores the response to read span `i` in the register image.
+     *
+     * @param i The span index.
+     * @param registers The `span(i).count` registers of the response.
+     */
+    void store(int i, const ModbusRegisters& registers);
+
+    /**
+     * @brief Clears the register image to zero.
+     */
+    void clear_values();
+
+    /**
+     * @brief Returns a register from the image, 0 if it is not mapped.
+     */
+    uint16_t get_u16(uint16_t address) const;
+
+    /**
+     * @brief Returns a 32-bit value stored high word first at `address`.
+     */
+    int32_t get_i32(uint16_t address) const;
+
+private:
+    int image_index(uint16_t address) const;
+    bool readable(uint32_t from, uint32_t to) const;
+
+    RegisterSpan ranges[REGISTER_MAP_MAX_RANGES];
+    int num_ranges = 0;
+
+    RegisterSpan allowed[REGISTER_MAP_MAX_RANGES];
+    int num_allowed = 0;
+
+    RegisterSpan spans[REGISTER_MAP_MAX_RANGES];
+    uint16_t span_offset[REGISTER_MAP_MAX_RANGES];
+    int num_spans = 0;
+    int num_dropped = 0;
+
+    uint16_t image[REGISTER_MAP_MAX_REGISTERS] = {};
+};
+
+#endif // SERVO_REGISTERS_H
@@ -6,8 +6,10 @@
  * Version: 1.0.0
  *
  * This module handles the Modbus communication with the LC10e servo drivers
- * over RS485. It polls for limit switch status and position data,
- * and communicates these to the `led_tasks` using a FreeRTOS queue.
+ * over RS485. The polling logic itself lives in the servo poller
+ * (servo_poller.h); this task carries its reads out on the asynchronous RS485
+ * master, publishes the newest state of each axis to the `led_tasks` through
+ * the lock-free axis mailboxes and records telemetry.
  */
 #include "servo_tasks.h"
 #include "version.h"
@@ -15,135 +17,289 @@
 #include "pins.h"
 #include "led_tasks.h"
 #include "snmp_tasks.h"
-#include <ModbusMaster.h>
-#include <HardwareSerial.h>
+#include "axis_mailbox.h"
+#include "servo_poller.h"
+#include "modbus_rtu.h"
+#include "bus_tuning.h"
+#include "telemetry.h"
+#include "modbus_stats.h"
+#include "sd_tasks.h"
+#include "logger.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
-
-// Global extern declarations
-extern ModbusMaster nodeY;
-extern ModbusMaster nodeYY;
-extern ModbusMaster nodeX;
-extern QueueHandle_t ledCommandQueue;
-extern int servoY_position;
-extern int servoYY_position;
-extern int servoX_position;
-extern TickType_t last_move_time_Y;
-extern TickType_t last_move_time_YY;
-extern TickType_t last_move_time_X;
-
-// HardwareSerial for RS485 communication
-HardwareSerial RS485Serial(2); // Using UART2
+
+// Longest a request may wait in the queue before it is dropped as stale
+#define SERVO_REQUEST_MAX_AGE_MS 100
+
+// Ticks in a row without a single answer before an autotuned bus returns to
+// the configured baud rate
+#define SERVO_BAUD_FALLBACK_TICKS 20
+
+// Polling state of all servos, owned by servo_task
+static ServoPoller servo_poller;
+
+// Task woken by the read completions
+static TaskHandle_t servo_waiter = NULL;
+
+// Guards the reads of the current tick against the completion callbacks, the
+// Modbus statistics, and the statistics copied out for other tasks. A read's context carries the
+// generation of the tick it belongs to; completions of an earlier tick that
+// arrive after servo_task gave up waiting are dropped instead of being stored
+// into the reads of the next one.
+static portMUX_TYPE servo_poller_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t servo_generation = 0;
+static int servo_completed = 0;
+static PollStats servo_poll_stats_copy[AXIS_COUNT];
+static SkewStats servo_skew_stats_copy = {};
 
 // Function prototypes for internal use
-uint16_t read_limit_switches(ModbusMaster& node);
-int32_t read_current_position(ModbusMaster& node);
-void check_and_update_position(int servo_position, int& last_position, TickType_t& last_move_time);
+void servo_read_done(const ModbusRequest& request, const ModbusResponse& response);
 
 /**
- * @brief Reads the limit switch status from a servo driver over RS485.
- * 
- * This implementation assumes register 10 holds the limit switch status.
- *
- * @param node The ModbusMaster instance for the servo.
- * @return A 16-bit word containing the status.
+ * @brief Packs the tick generation, axis and read index into a request context.
  */
-uint16_t read_limit_switches(ModbusMaster& node) {
-    uint8_t result = node.readHoldingRegisters(10, 1);
-    if (result == node.ku8MBIISuccess) {
-        return node.getResponseBuffer(0);
-    }
-    return 0; // Return 0 on failure
+static void* servo_read_context(uint16_t generation, int axis, int i) {
+    return (void*)(uintptr_t)(((uint32_t)generation << 16) | ((uint32_t)axis << 8) | (uint32_t)i);
 }
 
 /**
- * @brief Reads the current position from a servo driver over RS485.
+ * @brief Completion callback of a register span read, run from the bus task.
  *
- * @param node The ModbusMaster instance for the servo.
- * @return The 32-bit position value.
+ * Accounts the outcome, retries lost or corrupted frames, stores the
+ * registers in the servo's register image and wakes servo_task.
  */
-int32_t read_current_position(ModbusMaster& node) {
-    uint8_t result = node.readHoldingRegisters(20, 2); // Assuming 32-bit position starts at register 20
-    if (result == node.ku8MBIISuccess) {
-        uint32_t high_word = node.getResponseBuffer(0);
-        uint32_t low_word = node.getResponseBuffer(1);
-        return (high_word << 16) | low_word;
+void servo_read_done(const ModbusRequest& request, const ModbusResponse& response) {
+    uint32_t tag = (uint32_t)(uintptr_t)request.context;
+    uint16_t generation = tag >> 16;
+    int axis = (tag >> 8) & 0xFF;
+    int i = tag & 0xFF;
+    uint32_t done_ms = millis();
+
+    portENTER_CRITICAL(&servo_poller_mux);
+    bool current = generation == servo_generation;
+    bool again = false;
+    if (current) {
+        servo_poller.account(i, response);
+        again = servo_poller.retry(i, response.status);
+        if (!again) {
+            servo_poller.complete(i, response, done_ms);
+            servo_completed++;
+        }
+    }
+    portEXIT_CRITICAL(&servo_poller_mux);
+
+    // The tick this read belongs to is over; only count the outcome
+    if (!current) {
+        portENTER_CRITICAL(&servo_poller_mux);
+        modbus_stats_record(axis, response.status, response.exception, response.elapsed_us);
+        portEXIT_CRITICAL(&servo_poller_mux);
+        return;
     }
-    return 0;
+
+    // A retry goes out next, ahead of the other queued reads, so the Y/YY
+    // pair stays back to back; it keeps the original deadline, so it expires
+    // rather than run late
+    if (again) {
+        bool queued = modbus_rtu_submit_front(request);
+        portENTER_CRITICAL(&servo_poller_mux);
+        if (queued) {
+            modbus_stats_retry(axis);
+        } else if (generation == servo_generation) {
+            servo_poller.complete(i, response, done_ms);
+            servo_completed++;
+        }
+        portEXIT_CRITICAL(&servo_poller_mux);
+        if (queued) return;
+    }
+    xTaskNotifyGive(servo_waiter);
 }
 
 /**
- * @brief Checks if the position has changed and updates the last move time.
- *
- * @param current_position The current position of the servo.
- * @param last_position Reference to the variable storing the last known position.
- * @param last_move_time Reference to the variable storing the time of the last move.
+ * @brief Returns the achieved polling rates and bus share of an axis.
  */
-void check_and_update_position(int current_position, int& last_position, TickType_t& last_move_time) {
-    if (current_position != last_position) {
-        last_position = current_position;
-        last_move_time = xTaskGetTickCount();
-    }
+PollStats servo_poll_stats(int axis) {
+    portENTER_CRITICAL(&servo_poller_mux);
+    PollStats stats = servo_poll_stats_copy[axis];
+    portEXIT_CRITICAL(&servo_poller_mux);
+    return stats;
+}
+
+/**
+ * @brief Returns a copy of a slave's Modbus counters.
+ */
+ModbusSlaveStats servo_modbus_stats(int axis) {
+    portENTER_CRITICAL(&servo_poller_mux);
+    ModbusSlaveStats stats = modbus_stats(axis);
+    portEXIT_CRITICAL(&servo_poller_mux);
+    return stats;
+}
+
+/**
+ * @brief Returns the Y/YY gantry skew statistics.
+ */
+SkewStats gantry_skew_stats() {
+    portENTER_CRITICAL(&servo_poller_mux);
+    SkewStats stats = servo_skew_stats_copy;
+    portEXIT_CRITICAL(&servo_poller_mux);
+    return stats;
+}
+
+/**
+ * @brief Returns true while the gantry skew alarm is active.
+ */
+bool gantry_skew_alarm() {
+    portENTER_CRITICAL(&servo_poller_mux);
+    bool alarm = servo_skew_stats_copy.alarm;
+    portEXIT_CRITICAL(&servo_poller_mux);
+    return alarm;
 }
 
 /**
  * @brief FreeRTOS task to manage RS485 communication.
  */
 void servo_task(void* pvParameters) {
-    RS485Serial.begin(19200, SERIAL_8N1, RS485_RX_PIN, RS485_TX_PIN);
-    
-    // Set up Modbus nodes
-    nodeY.begin(config.SERVOY_SLAVE_ID, RS485Serial);
-    nodeYY.begin(config.SERVOYY_SLAVE_ID, RS485Serial);
-    nodeX.begin(config.SERVOX_SLAVE_ID, RS485Serial);
-    
-    // Set RTS pin for direction control
-    nodeY.setSlaveControlPin(RS485_RTS_PIN);
-    nodeYY.setSlaveControlPin(RS485_RTS_PIN);
-    nodeX.setSlaveControlPin(RS485_RTS_PIN);
-    
-    uint16_t last_status_y = 0;
-    uint16_t last_status_yy = 0;
-    uint16_t last_status_x = 0;
+    if (!modbus_rtu_begin(config.SERVOS.BAUD, config.SERVOS.PARITY[0], config.SERVOS.INTER_FRAME_US)) {
+        vTaskDelete(NULL);
+    }
+    servo_waiter = xTaskGetCurrentTaskHandle();
+
+    uint8_t slave_ids[AXIS_COUNT] = {
+        (uint8_t)config.SERVOS.SERVOY_SLAVE_ID,
+        (uint8_t)config.SERVOS.SERVOYY_SLAVE_ID,
+        (uint8_t)config.SERVOS.SERVOX_SLAVE_ID
+    };
+
+    int baud = config.SERVOS.BAUD;
+    if (config.SERVOS.AUTOTUNE) {
+        baud = bus_autotune(slave_ids);
+    }
+    int64_t counts_per_rail[AXIS_COUNT] = {
+        llround((double)config.TABLE.RAIL_Y_LENGTH * config.TABLE.COUNTS_PER_MM_Y),
+        llround((double)config.TABLE.RAIL_Y_LENGTH * config.TABLE.COUNTS_PER_MM_Y),
+        llround((double)config.TABLE.RAIL_X_LENGTH * config.TABLE.COUNTS_PER_MM_X)
+    };
+    servo_poller.begin(slave_ids, counts_per_rail);
+    servo_poller.set_baud(baud);
+    const char* read_along[AXIS_COUNT] = {
+        config.SERVOS.SERVOY_READ_ALONG,
+        config.SERVOS.SERVOYY_READ_ALONG,
+        config.SERVOS.SERVOX_READ_ALONG
+    };
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        RegisterSpan span;
+        if (register_range_parse(read_along[axis], &span)) {
+            servo_poller.allow(axis, span.start, span.count);
+        } else if (read_along[axis][0] != '\0') {
+            LOG_WARN(LOG_SERVO, "Ignoring invalid register range '%s' of slave %u.", read_along[axis],
+                     (unsigned)slave_ids[axis]);
+        }
+    }
+    servo_poller.skew_monitor().configure(config.TABLE.COUNTS_PER_MM_Y, config.TABLE.SKEW_THRESHOLD_MM,
+                                          config.TABLE.SKEW_FILTER);
+
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t reported_dropped = 0;
+    int silent_ticks = 0;
 
     while(1) {
-        // Poll SERVOY for limit switch status
-        uint16_t status_y = read_limit_switches(nodeY);
-        if (status_y != last_status_y) {
-            LimitStatusMessage msg = {0, (bool)(status_y & 0x01), (bool)(status_y & 0x02)};
-            xQueueSend(ledCommandQueue, &msg, 0);
-            last_status_y = status_y;
+        uint32_t now = millis();
+        int num_reads = servo_poller.plan(now);
+        uint32_t tick_ms = servo_poller.tick_ms();
+        if (servo_poller.dropped_ranges() != reported_dropped) {
+            reported_dropped = servo_poller.dropped_ranges();
+            LOG_WARN(LOG_SERVO, "Servo register ranges left out of the read plan: %u", (unsigned)reported_dropped);
         }
 
-        // Poll SERVOYY for limit switch status
-        uint16_t status_yy = read_limit_switches(nodeYY);
-        if (status_yy != last_status_yy) {
-            LimitStatusMessage msg = {1, (bool)(status_yy & 0x01), (bool)(status_yy & 0x02)};
-            xQueueSend(ledCommandQueue, &msg, 0);
-            last_status_yy = status_yy;
+        int submitted = 0;
+        for (int i = 0; i < num_reads; i++) {
+            const ServoRead& read = servo_poller.read(i);
+            ModbusRequest request;
+            request.slave_id = read.slave_id;
+            request.address = read.address;
+            request.count = read.count;
+            request.timeout_ms = config.SERVOS.RESPONSE_TIMEOUT_MS;
+            request.deadline_ms = now + SERVO_REQUEST_MAX_AGE_MS;
+            request.callback = servo_read_done;
+            request.context = servo_read_context(servo_generation, read.axis, i);
+            if (modbus_rtu_submit(request)) {
+                submitted++;
+            }
         }
 
-        // Poll SERVOX for limit switch status
-        uint16_t status_x = read_limit_switches(nodeX);
-        if (status_x != last_status_x) {
-            LimitStatusMessage msg = {2, (bool)(status_x & 0x01), (bool)(status_x & 0x02)};
-            xQueueSend(ledCommandQueue, &msg, 0);
-            last_status_x = status_x;
+        // Sleep until every request has completed; each one completes by its
+        // deadline plus its response timeout
+        TickType_t wait = pdMS_TO_TICKS(SERVO_REQUEST_MAX_AGE_MS + config.SERVOS.RESPONSE_TIMEOUT_MS);
+        TickType_t wait_start = xTaskGetTickCount();
+        while (true) {
+            portENTER_CRITICAL(&servo_poller_mux);
+            bool all_done = servo_completed >= submitted;
+            portEXIT_CRITICAL(&servo_poller_mux);
+            TickType_t waited = xTaskGetTickCount() - wait_start;
+            if (all_done || waited >= wait) break;
+            ulTaskNotifyTake(pdTRUE, wait - waited);
         }
 
-        // Poll SERVOY for current position
-        int32_t current_pos_y = read_current_position(nodeY);
-        check_and_update_position(current_pos_y, servoY_position, last_move_time_Y);
+        // Close the tick: completions still in flight belong to an old generation now
+        portENTER_CRITICAL(&servo_poller_mux);
+        servo_generation++;
+        servo_completed = 0;
+        portEXIT_CRITICAL(&servo_poller_mux);
+
+        bool skew_raised = servo_poller.finish();
+        SkewStats skew = servo_poller.skew_monitor().stats();
+        portENTER_CRITICAL(&servo_poller_mux);
+        servo_skew_stats_copy = skew;
+        portEXIT_CRITICAL(&servo_poller_mux);
 
-        // Poll SERVOYY for current position
-        int32_t current_pos_yy = read_current_position(nodeYY);
-        check_and_update_position(current_pos_yy, servoYY_position, last_move_time_YY);
+        TickType_t now_ticks = xTaskGetTickCount();
+        uint32_t finished_ms = millis();
+        bool polled = false;
+        bool answered = false;
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            const ServoAxisResult& result = servo_poller.result(axis);
+            if (!result.polled) continue;
+            polled = true;
+            answered = answered || result.ok;
+
+            AxisState state = servo_poller.state(axis);
+            if (result.position_read) {
+                TelemetryRecord record = {result.sample_ms, state.position, state.status, (uint8_t)axis,
+                                          (uint8_t)(result.position_ok ? TELEMETRY_FLAG_OK : 0), result.latency_us};
+                telemetry_append(record);
+            }
+
+            // Publish the newest state; the LED task picks it up on its next frame
+            state.last_move_tick = now_ticks - pdMS_TO_TICKS(finished_ms - servo_poller.last_move_ms(axis));
+            axis_mailboxes[axis].publish(state);
+        }
 
-        // Poll SERVOX for current position
-        int32_t current_pos_x = read_current_position(nodeX);
-        check_and_update_position(current_pos_x, servoX_position, last_move_time_X);
+        // The drives stopped answering at the autotuned rate: go back to the configured one
+        if (polled) silent_ticks = answered ? 0 : silent_ticks + 1;
+        if (silent_ticks >= SERVO_BAUD_FALLBACK_TICKS && baud != config.SERVOS.BAUD) {
+            LOG_WARN(LOG_SERVO, "No servo answered at %d baud, returning to %d baud.", baud, config.SERVOS.BAUD);
+            if (modbus_rtu_set_line(config.SERVOS.BAUD, config.SERVOS.PARITY[0], config.SERVOS.INTER_FRAME_US)) {
+                baud = config.SERVOS.BAUD;
+                servo_poller.set_baud(baud);
+            }
+            silent_ticks = 0;
+        }
+
+        if (skew_raised) {
+            LOG_WARN(LOG_SERVO, "Gantry skew alarm: %.2f mm", skew.error_mm);
+            char trap[48];
+            snprintf(trap, sizeof(trap), "Gantry Skew Alarm: %.2f mm", skew.error_mm);
+            snmp_trap_send(trap);
+        }
+
+        servo_poller.update_stats(millis());
+        portENTER_CRITICAL(&servo_poller_mux);
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            servo_poll_stats_copy[axis] = servo_poller.poll_stats(axis);
+        }
+        portEXIT_CRITICAL(&servo_poller_mux);
 
-        vTaskDelay(pdMS_TO_TICKS(100)); // Poll more frequently for position tracking
+        // The tick lasts as long as the bus needs for its reads; one that took
+        // longer still starts the next one at once
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(tick_ms));
     }
 }
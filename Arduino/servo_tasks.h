@@ -5,15 +5,17 @@
  * Project: fireCNC
  * Version: 1.0.0
  *
- * This file declares functions for interacting with the LC10e servos via Modbus
- * over RS485, including reading position and limit switch status. It also
- * defines the message structure and queue for inter-task communication.
+ * This file declares the task polling the LC10e servos via Modbus over RS485
+ * (modbus_rtu.h) for position and limit switch status. The results are
+ * published through the axis mailboxes (axis_mailbox.h).
  */
 #ifndef SERVO_TASKS_H
 #define SERVO_TASKS_H
 
 #include "version.h"
-#include <ModbusMaster.h>
+#include "poll_scheduler.h"
+#include "gantry_skew.h"
+#include "modbus_stats.h"
 
 /**
  * @brief FreeRTOS task to manage RS485 communication with servo drivers.
@@ -26,21 +28,38 @@
 void servo_task(void* pvParameters);
 
 /**
- * @brief Reads the limit switch status from a servo driver over RS485.
- * 
- * This function is internal to the servo_task.
+ * @brief Returns the achieved polling rates and bus share of an axis.
+ *
+ * Safe to call from any task; returns a copy taken at the end of a poll tick.
+ *
+ * @param axis The axis index (0=Y, 1=YY, 2=X).
+ * @return Sample rates and bus utilization over the last second.
+ */
+PollStats servo_poll_stats(int axis);
+
+/**
+ * @brief Returns a copy of a slave's Modbus counters.
+ *
+ * Safe to call from any task; the counters are recorded under the same lock.
+ *
+ * @param axis The axis index (0=Y, 1=YY, 2=X).
+ */
+ModbusSlaveStats servo_modbus_stats(int axis);
+
+/**
+ * @brief Returns the Y/YY gantry skew statistics.
+ *
+ * Safe to call from any task; returns a copy taken after the last poll tick.
  *
- * @param node The ModbusMaster instance for the servo.
- * @return A 16-bit word containing the status.
+ * @return Instantaneous and filtered racking error, min/max and histogram.
  */
-uint16_t read_limit_switches(ModbusMaster& node);
+SkewStats gantry_skew_stats();
 
 /**
- * @brief Reads the current position from a servo driver over RS485.
+ * @brief Returns true while the gantry skew alarm is active.
  *
- * @param node The ModbusMaster instance for the servo.
- * @return The 32-bit position value.
+ * Safe to call from any task.
  */
-int32_t read_current_position(ModbusMaster& node);
+bool gantry_skew_alarm();
 
 #endif // SERVO_TASKS_H
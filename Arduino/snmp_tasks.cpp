@@ -16,8 +16,12 @@
 #include "version.h"
 #include "config.h"
 #include "sd_tasks.h"
+#include "logger.h"
 #include "pins.h"
 #include "networking.h"
+#include "framebuffer.h"
+#include "modbus_stats.h"
+#include "servo_tasks.h"
 #include <SNMP_Agent.h>
 #include <WiFi.h>
 #include <ETH.h>
@@ -41,6 +45,11 @@ const char* OID_ADC_VOLTAGE = "1.3.6.1.4.1.54021.10.2.3";
 const char* OID_SD_TOTAL = "1.3.6.1.4.1.54021.10.3.1";
 const char* OID_SD_USED = "1.3.6.1.4.1.54021.10.3.2";
 const char* OID_SD_FREE_PERCENT = "1.3.6.1.4.1.54021.10.3.3";
+const char* OID_LED_FB_INTERNAL = "1.3.6.1.4.1.54021.10.4.1";
+const char* OID_LED_FB_PSRAM = "1.3.6.1.4.1.54021.10.4.2";
+
+// Modbus counters: OID_MODBUS_STATS.<axis + 1>.<ModbusStatField + 1>
+const char* OID_MODBUS_STATS = "1.3.6.1.4.1.54021.10.5";
 
 // Global variables for SNMP data
 char system_status[128] = "System is operational.";
@@ -135,6 +144,41 @@ int sdFreePercentCallback(SNMP_Value& value, const OID& oid) {
     return SNMP_Value::SUCCESS;
 }
 
+// Callback for LED framebuffer internal RAM usage
+int ledFbInternalCallback(SNMP_Value& value, const OID& oid) {
+    value.setUnsigned64(framebuffer_footprint().internal_bytes);
+    return SNMP_Value::SUCCESS;
+}
+
+// Callback for LED framebuffer PSRAM usage
+int ledFbPsramCallback(SNMP_Value& value, const OID& oid) {
+    value.setUnsigned64(framebuffer_footprint().psram_bytes);
+    return SNMP_Value::SUCCESS;
+}
+
+// Callback for one Modbus counter of one servo
+template <int AXIS, int FIELD>
+int modbusStatCallback(SNMP_Value& value, const OID& oid) {
+    value.setUnsigned64(modbus_stats_field(servo_modbus_stats(AXIS), FIELD));
+    return SNMP_Value::SUCCESS;
+}
+
+// Registers the Modbus counter OIDs of one servo, fields FIELD down to 0
+template <int AXIS, int FIELD>
+struct ModbusStatOids {
+    static void add() {
+        static char oid[48];
+        snprintf(oid, sizeof(oid), "%s.%d.%d", OID_MODBUS_STATS, AXIS + 1, FIELD + 1);
+        snmp.addReadOnlyCounter64Handler(oid, modbusStatCallback<AXIS, FIELD>);
+        ModbusStatOids<AXIS, FIELD - 1>::add();
+    }
+};
+
+template <int AXIS>
+struct ModbusStatOids<AXIS, -1> {
+    static void add() {}
+};
+
 /**
  * @brief Initializes and starts the SNMP agent.
  */
@@ -151,12 +195,17 @@ void snmp_init() {
     snmp.addReadOnlyCounter64Handler(OID_SD_TOTAL, sdTotalCallback);
     snmp.addReadOnlyCounter64Handler(OID_SD_USED, sdUsedCallback);
     snmp.addReadOnlyFloatHandler(OID_SD_FREE_PERCENT, sdFreePercentCallback);
+    snmp.addReadOnlyCounter64Handler(OID_LED_FB_INTERNAL, ledFbInternalCallback);
+    snmp.addReadOnlyCounter64Handler(OID_LED_FB_PSRAM, ledFbPsramCallback);
+    ModbusStatOids<AXIS_Y, MODBUS_STAT_FIELD_COUNT - 1>::add();
+    ModbusStatOids<AXIS_YY, MODBUS_STAT_FIELD_COUNT - 1>::add();
+    ModbusStatOids<AXIS_X, MODBUS_STAT_FIELD_COUNT - 1>::add();
 
     // Initialize ADC for ADC voltage readings
     adc1_config_width(ADC_WIDTH_BIT_12);
     adc1_config_channel_atten(ADC1_CHANNEL_6, ADC_ATTEN_DB_11); // Assuming GPIO34
 
-    log_to_sd("SNMP agent initialized.");
+    LOG_INFO(LOG_SNMP, "SNMP agent initialized.");
 }
 
 /**
@@ -164,7 +213,7 @@ void snmp_init() {
  *
  * @param message The message to include in the trap payload.
  */
-void snmp_trap_send(const String& message) {
+void snmp_trap_send(const char* message) {
     if (config.SNMP_TRAP_TARGET.length() > 0) {
         IPAddress trap_target_ip;
         if (trap_target_ip.fromString(config.SNMP_TRAP_TARGET)) {
@@ -177,7 +226,7 @@ void snmp_trap_send(const String& message) {
                 config.SNMP_TRAP_COMMUNITY.c_str(),
                 "1.3.6.1.4.1.54021.1", // Standard trap OID
                 "1.3.6.1.4.1.54021.1.0.1", // Generic trap type (e.g., coldStart)
-                message.c_str()
+                message
             );
         }
     }
@@ -32,7 +32,7 @@ void snmp_init();
  *
  * @param message The message to include in the trap payload.
  */
-void snmp_trap_send(const String& message);
+void snmp_trap_send(const char* message);
 
 /**
  * @brief FreeRTOS task for the SNMP agent.
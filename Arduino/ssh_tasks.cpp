@@ -1,25 +1,60 @@
 #include "ssh_tasks.h"
 #include "config.h"
 #include "sd_tasks.h"
+#include "logger.h"
 #include "snmp_tasks.h"
 #include <libssh_esp32.h>
 #include <SD.h>
+#include <time.h>
 
 #define SSH_HOST_KEY_PATH "/ssh_host_rsa_key"
 #define SSH_TASK_STACK_SIZE 8192
 #define SSH_TASK_PRIORITY 2
+#define SSH_LOG_LINES 20
 
 static void ssh_server_task(void *arg);
 
+// Renders the messages between the times in `args` into the response, as many as fit.
+static void ssh_log_since(const char *args, char *response_buffer, size_t buffer_size) {
+    char from[32] = "";
+    char to[32] = "";
+    int fields = sscanf(args, "%31s %31s", from, to);
+    uint32_t now = (uint32_t)time(NULL);
+    uint32_t since;
+    uint32_t until = UINT32_MAX;
+    if (fields < 1 || !log_parse_time(from, now, &since) || (fields == 2 && !log_parse_time(to, now, &until))) {
+        snprintf(response_buffer, buffer_size, "Usage: log since <time> [<time>], time as YYYY-MM-DDTHH:MM[:SS] or HH:MM[:SS]\n");
+        return;
+    }
+
+    LogCursor cursor;
+    sd_log_seek(&cursor, since, until);
+    size_t length = 0;
+    response_buffer[0] = '\0';
+    while (cursor.seq != 0 && buffer_size - length > LOG_LINE_MAX) {
+        length += sd_log_read(&cursor, response_buffer + length, buffer_size - length);
+    }
+}
+
 // The SSH command handler function. It's a simple example.
 int ssh_command_handler(const char *cmd, char *response_buffer, size_t buffer_size) {
     if (strcmp(cmd, "health") == 0) {
         snprintf(response_buffer, buffer_size, "System health is OK.\n");
     } else if (strcmp(cmd, "reboot") == 0) {
         snprintf(response_buffer, buffer_size, "Rebooting...\n");
-        log_to_sd("SSH command: Reboot initiated.");
+        LOG_INFO(LOG_SSH, "SSH command: Reboot initiated.");
+        sd_log_flush(pdMS_TO_TICKS(1000));
         delay(100);
         ESP.restart();
+    } else if (strncmp(cmd, "log since ", 10) == 0) {
+        // Messages of a time range: "log since <time> [<time>]"
+        ssh_log_since(cmd + 10, response_buffer, buffer_size);
+    } else if (strcmp(cmd, "log") == 0 || strncmp(cmd, "log ", 4) == 0) {
+        // Last lines of the SD log, rendered as text: "log [tail] [lines]"
+        const char *arg = cmd + 3;
+        if (strncmp(arg, " tail", 5) == 0) arg += 5;
+        int lines = *arg == ' ' ? atoi(arg + 1) : SSH_LOG_LINES;
+        sd_log_tail(response_buffer, buffer_size, lines > 0 ? lines : SSH_LOG_LINES);
     } else if (strncmp(cmd, "echo ", 5) == 0) {
         snprintf(response_buffer, buffer_size, "%s\n", cmd + 5);
     } else {
@@ -44,14 +79,14 @@ static void ssh_server_task(void *arg) {
 
     // Check for existing host key and generate if not present
     if (!SD.exists(SSH_HOST_KEY_PATH)) {
-        log_to_sd("SSH host key not found, generating a new one.");
+        LOG_WARN(LOG_SSH, "SSH host key not found, generating a new one.");
         // Note: Key generation can be resource-intensive.
         // It's often better to generate the key offline and store it.
         // For demonstration, we'll assume a key exists after first run.
         // Key generation logic (uncomment to use once):
         // libssh_generate_rsa_key(SSH_HOST_KEY_PATH, 2048);
         // if (!SD.exists(SSH_HOST_KEY_PATH)) {
-        //     log_to_sd("Failed to generate SSH host key.");
+        //     LOG_ERROR(LOG_SSH, "Failed to generate SSH host key.");
         //     snmp_trap_send("SSH Host Key Generation Failed.");
         //     vTaskDelete(NULL);
         // }
@@ -0,0 +1,102 @@
+/**
+ * @file telemetry.cpp
+ * @brief Implementation of the servo telemetry ring.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The writer fills a slot and then publishes it by advancing `head` with
+ * release order. A reader copies its records and re-reads `head` afterwards;
+ * anything the writer may have overwritten while it was copying is discarded
+ * and counted as dropped, so no lock is needed on either side.
+ */
+#include "telemetry.h"
+#include "version.h"
+#include "sd_tasks.h"
+#include "logger.h"
+#include <esp_heap_caps.h>
+#include <atomic>
+#include <string.h>
+
+static TelemetryRecord* ring = NULL;
+static uint32_t ring_mask = 0;
+static std::atomic<uint32_t> head{0};
+
+/**
+ * @brief Allocates the ring, in PSRAM when available.
+ */
+bool telemetry_init() {
+    size_t capacity = TELEMETRY_CAPACITY;
+
+#ifdef BOARD_HAS_PSRAM
+    ring = (TelemetryRecord*)heap_caps_malloc(capacity * sizeof(TelemetryRecord), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+
+    if (ring == NULL) {
+        capacity = TELEMETRY_CAPACITY_INTERNAL;
+        ring = (TelemetryRecord*)heap_caps_malloc(capacity * sizeof(TelemetryRecord), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (ring == NULL) {
+        LOG_ERROR(LOG_SYSTEM, "Telemetry ring allocation failed");
+        return false;
+    }
+
+    ring_mask = capacity - 1;
+    LOG_INFO(LOG_SYSTEM, "Telemetry ring allocated: %u records", (unsigned)capacity);
+    return true;
+}
+
+/**
+ * @brief Appends a record. Only servo_task may call this; never blocks.
+ */
+void telemetry_append(const TelemetryRecord& record) {
+    if (ring == NULL) return;
+    uint32_t seq = head.load(std::memory_order_relaxed);
+    ring[seq & ring_mask] = record;
+    head.store(seq + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Returns the sequence number the next record will get.
+ */
+uint32_t telemetry_head() {
+    return head.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Copies the records after a reader's cursor.
+ */
+size_t telemetry_read(uint32_t* cursor, TelemetryRecord* records, size_t max_records, uint32_t* dropped) {
+    if (ring == NULL) return 0;
+    uint32_t capacity = ring_mask + 1;
+
+    // Slow reader: drop the oldest records it has not read yet
+    uint32_t end = head.load(std::memory_order_acquire);
+    if (end - *cursor > capacity) {
+        *dropped += end - *cursor - capacity;
+        *cursor = end - capacity;
+    }
+
+    size_t count = end - *cursor;
+    if (count > max_records) count = max_records;
+    for (size_t i = 0; i < count; i++) {
+        records[i] = ring[(*cursor + i) & ring_mask];
+    }
+
+    // Records the writer reached (or may be writing) while they were being
+    // copied are not valid
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t now_end = head.load(std::memory_order_relaxed) + 1;
+    uint32_t overwritten = 0;
+    if (now_end - *cursor > capacity) {
+        overwritten = now_end - *cursor - capacity;
+        if (overwritten > count) overwritten = count;
+    }
+    if (overwritten > 0) {
+        memmove(records, records + overwritten, (count - overwritten) * sizeof(TelemetryRecord));
+        *dropped += overwritten;
+    }
+
+    *cursor += count;
+    return count - overwritten;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file telemetry.h
+ * @brief Fixed-capacity servo telemetry ring in PSRAM.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * servo_task appends one record per position sample. Readers (the telemetry
+ * WebSocket streams) each keep their own cursor, so any number of them can
+ * follow the ring at their own pace. The writer never waits for a reader: it
+ * overwrites the oldest records, and a reader that fell behind skips ahead
+ * and is told how many records it lost.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "version.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Ring size in records (power of two); 64k records are 1 MB of PSRAM
+#define TELEMETRY_CAPACITY          65536
+
+// Ring size used when no PSRAM is available
+#define TELEMETRY_CAPACITY_INTERNAL 1024
+
+#define TELEMETRY_FLAG_OK           0x01    // The Modbus read of the position succeeded
+
+/**
+ * @struct TelemetryRecord
+ * @brief One servo sample, 16 bytes, sent on the wire as is (little-endian).
+ */
+struct TelemetryRecord {
+    uint32_t timestamp_ms;      // millis() when the position was received
+    int32_t position;           // Encoder counts
+    uint16_t status;            // Raw limit/status word
+    uint8_t axis;               // 0=Y, 1=YY, 2=X
+    uint8_t flags;              // TELEMETRY_FLAG_*
+    uint32_t latency_us;        // Modbus bus time of the sample
+};
+
+/**
+ * @brief Allocates the ring, in PSRAM when available.
+ *
+ * @return True if the ring was allocated.
+ */
+bool telemetry_init();
+
+/**
+ * @brief Appends a record. Only servo_task may call this; never blocks.
+ */
+void telemetry_append(const TelemetryRecord& record);
+
+/**
+ * @brief Returns the sequence number the next record will get.
+ *
+ * Used as the starting cursor of a new reader.
+ */
+uint32_t telemetry_head();
+
+/**
+ * @brief Copies the records after a reader's cursor.
+ *
+ * If the writer has overwritten records the reader had not read yet, the
+ * cursor skips to the oldest record still available.
+ *
+ * @param cursor The reader's cursor, advanced past the records returned.
+ * @param records Output buffer.
+ * @param max_records Size of the output buffer.
+ * @param dropped Incremented by the number of records the reader lost.
+ * @return The number of records copied.
+ */
+size_t telemetry_read(uint32_t* cursor, TelemetryRecord* records, size_t max_records, uint32_t* dropped);
+
+#endif // TELEMETRY_H
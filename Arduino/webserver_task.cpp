@@ -17,16 +17,73 @@
 #include "config.h"
 #include "networking.h"
 #include "sd_tasks.h"
+#include "logger.h"
+#include "led_tasks.h"
+#include "framebuffer.h"
+#include "servo_tasks.h"
+#include "axis_mailbox.h"
+#include "bus_tuning.h"
+#include "telemetry.h"
+#include "modbus_stats.h"
+#include "modbus_rtu.h"
 #include "pins.h"
 #include <SPIFFS.h>
+#include <esp_heap_caps.h>
 #include <ArduinoJson.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
+#include <memory>
+#include <time.h>
 
 // Async Web Server on port 80
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 
+// Binary servo telemetry stream
+AsyncWebSocket telemetry_ws("/telemetry");
+
+// Log view: default number of lines and the largest response
+#define LOG_VIEW_LINES 200
+#define LOG_VIEW_BYTES 32768
+
+// Log view response when no PSRAM is free, taken from the internal heap
+#define LOG_VIEW_BYTES_INTERNAL 4096
+
+// Time range log view: text rendered at a time for the chunked response
+#define LOG_RANGE_CHUNK_BYTES 4096
+
+// How often the telemetry streams are fed, and the most records per frame
+#define TELEMETRY_STREAM_PERIOD_MS  50
+#define TELEMETRY_BATCH_RECORDS     256
+#define TELEMETRY_MAX_STREAMS       4
+
+// Close code for a telemetry client beyond TELEMETRY_MAX_STREAMS ("try again later")
+#define TELEMETRY_CLOSE_TOO_MANY    1013
+
+/**
+ * @struct TelemetryFrameHeader
+ * @brief Header of every binary telemetry frame, followed by the records.
+ */
+struct TelemetryFrameHeader {
+    uint16_t version;           // Frame format, currently 1
+    uint16_t record_count;      // TelemetryRecord entries following the header
+    uint32_t first_seq;         // Sequence number of the first record
+    uint32_t dropped;           // Records this client lost so far
+};
+
+/**
+ * @struct TelemetryStream
+ * @brief Read position of one connected telemetry client.
+ */
+struct TelemetryStream {
+    uint32_t client_id;         // 0 if the slot is free
+    uint32_t cursor;
+    uint32_t dropped;
+};
+
+static TelemetryStream telemetry_streams[TELEMETRY_MAX_STREAMS];
+static portMUX_TYPE telemetry_streams_mux = portMUX_INITIALIZER_UNLOCKED;
+
 // Store power and voltage data for graphs (for demonstration)
 // In a real application, this data would likely be stored in an array or file.
 std::vector<float> power_data;
@@ -46,9 +103,77 @@ SemaphoreHandle_t dataMutex;
  */
 void onWsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
     if (type == WS_EVT_CONNECT) {
-        log_to_sd("WebSocket client connected.");
+        LOG_INFO(LOG_WEB, "WebSocket client connected.");
     } else if (type == WS_EVT_DISCONNECT) {
-        log_to_sd("WebSocket client disconnected.");
+        LOG_INFO(LOG_WEB, "WebSocket client disconnected.");
+    }
+}
+
+/**
+ * @brief Handles telemetry WebSocket events; new clients start at the live edge.
+ *
+ * A client that finds every stream taken is closed with a reason instead of
+ * being left connected without data.
+ */
+void onTelemetryWsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    if (type != WS_EVT_CONNECT && type != WS_EVT_DISCONNECT) return;
+
+    bool accepted = false;
+    portENTER_CRITICAL(&telemetry_streams_mux);
+    for (int i = 0; i < TELEMETRY_MAX_STREAMS; i++) {
+        TelemetryStream& stream = telemetry_streams[i];
+        if (type == WS_EVT_CONNECT && stream.client_id == 0) {
+            stream = {client->id(), telemetry_head(), 0};
+            accepted = true;
+            break;
+        }
+        if (type == WS_EVT_DISCONNECT && stream.client_id == client->id()) {
+            stream.client_id = 0;
+        }
+    }
+    portEXIT_CRITICAL(&telemetry_streams_mux);
+
+    if (type == WS_EVT_CONNECT && !accepted) {
+        LOG_WARN(LOG_WEB, "Telemetry client rejected, %d streams already open.", TELEMETRY_MAX_STREAMS);
+        client->close(TELEMETRY_CLOSE_TOO_MANY, "Too many telemetry clients");
+    }
+}
+
+/**
+ * @brief Sends each telemetry client the records it has not seen yet.
+ *
+ * A client whose send queue is full is skipped; the ring keeps moving, so it
+ * loses the oldest records instead of slowing anything down.
+ */
+void telemetry_stream_update() {
+    alignas(4) static uint8_t frame[sizeof(TelemetryFrameHeader) + TELEMETRY_BATCH_RECORDS * sizeof(TelemetryRecord)];
+
+    // Free the clients that went away without a clean close
+    telemetry_ws.cleanupClients();
+
+    for (int i = 0; i < TELEMETRY_MAX_STREAMS; i++) {
+        portENTER_CRITICAL(&telemetry_streams_mux);
+        TelemetryStream stream = telemetry_streams[i];
+        portEXIT_CRITICAL(&telemetry_streams_mux);
+        if (stream.client_id == 0) continue;
+
+        AsyncWebSocketClient* client = telemetry_ws.client(stream.client_id);
+        if (client == NULL || client->status() != WS_CONNECTED || client->queueIsFull()) continue;
+
+        TelemetryRecord* records = (TelemetryRecord*)(frame + sizeof(TelemetryFrameHeader));
+        size_t count = telemetry_read(&stream.cursor, records, TELEMETRY_BATCH_RECORDS, &stream.dropped);
+        if (count > 0) {
+            // Records skipped by telemetry_read() are not part of this frame
+            TelemetryFrameHeader header = {1, (uint16_t)count, stream.cursor - (uint32_t)count, stream.dropped};
+            memcpy(frame, &header, sizeof(header));
+            client->binary(frame, sizeof(header) + count * sizeof(TelemetryRecord));
+        }
+
+        portENTER_CRITICAL(&telemetry_streams_mux);
+        if (telemetry_streams[i].client_id == stream.client_id) {
+            telemetry_streams[i] = stream;
+        }
+        portEXIT_CRITICAL(&telemetry_streams_mux);
     }
 }
 
@@ -59,7 +184,8 @@ void onWsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventTyp
  */
 void handleDataRequest(AsyncWebServerRequest* request) {
     if (xSemaphoreTake(dataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        DynamicJsonDocument doc(2048);
+        // Room for the history arrays plus the LED and RS485 statistics
+        DynamicJsonDocument doc(8192);
         doc["uptime"] = millis();
         doc["voltage"] = voltage_data.empty() ? 0 : voltage_data.back();
         doc["power"] = power_data.empty() ? 0 : power_data.back();
@@ -67,6 +193,89 @@ void handleDataRequest(AsyncWebServerRequest* request) {
         doc["sd_used"] = (double)SD.usedBytes();
         doc["sd_free_percent"] = (float)(SD.cardSize() - SD.usedBytes()) / SD.cardSize() * 100.0;
 
+        FrameStats led_stats = led_frame_stats();
+        JsonObject led = doc.createNestedObject("led_frames");
+        led["target_fps"] = config.LEDS.TARGET_FPS;
+        led["fps"] = led_stats.achieved_fps;
+        led["frames"] = led_stats.frames;
+        led["missed_deadlines"] = led_stats.missed_deadlines;
+        led["avg_frame_us"] = led_stats.avg_frame_us;
+        led["max_frame_us"] = led_stats.max_frame_us;
+
+        FrameBufferFootprint fb = framebuffer_footprint();
+        JsonObject led_memory = doc.createNestedObject("led_memory");
+        led_memory["internal_bytes"] = fb.internal_bytes;
+        led_memory["psram_bytes"] = fb.psram_bytes;
+
+        const char* axis_names[AXIS_COUNT] = {"Y", "YY", "X"};
+        JsonObject polling = doc.createNestedObject("servo_polling");
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            PollStats poll = servo_poll_stats(axis);
+            JsonObject axis_poll = polling.createNestedObject(axis_names[axis]);
+            axis_poll["position_hz"] = poll.position_hz;
+            axis_poll["status_hz"] = poll.status_hz;
+            axis_poll["bus_utilization"] = poll.bus_utilization;
+            axis_poll["moving"] = (bool)poll.moving;
+            axis_poll["near_limit"] = (bool)poll.near_limit;
+        }
+
+        SkewStats skew = gantry_skew_stats();
+        JsonObject skew_json = doc.createNestedObject("gantry_skew");
+        skew_json["error_mm"] = skew.error_mm;
+        skew_json["filtered_mm"] = skew.filtered_mm;
+        skew_json["min_mm"] = skew.min_mm;
+        skew_json["max_mm"] = skew.max_mm;
+        skew_json["threshold_mm"] = config.TABLE.SKEW_THRESHOLD_MM;
+        skew_json["alarm"] = (bool)skew.alarm;
+        skew_json["alarms"] = skew.alarms;
+        skew_json["pairs"] = skew.pairs;
+        skew_json["max_pair_spread_ms"] = skew.max_pair_spread_ms;
+        JsonArray skew_histogram = skew_json.createNestedArray("histogram");
+        for (int b = 0; b < SKEW_HISTOGRAM_BINS; b++) {
+            skew_histogram.add(skew.histogram[b]);
+        }
+
+        JsonObject bus = doc.createNestedObject("rs485");
+        bus["baud"] = modbus_rtu_baud();
+        bus["configured_baud"] = config.SERVOS.BAUD;
+        JsonObject slaves = bus.createNestedObject("slaves");
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            ModbusSlaveStats modbus = servo_modbus_stats(axis);
+            JsonObject slave = slaves.createNestedObject(axis_names[axis]);
+            slave["success"] = modbus.success;
+            slave["timeouts"] = modbus.timeouts;
+            slave["crc_errors"] = modbus.crc_errors;
+            slave["exceptions"] = modbus.exceptions;
+            slave["last_exception"] = modbus.last_exception;
+            slave["bad_responses"] = modbus.bad_responses;
+            slave["expired"] = modbus.expired;
+            slave["retries"] = modbus.retries;
+            slave["max_latency_us"] = modbus.max_latency_us;
+            JsonArray latency = slave.createNestedArray("latency_histogram");
+            for (int b = 0; b < MODBUS_LATENCY_BINS; b++) {
+                latency.add(modbus.latency_histogram[b]);
+            }
+
+            AxisState state;
+            axis_mailboxes[axis].read(state);
+            slave["stale"] = (bool)state.stale;
+        }
+        const BusTuningReport& tuning = bus_tuning_report();
+        if (tuning.valid) {
+            JsonArray rates = bus.createNestedArray("autotune");
+            for (int r = 0; r < BUS_TUNING_RATE_COUNT && tuning.rates[r].tested; r++) {
+                JsonObject rate = rates.createNestedObject();
+                rate["baud"] = tuning.rates[r].baud;
+                rate["reliable"] = (bool)tuning.rates[r].reliable;
+                for (int axis = 0; axis < AXIS_COUNT; axis++) {
+                    JsonObject slave = rate.createNestedObject(axis_names[axis]);
+                    slave["ok"] = tuning.rates[r].successes[axis];
+                    slave["avg_rtt_us"] = tuning.rates[r].avg_rtt_us[axis];
+                    slave["max_rtt_us"] = tuning.rates[r].max_rtt_us[axis];
+                }
+            }
+        }
+
         JsonArray power_array = doc.createNestedArray("power_history");
         for (float p : power_data) {
             power_array.add(p);
@@ -112,6 +321,7 @@ void handleConfigUpdate(AsyncWebServerRequest* request) {
         request->send(200, "text/plain", "Configuration updated. Restarting...");
         // Wait a moment for the response to be sent before restarting
         vTaskDelay(pdMS_TO_TICKS(100));
+        sd_log_flush(pdMS_TO_TICKS(1000));
         ESP.restart();
     } else {
         request->send(405, "text/plain", "Method Not Allowed");
@@ -127,9 +337,110 @@ void handleRestart(AsyncWebServerRequest* request) {
     request->send(200, "text/plain", "Restarting...");
     // Wait a moment for the response to be sent before restarting
     vTaskDelay(pdMS_TO_TICKS(100));
+    sd_log_flush(pdMS_TO_TICKS(1000));
     ESP.restart();
 }
 
+/**
+ * @struct LogRangeStream
+ * @brief State of one chunked time range response.
+ */
+struct LogRangeStream {
+    LogCursor cursor;
+    char* text;         // Rendered lines, LOG_RANGE_CHUNK_BYTES, in PSRAM if free
+    size_t length;
+    size_t sent;
+
+    ~LogRangeStream() { free(text); }
+};
+
+/**
+ * @brief Streams the messages of a time range as text.
+ *
+ * The lines are rendered a piece at a time as the connection takes them, so
+ * sdMutex is only held briefly and the range may be of any length.
+ */
+static void sendLogRange(AsyncWebServerRequest* request, uint32_t since, uint32_t until) {
+    std::shared_ptr<LogRangeStream> stream = std::make_shared<LogRangeStream>();
+    stream->text = (char*)heap_caps_malloc(LOG_RANGE_CHUNK_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (stream->text == NULL) {
+        stream->text = (char*)heap_caps_malloc(LOG_RANGE_CHUNK_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (stream->text == NULL) {
+        request->send(503, "text/plain", "Server busy. Try again.");
+        return;
+    }
+    stream->length = 0;
+    stream->sent = 0;
+    sd_log_seek(&stream->cursor, since, until);
+
+    AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain",
+        [stream](uint8_t* buffer, size_t max_length, size_t index) -> size_t {
+            if (stream->sent == stream->length) {
+                stream->length = 0;
+                stream->sent = 0;
+                while (stream->length == 0 && stream->cursor.seq != 0) {
+                    stream->length = sd_log_read(&stream->cursor, stream->text, LOG_RANGE_CHUNK_BYTES);
+                }
+            }
+            // Returning 0 ends the response
+            size_t n = stream->length - stream->sent;
+            if (n > max_length) n = max_length;
+            memcpy(buffer, stream->text + stream->sent, n);
+            stream->sent += n;
+            return n;
+        });
+    request->send(response);
+}
+
+/**
+ * @brief Handles the log view request: the last lines of the SD log as text.
+ *
+ * `lines` selects the number of lines (default LOG_VIEW_LINES). With `since`
+ * and optionally `until` (e.g. "02:00" or "2024-05-01T02:00", see
+ * log_parse_time()) it returns the messages of that time range instead.
+ * Binary logs are rendered on the device.
+ *
+ * @param request The server request object.
+ */
+void handleLogRequest(AsyncWebServerRequest* request) {
+    if (request->hasParam("since")) {
+        uint32_t now = (uint32_t)time(NULL);
+        uint32_t since;
+        uint32_t until = UINT32_MAX;
+        if (!log_parse_time(request->getParam("since")->value().c_str(), now, &since) ||
+            (request->hasParam("until") && !log_parse_time(request->getParam("until")->value().c_str(), now, &until))) {
+            request->send(400, "text/plain", "Bad time. Use YYYY-MM-DDTHH:MM[:SS] or HH:MM[:SS].");
+            return;
+        }
+        sendLogRange(request, since, until);
+        return;
+    }
+
+    size_t lines = LOG_VIEW_LINES;
+    if (request->hasParam("lines")) {
+        long requested = request->getParam("lines")->value().toInt();
+        if (requested > 0) lines = requested;
+    }
+
+    // Without PSRAM the view is cut to the last lines that fit a smaller buffer
+    size_t capacity = LOG_VIEW_BYTES;
+    char* text = (char*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (text == NULL) {
+        capacity = LOG_VIEW_BYTES_INTERNAL;
+        text = (char*)heap_caps_malloc(capacity, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (text == NULL) {
+        request->send(503, "text/plain", "Server busy. Try again.");
+        return;
+    }
+    size_t length = sd_log_tail(text, capacity, lines);
+    AsyncResponseStream* response = request->beginResponseStream("text/plain");
+    response->write((const uint8_t*)text, length);
+    free(text);
+    request->send(response);
+}
+
 /**
  * @brief Initializes and configures the Async Web Server.
  */
@@ -137,6 +448,8 @@ void webserver_init() {
     dataMutex = xSemaphoreCreateMutex();
     ws.onEvent(onWsEvent);
     server.addHandler(&ws);
+    telemetry_ws.onEvent(onTelemetryWsEvent);
+    server.addHandler(&telemetry_ws);
 
     // Serve static files from SD card /www directory
     server.serveStatic("/", SD, "/www/").setDefaultFile("index.html");
@@ -150,9 +463,12 @@ void webserver_init() {
     // Route for restarting the ESP32
     server.on("/restart", HTTP_POST, handleRestart);
 
+    // Route for the log view
+    server.on("/log", HTTP_GET, handleLogRequest);
+
     // Start the server
     server.begin();
-    log_to_sd("Web server started.");
+    LOG_INFO(LOG_WEB, "Web server started.");
 
     // Initialize ADC for ADC voltage readings
     // Use the pin from the loaded configuration
@@ -198,9 +514,17 @@ void webserver_data_update() {
  */
 void webserver_task(void* pvParameters) {
     webserver_init();
+    TickType_t last_data_update = xTaskGetTickCount();
+    webserver_data_update();
     while (1) {
+        // Stream servo telemetry at a high rate
+        telemetry_stream_update();
+
         // Periodically update and send data via WebSocket
-        webserver_data_update();
-        vTaskDelay(pdMS_TO_TICKS(60000)); // Update every 1 minute
+        if (xTaskGetTickCount() - last_data_update >= pdMS_TO_TICKS(60000)) { // Update every 1 minute
+            webserver_data_update();
+            last_data_update = xTaskGetTickCount();
+        }
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_STREAM_PERIOD_MS));
     }
 }
@@ -0,0 +1,223 @@
+/**
+ * @file lc10e_model.cpp
+ * @brief Implementation of the scripted LC10e servo model.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "lc10e_model.h"
+#include "version.h"
+#include "modbus_codec.h"
+#include "servo_registers.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+/**
+ * @brief Returns true if every register in [address, address + count) is answered.
+ */
+bool Lc10eServo::mapped(uint16_t address, uint16_t count) const {
+    for (uint32_t reg = address; reg < (uint32_t)address + count; reg++) {
+        bool used = reg == SERVO_REG_STATUS || reg == SERVO_REG_POSITION || reg == SERVO_REG_POSITION + 1;
+        bool readable = reg >= readable_start && reg < (uint32_t)readable_start + readable_count;
+        if (reg >= LC10E_REGISTER_COUNT || !(used || readable)) return false;
+    }
+    return true;
+}
+
+int32_t Lc10eServo::position_at(uint32_t now_ms) const {
+    if (move_duration_ms == 0 || now_ms >= move_start_ms + move_duration_ms) return move_to;
+    if (now_ms <= move_start_ms) return move_from;
+    int64_t travelled = (int64_t)(move_to - move_from) * (now_ms - move_start_ms) / move_duration_ms;
+    return move_from + (int32_t)travelled;
+}
+
+uint16_t Lc10eServo::status_at(uint32_t now_ms) const {
+    uint16_t status = forced_status;
+    if (rail) {
+        int32_t position = position_at(now_ms);
+        if (position <= rail_min) status |= 0x01;
+        if (position >= rail_max) status |= 0x02;
+    }
+    return status;
+}
+
+Lc10eServo& Lc10eModel::add_servo(uint8_t slave_id) {
+    Lc10eServo* servo = find(slave_id);
+    if (servo) return *servo;
+    servo_list.push_back(Lc10eServo());
+    servo_list.back().slave_id = slave_id;
+    return servo_list.back();
+}
+
+Lc10eServo* Lc10eModel::find(uint8_t slave_id) {
+    for (Lc10eServo& servo : servo_list) {
+        if (servo.slave_id == slave_id) return &servo;
+    }
+    return nullptr;
+}
+
+bool Lc10eModel::load_scenario(const char* path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    // Number of arguments after the slave ID, -1 for commands without a slave
+    static const struct { const char* name; int args; } commands[] = {
+        {"position", 1}, {"move", 2}, {"rail", 2}, {"limit", 1}, {"timeout", 1},
+        {"corrupt", 1}, {"offline", 0}, {"online", 0}, {"delay", 1}, {"readable", 2}, {"end", -1}
+    };
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        Lc10eEvent event = {};
+        if (!(words >> event.time_ms)) continue;
+
+        std::string where = std::string(path) + ":" + std::to_string(line_number) + ": ";
+        if (!(words >> event.command)) {
+            error = where + "missing command";
+            return false;
+        }
+
+        int args = -2;
+        for (const auto& command : commands) {
+            if (event.command == command.name) args = command.args;
+        }
+        if (args == -2) {
+            error = where + "unknown command '" + event.command + "'";
+            return false;
+        }
+
+        if (args >= 0) {
+            int slave_id;
+            if (!(words >> slave_id) || slave_id < 1 || slave_id > 247) {
+                error = where + "invalid slave ID";
+                return false;
+            }
+            event.slave_id = (uint8_t)slave_id;
+            add_servo(event.slave_id);
+        }
+
+        for (int i = 0; i < args; i++) {
+            std::string arg;
+            if (!(words >> arg)) {
+                error = where + "missing argument";
+                return false;
+            }
+            if (event.command == "limit") {
+                if (arg == "none") event.args[i] = 0;
+                else if (arg == "min") event.args[i] = 0x01;
+                else if (arg == "max") event.args[i] = 0x02;
+                else {
+                    error = where + "limit must be min, max or none";
+                    return false;
+                }
+            } else {
+                event.args[i] = (int32_t)strtol(arg.c_str(), nullptr, 0);
+            }
+        }
+        events.push_back(event);
+    }
+
+    // Events run in time order; equal times keep the order of the script
+    std::stable_sort(events.begin(), events.end(), [](const Lc10eEvent& a, const Lc10eEvent& b) {
+        return a.time_ms < b.time_ms;
+    });
+    return true;
+}
+
+void Lc10eModel::apply(const Lc10eEvent& event) {
+    if (event.command == "end") {
+        ended = true;
+        return;
+    }
+
+    Lc10eServo& servo = add_servo(event.slave_id);
+    if (event.command == "position") {
+        servo.move_from = servo.move_to = event.args[0];
+        servo.move_duration_ms = 0;
+    } else if (event.command == "move") {
+        servo.move_from = servo.position_at(event.time_ms);
+        servo.move_to = event.args[0];
+        servo.move_start_ms = event.time_ms;
+        servo.move_duration_ms = (uint32_t)event.args[1];
+    } else if (event.command == "rail") {
+        servo.rail = true;
+        servo.rail_min = event.args[0];
+        servo.rail_max = event.args[1];
+    } else if (event.command == "limit") {
+        servo.forced_status = (uint16_t)event.args[0];
+    } else if (event.command == "timeout") {
+        servo.drop_responses = (uint32_t)event.args[0];
+    } else if (event.command == "corrupt") {
+        servo.corrupt_responses = (uint32_t)event.args[0];
+    } else if (event.command == "offline") {
+        servo.offline = true;
+    } else if (event.command == "online") {
+        servo.offline = false;
+    } else if (event.command == "delay") {
+        servo.response_delay_us = (uint32_t)event.args[0];
+    } else if (event.command == "readable") {
+        bool valid = event.args[0] >= 0 && event.args[1] >= event.args[0];
+        servo.readable_start = valid ? (uint16_t)event.args[0] : 0;
+        servo.readable_count = valid ? (uint16_t)(event.args[1] - event.args[0] + 1) : 0;
+    }
+}
+
+void Lc10eModel::advance(uint32_t now_ms) {
+    while (next_event < events.size() && events[next_event].time_ms <= now_ms) {
+        apply(events[next_event]);
+        next_event++;
+    }
+}
+
+size_t Lc10eModel::handle(const uint8_t* request, size_t length, uint32_t now_ms,
+                          uint8_t* response, uint32_t* delay_us) {
+    advance(now_ms);
+    *delay_us = 0;
+
+    uint8_t slave_id;
+    uint16_t address;
+    uint16_t count;
+    ModbusStatus status = modbus_decode_read_request(request, length, &slave_id, &address, &count);
+
+    // A drive ignores corrupted frames and frames for other addresses
+    if (status == MODBUS_CRC_ERROR || length < 2) return 0;
+    Lc10eServo* servo = find(request[0]);
+    if (!servo || servo->offline) return 0;
+    servo->requests++;
+    if (servo->drop_responses > 0) {
+        servo->drop_responses--;
+        return 0;
+    }
+    *delay_us = servo->response_delay_us;
+
+    size_t response_length;
+    if (status != MODBUS_OK) {
+        response_length = modbus_encode_exception(response, MODBUS_MAX_FRAME, request[0], request[1], 0x01);
+    } else if (count == 0 || count > MODBUS_MAX_READ_REGISTERS || !servo->mapped(address, count)) {
+        response_length = modbus_encode_exception(response, MODBUS_MAX_FRAME, slave_id,
+                                                  MODBUS_READ_HOLDING_REGISTERS, LC10E_ILLEGAL_ADDRESS);
+    } else {
+        uint16_t registers[LC10E_REGISTER_COUNT] = {};
+        uint32_t position = (uint32_t)servo->position_at(now_ms);
+        registers[SERVO_REG_STATUS] = servo->status_at(now_ms);
+        registers[SERVO_REG_POSITION] = (uint16_t)(position >> 16);
+        registers[SERVO_REG_POSITION + 1] = (uint16_t)position;
+        response_length = modbus_encode_read_response(response, MODBUS_MAX_FRAME, slave_id,
+                                                      registers + address, count);
+    }
+
+    if (response_length > 0 && servo->corrupt_responses > 0) {
+        servo->corrupt_responses--;
+        response[response_length - 1] ^= 0xFF;
+    }
+    return response_length;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file lc10e_model.h
+ * @brief Scripted model of a bus of LC10e servo drives, for host testing.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Each simulated servo answers Read Holding Registers requests for the
+ * registers the firmware uses: the limit switch status word at register 10
+ * and the 32-bit position at registers 20-21 (high word first). A read that
+ * touches any other register answers with an illegal data address exception,
+ * so by default reading across the gap between them fails. A `readable` event
+ * models a drive that answers a wider block, the unused registers as 0.
+ *
+ * A scenario script drives the servos over time. One event per line:
+ *
+ *     <time_ms> <command> <slave> [arguments]
+ *
+ *     0     position 1 0              set the position at once
+ *     100   move 1 50000 2000         move linearly to 50000 counts in 2000 ms
+ *     0     rail 1 0 100000           switch the limits on at the rail ends
+ *     3000  limit 1 min|max|none      force the limit switch status
+ *     4000  timeout 1 5               swallow the next 5 requests
+ *     4000  corrupt 1 5               corrupt the CRC of the next 5 responses
+ *     5000  offline 1 / online 1      stop or resume answering altogether
+ *     0     delay 1 800               answer 800 us after the request
+ *     0     readable 1 10 21          answer reads anywhere in registers 10-21
+ *     9000  end                       end of the scenario
+ *
+ * Time 0 is the first request the bus sees. Text after '#' is a comment.
+ */
+#ifndef LC10E_MODEL_H
+#define LC10E_MODEL_H
+
+#include "version.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Size of the simulated drive's register image; only the status word and
+// the position within it are mapped
+#define LC10E_REGISTER_COUNT        64
+
+// Modbus exception code for an address outside the register map
+#define LC10E_ILLEGAL_ADDRESS       0x02
+
+/**
+ * @struct Lc10eServo
+ * @brief State of one simulated drive.
+ */
+struct Lc10eServo {
+    uint8_t slave_id = 0;
+
+    // Current linear move; the position is interpolated from it
+    int32_t move_from = 0;
+    int32_t move_to = 0;
+    uint32_t move_start_ms = 0;
+    uint32_t move_duration_ms = 0;
+
+    // Limit switches close at the rail ends when a rail is set
+    bool rail = false;
+    int32_t rail_min = 0;
+    int32_t rail_max = 0;
+    uint16_t forced_status = 0;
+
+    bool offline = false;
+    uint32_t drop_responses = 0;
+    uint32_t corrupt_responses = 0;
+    uint32_t response_delay_us = 0;
+
+    // Block answered besides the status and position registers, count 0 for none
+    uint16_t readable_start = 0;
+    uint16_t readable_count = 0;
+
+    uint32_t requests = 0;
+
+    int32_t position_at(uint32_t now_ms) const;
+    uint16_t status_at(uint32_t now_ms) const;
+    bool mapped(uint16_t address, uint16_t count) const;
+};
+
+/**
+ * @struct Lc10eEvent
+ * @brief One scripted change of a servo.
+ */
+struct Lc10eEvent {
+    uint32_t time_ms;
+    std::string command;
+    uint8_t slave_id;
+    int32_t args[3];
+};
+
+/**
+ * @class Lc10eModel
+ * @brief The simulated bus: servos, their scenario and the request handler.
+ */
+class Lc10eModel {
+public:
+    /**
+     * @brief Adds a servo that answers under `slave_id`.
+     */
+    Lc10eServo& add_servo(uint8_t slave_id);
+
+    /**
+     * @brief Loads a scenario script.
+     *
+     * @param path The script file.
+     * @param error Receives the reason on failure.
+     * @return False if the file cannot be read or a line is invalid.
+     */
+    bool load_scenario(const char* path, std::string& error);
+
+    /**
+     * @brief Applies every scenario event due at `now_ms`.
+     */
+    void advance(uint32_t now_ms);
+
+    /**
+     * @brief True once the scenario's `end` event has been reached.
+     */
+    bool finished() const { return ended; }
+
+    /**
+     * @brief Answers one request frame.
+     *
+     * @param request The received frame.
+     * @param length Its length.
+     * @param now_ms Scenario time.
+     * @param response Output buffer, at least MODBUS_MAX_FRAME bytes.
+     * @param delay_us Receives how long the servo takes to answer.
+     * @return The response length, 0 if the servo stays silent.
+     */
+    size_t handle(const uint8_t* request, size_t length, uint32_t now_ms,
+                  uint8_t* response, uint32_t* delay_us);
+
+    const std::vector<Lc10eServo>& servos() const { return servo_list; }
+
+private:
+    Lc10eServo* find(uint8_t slave_id);
+    void apply(const Lc10eEvent& event);
+
+    std::vector<Lc10eServo> servo_list;
+    std::vector<Lc10eEvent> events;
+    size_t next_event = 0;
+    std::atomic<bool> ended{false};
+};
+
+#endif // LC10E_MODEL_H
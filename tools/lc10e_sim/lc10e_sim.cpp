@@ -0,0 +1,97 @@
+/**
+ * @file lc10e_sim.cpp
+ * @brief LC10e servo bus simulator on a Linux pseudo terminal.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Simulates the Y, YY and X servo drives behind a pty so the servo path can be
+ * exercised without the machine. Build from the repository root with:
+ *
+ *     g++ -std=c++17 -O2 -IArduino -o lc10e_sim tools/lc10e_sim/lc10e_sim.cpp \
+ *         tools/lc10e_sim/lc10e_model.cpp tools/lc10e_sim/sim_serial.cpp Arduino/modbus_codec.cpp \
+ *         Arduino/modbus_exchange.cpp
+ *
+ * Usage:
+ *
+ *     lc10e_sim [--scenario FILE] [--baud N] [--slaves 1,2,3] [--verbose]
+ *
+ * The pty path is printed on stdout; connect tools/servo_replay or any Modbus
+ * master to it.
+ */
+#include "version.h"
+#include "lc10e_model.h"
+#include "sim_serial.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::atomic<bool> stop_requested(false);
+
+static void on_signal(int) {
+    stop_requested = true;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: lc10e_sim [--scenario FILE] [--baud N] [--slaves 1,2,3] [--verbose]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* scenario = nullptr;
+    const char* slaves = "1,2,3";
+    int baud = 19200;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--scenario") && has_value) scenario = argv[++i];
+        else if (!strcmp(argv[i], "--baud") && has_value) baud = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--slaves") && has_value) slaves = argv[++i];
+        else if (!strcmp(argv[i], "--verbose")) verbose = true;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (baud <= 0) {
+        usage();
+        return 2;
+    }
+
+    Lc10eModel model;
+    std::string slave_list = slaves;
+    for (char* id = strtok(&slave_list[0], ","); id; id = strtok(nullptr, ",")) {
+        int slave_id = atoi(id);
+        if (slave_id < 1 || slave_id > 247) {
+            usage();
+            return 2;
+        }
+        model.add_servo((uint8_t)slave_id);
+    }
+    if (scenario) {
+        std::string error;
+        if (!model.load_scenario(scenario, error)) {
+            fprintf(stderr, "lc10e_sim: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    std::string path;
+    int fd = sim_open_pty(path);
+    if (fd < 0) {
+        perror("lc10e_sim: pty");
+        return 1;
+    }
+    printf("%s\n", path.c_str());
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    sim_serve(fd, model, baud, stop_requested, verbose);
+
+    for (const Lc10eServo& servo : model.servos()) {
+        fprintf(stderr, "slave %3u: %u requests\n", servo.slave_id, servo.requests);
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file sim_serial.cpp
+ * @brief Implementation of the Linux serial endpoints and RTU framing.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ */
+#include "sim_serial.h"
+#include "version.h"
+#include "modbus_codec.h"
+#include "modbus_exchange.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+uint64_t host_micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+uint32_t serial_char_us(int baud) {
+    return modbus_char_us((uint32_t)baud);
+}
+
+uint32_t serial_frame_gap_us(int baud) {
+    return modbus_frame_gap_us((uint32_t)baud, 0);
+}
+
+/**
+ * @brief Puts a terminal into raw mode; other descriptors are left alone.
+ */
+static void make_raw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return;
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+}
+
+int serial_open(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    make_raw(fd);
+    return fd;
+}
+
+int sim_open_pty(std::string& slave_path) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        if (master >= 0) close(master);
+        return -1;
+    }
+    slave_path = ptsname(master);
+
+    // The line discipline is shared by both ends; keeping a slave descriptor
+    // open also stops reads on the master failing while no client is attached
+    int slave = open(slave_path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        close(master);
+        return -1;
+    }
+    make_raw(slave);
+    make_raw(master);
+    return master;
+}
+
+size_t serial_read_frame(int fd, uint8_t* frame, size_t capacity, uint32_t first_byte_timeout_us, uint32_t gap_us) {
+    size_t length = 0;
+    uint32_t timeout_us = first_byte_timeout_us;
+
+    while (true) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, (int)((timeout_us + 999) / 1000));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0 || !(pfd.revents & POLLIN)) break;
+
+        uint8_t discard[64];
+        uint8_t* into = length < capacity ? frame + length : discard;
+        size_t room = length < capacity ? capacity - length : sizeof(discard);
+        ssize_t n = read(fd, into, room);
+        if (n <= 0) break;
+        if (length < capacity) length += n;
+
+        // Once the frame has started, silence ends it
+        timeout_us = gap_us;
+    }
+    return length;
+}
+
+bool serial_write_frame(int fd, const uint8_t* frame, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, frame + written, length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Sleeps until the monotonic clock reaches `until_us`.
+ */
+static void sleep_until(uint64_t until_us) {
+    uint64_t now = host_micros();
+    if (until_us <= now) return;
+    uint64_t wait_us = until_us - now;
+    struct timespec duration = {(time_t)(wait_us / 1000000), (long)(wait_us % 1000000) * 1000};
+    nanosleep(&duration, nullptr);
+}
+
+void sim_serve(int fd, Lc10eModel& model, int baud, const std::atomic<bool>& stop, bool verbose) {
+    uint32_t char_us = serial_char_us(baud);
+    uint32_t gap_us = serial_frame_gap_us(baud);
+    bool started = false;
+    uint64_t start_us = 0;
+
+    uint8_t request[MODBUS_MAX_FRAME];
+    uint8_t response[MODBUS_MAX_FRAME];
+    while (!stop && !model.finished()) {
+        size_t length = serial_read_frame(fd, request, sizeof(request), 100000, gap_us);
+        if (length == 0) continue;
+
+        // Scenario time starts with the first request on the bus
+        uint64_t received_us = host_micros();
+        if (!started) {
+            started = true;
+            start_us = received_us;
+        }
+        uint32_t now_ms = (uint32_t)((received_us - start_us) / 1000);
+
+        uint32_t delay_us;
+        size_t response_length = model.handle(request, length, now_ms, response, &delay_us);
+        if (verbose) {
+            fprintf(stderr, "%8u ms  slave %3u  %zu bytes -> %zu bytes\n",
+                    now_ms, request[0], length, response_length);
+        }
+        if (response_length == 0) continue;
+
+        // The request arrived instantly; hold the answer back by the wire time
+        // of both frames, the frame gap and the drive's own delay
+        sleep_until(received_us + (length + response_length) * char_us + gap_us + delay_us);
+        if (!serial_write_frame(fd, response, response_length)) break;
+    }
+}
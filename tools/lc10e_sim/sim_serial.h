@@ -0,0 +1,86 @@
+/**
+ * @file sim_serial.h
+ * @brief Serial endpoints and RTU framing on Linux, for the simulator and the replay harness.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * The simulator serves the bus on a pseudo terminal (or any file descriptor,
+ * e.g. one end of a socketpair). Frames are delimited the way the RS485 UART
+ * does it on the device: by a silent gap on the line. A pty transfers data
+ * instantly, so the simulator also holds every answer back by the wire time
+ * the request and the response would need at the configured baud rate, which
+ * keeps round trips and throughput comparable with the real bus.
+ */
+#ifndef SIM_SERIAL_H
+#define SIM_SERIAL_H
+
+#include "version.h"
+#include "lc10e_model.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief Microseconds on the host's monotonic clock.
+ */
+uint64_t host_micros();
+
+/**
+ * @brief Time one character takes on the wire (start, 8 data, parity/stop, stop bit).
+ */
+uint32_t serial_char_us(int baud);
+
+/**
+ * @brief Silent time that ends a frame, the firmware's modbus_frame_gap_us().
+ */
+uint32_t serial_frame_gap_us(int baud);
+
+/**
+ * @brief Opens a serial device in raw mode.
+ *
+ * @param path The device, e.g. the pty printed by lc10e_sim.
+ * @return The file descriptor, -1 on failure.
+ */
+int serial_open(const char* path);
+
+/**
+ * @brief Creates a pseudo terminal in raw mode for the simulator.
+ *
+ * @param slave_path Receives the path clients connect to.
+ * @return The master file descriptor, -1 on failure.
+ */
+int sim_open_pty(std::string& slave_path);
+
+/**
+ * @brief Reads one frame.
+ *
+ * @param fd The descriptor to read from.
+ * @param frame Output buffer.
+ * @param capacity Size of the output buffer.
+ * @param first_byte_timeout_us How long to wait for the frame to start.
+ * @param gap_us Silence after which the frame is complete.
+ * @return The frame length, 0 if nothing arrived in time.
+ */
+size_t serial_read_frame(int fd, uint8_t* frame, size_t capacity, uint32_t first_byte_timeout_us, uint32_t gap_us);
+
+/**
+ * @brief Writes a whole frame.
+ *
+ * @return False if the descriptor failed.
+ */
+bool serial_write_frame(int fd, const uint8_t* frame, size_t length);
+
+/**
+ * @brief Answers requests on `fd` from the model until `stop` is set or the scenario ends.
+ *
+ * @param fd The bus endpoint.
+ * @param model The simulated servos.
+ * @param baud The line rate used for frame gaps and wire time.
+ * @param stop Set by another thread to end serving.
+ * @param verbose Print every transaction to stderr.
+ */
+void sim_serve(int fd, Lc10eModel& model, int baud, const std::atomic<bool>& stop, bool verbose);
+
+#endif // SIM_SERIAL_H
@@ -0,0 +1,93 @@
+/**
+ * @file FastLED.h
+ * @brief Host stand-in for the parts of FastLED the LED pipeline uses.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Only what the compositor, blend kernel, lookup tables and effects need to
+ * build on the host: CRGB with the named colors, fill_solid(), nscale8() and
+ * blend(). The arithmetic matches FastLED's fixed scale8/blend8 versions, so
+ * the reference paths compute the same pixels as on the device.
+ */
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+typedef uint8_t fract8;
+
+using std::max;
+using std::min;
+
+static inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+static inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amount_of_b) {
+    uint16_t partial = (uint16_t)((a << 8) | b);
+    partial += (uint16_t)(b * amount_of_b);
+    partial -= (uint16_t)(a * amount_of_b);
+    return (uint8_t)(partial >> 8);
+}
+
+struct CRGB {
+    union {
+        struct {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    enum HTMLColorCode : uint32_t {
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        Green = 0x008000,
+        Magenta = 0xFF00FF,
+        Orange = 0xFFA500,
+        Purple = 0x800080,
+        Red = 0xFF0000,
+        White = 0xFFFFFF
+    };
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+    CRGB(uint32_t code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+    CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+
+    uint8_t& operator[](int i) { return raw[i]; }
+    const uint8_t& operator[](int i) const { return raw[i]; }
+
+    CRGB& nscale8(uint8_t scale) {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+};
+
+static inline bool operator==(const CRGB& a, const CRGB& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static inline bool operator!=(const CRGB& a, const CRGB& b) {
+    return !(a == b);
+}
+
+// FastLED's color correction for SMD5050 LEDs
+static const CRGB TypicalSMD5050 = CRGB((uint32_t)0xFFB0F0);
+
+static inline void fill_solid(CRGB* leds, int num_leds, const CRGB& color) {
+    for (int i = 0; i < num_leds; i++) leds[i] = color;
+}
+
+static inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amount_of_p2) {
+    return CRGB(blend8(p1.r, p2.r, amount_of_p2), blend8(p1.g, p2.g, amount_of_p2),
+                blend8(p1.b, p2.b, amount_of_p2));
+}
+
+#endif // HOST_FASTLED_H
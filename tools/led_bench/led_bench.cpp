@@ -0,0 +1,459 @@
+/**
+ * @file led_bench.cpp
+ * @brief Host checks and benchmarks of the LED pixel pipeline.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Runs the firmware's LED modules on the host against reference versions of
+ * the code they replaced, on the 700/700/400 LED strips of the gantry. The
+ * FastLED.h next to this file stands in for the library. Build from the
+ * repository root with:
+ *
+ *     g++ -std=c++17 -O2 -Itools/led_bench -IArduino -o led_bench tools/led_bench/led_bench.cpp \
+ *         Arduino/led_compositor.cpp Arduino/led_blend.cpp Arduino/led_lut.cpp Arduino/led_effects.cpp
+ *
+ * Build with -Os instead of -O2 to time the kernels at the firmware's flags.
+ *
+ * Usage:
+ *
+ *     led_bench [CHECK...]
+ *
+ * Runs every check without arguments. The checks:
+ *
+ *     compositor  Composites a scripted sequence of limit alarms and marker
+ *                 moves and compares every frame pixel by pixel with the old
+ *                 full repaint (flash_red_limits, then the position display).
+ *     wire        Wire time per frame of the same sequence, with an Alexa
+ *                 brightness change: the old loop (three brightness-scaled
+ *                 show() calls and an unconditional show() of all strips),
+ *                 each changed strip sent once, and all of them in parallel.
+ *     lut         Output stage over all 1800 LEDs: the lookup tables against
+ *                 the per-pixel scale8 path (brightness and correction), and
+ *                 the cost of switching between the active and idle dim.
+ *     blend       Crossfade of all 1800 LEDs: the Q8 kernel against FastLED's
+ *                 per-pixel blend(), that it is faster and that the fade
+ *                 ends on its target.
+ *     effects     Renders every built-in effect on strips of 700, 400 and 1
+ *                 LEDs at uneven frame times: nothing may be written outside
+ *                 the strip, the Knight Rider eye must be where its step time
+ *                 puts it, and effects must end after their duration.
+ *
+ * Exit status: 0 if every check passed, 1 if one failed, 2 on usage errors.
+ */
+#include "version.h"
+#include "led_compositor.h"
+#include "led_lut.h"
+#include "led_effects.h"
+#include "led_blend.h"
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define STRIP_COUNT     3
+
+static const int strip_leds[STRIP_COUNT] = {700, 700, 400};
+static const char* strip_names[STRIP_COUNT] = {"Y", "YY", "X"};
+
+// LEDs lit on either side of the marker center (config.LEDS.AXIS_POSITION_DISPLAY_LEDS)
+#define MARKER_HALF_WIDTH   2
+
+// WS2815 wire time: 24 bits of 1.25 us per LED, and the latch after a frame
+#define WS2815_LED_US       30
+#define WS2815_LATCH_US     280
+
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @struct StripScene
+ * @brief What one strip shows in a frame of the scripted sequence.
+ */
+struct StripScene {
+    bool min_limit;
+    bool max_limit;
+    int marker;                 // Marker center LED
+};
+
+/**
+ * @brief The scripted sequence: the marker travels, rests and hits both limits.
+ *
+ * @param frame Frame number, 100 ms apart like the old led_task loop.
+ */
+static StripScene scene_at(int strip, int frame) {
+    int num_leds = strip_leds[strip];
+    StripScene scene = {};
+    int phase = frame % 400;
+    if (phase < 100) {
+        scene.marker = num_leds / 2;                            // Resting
+    } else if (phase < 200) {
+        scene.marker = num_leds / 2 + (phase - 100) * (num_leds / 2 - 1) / 99;
+        scene.max_limit = phase >= 180;                         // Runs into the max limit
+    } else if (phase < 300) {
+        scene.marker = num_leds - 1 - (phase - 200) * (num_leds - 1) / 99;
+        scene.min_limit = phase >= 280;                         // Runs into the min limit
+    } else {
+        scene.marker = 0;
+        scene.min_limit = true;
+    }
+    return scene;
+}
+
+/**
+ * @brief The old full repaint: flash_red_limits(), then the position display.
+ */
+static void reference_repaint(CRGB* leds, int num_leds, const StripScene& scene, bool flash_state) {
+    fill_solid(leds, num_leds, CRGB::Orange);
+    if (scene.min_limit && flash_state) fill_solid(leds, 20, CRGB::Red);
+    if (scene.max_limit && flash_state) fill_solid(leds + (num_leds - 20), 20, CRGB::Red);
+
+    int start = max(0, scene.marker - MARKER_HALF_WIDTH);
+    int end = min(num_leds - 1, scene.marker + MARKER_HALF_WIDTH);
+    for (int i = start; i <= end; i++) leds[i] = CRGB::Green;
+}
+
+/**
+ * @brief Compositor output against the old full repaint, frame by frame.
+ */
+static bool check_compositor() {
+    const int frames = 1200;
+    bool passed = true;
+
+    for (int s = 0; s < STRIP_COUNT; s++) {
+        int num_leds = strip_leds[s];
+        std::vector<CRGB> base(num_leds), output(num_leds), reference(num_leds);
+        LedCompositor compositor;
+        compositor.begin(num_leds, base.data(), output.data());
+        compositor.fill_base(CRGB::Orange);
+
+        int mismatched_frames = 0;
+        int sent_frames = 0;
+        uint64_t recomposited = 0;
+        uint64_t compositor_ns = 0;
+        uint64_t reference_ns = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            StripScene scene = scene_at(s, frame);
+            bool flash_on = (frame * 100 / 500) % 2;
+
+            uint64_t start = now_ns();
+            compositor.set_limit_alarm(scene.min_limit, scene.max_limit, flash_on);
+            compositor.set_marker(scene.marker, MARKER_HALF_WIDTH, CRGB::Green);
+            if (compositor.render()) {
+                sent_frames++;
+                recomposited += compositor.changed_span().end - compositor.changed_span().start;
+            }
+            compositor_ns += now_ns() - start;
+
+            start = now_ns();
+            reference_repaint(reference.data(), num_leds, scene, flash_on);
+            reference_ns += now_ns() - start;
+            if (memcmp(output.data(), reference.data(), num_leds * sizeof(CRGB)) != 0) {
+                if (mismatched_frames == 0) {
+                    for (int i = 0; i < num_leds; i++) {
+                        if (output[i] == reference[i]) continue;
+                        printf("  %s frame %d: LED %d is %02x%02x%02x, expected %02x%02x%02x\n", strip_names[s],
+                               frame, i, output[i].r, output[i].g, output[i].b, reference[i].r, reference[i].g,
+                               reference[i].b);
+                        break;
+                    }
+                }
+                mismatched_frames++;
+            }
+        }
+
+        printf("compositor  %-2s %4d LEDs: %d/%d frames identical, %d sent (old: %d, twice each), "
+               "%.1f LEDs changed per sent frame, %.2f us/frame (old repaint %.2f us)\n",
+               strip_names[s], num_leds, frames - mismatched_frames, frames, sent_frames, frames,
+               sent_frames ? (double)recomposited / sent_frames : 0.0, compositor_ns / 1000.0 / frames,
+               reference_ns / 1000.0 / frames);
+        if (mismatched_frames > 0) passed = false;
+    }
+    return passed;
+}
+
+/**
+ * @brief Wire time of one transmission of a strip.
+ */
+static uint32_t strip_wire_us(int num_leds) {
+    return num_leds * WS2815_LED_US + WS2815_LATCH_US;
+}
+
+/**
+ * @brief Wire time per frame of the old and the new output stage.
+ */
+static bool check_wire() {
+    const int frames = 1200;
+    std::vector<CRGB> bases[STRIP_COUNT], scenes[STRIP_COUNT], outputs[STRIP_COUNT];
+    LedCompositor compositors[STRIP_COUNT];
+    OutputLut luts[STRIP_COUNT];
+    for (int s = 0; s < STRIP_COUNT; s++) {
+        bases[s].resize(strip_leds[s]);
+        scenes[s].resize(strip_leds[s]);
+        outputs[s].resize(strip_leds[s]);
+        compositors[s].begin(strip_leds[s], bases[s].data(), scenes[s].data());
+        compositors[s].fill_base(CRGB::Orange);
+    }
+
+    uint64_t old_us = 0, serial_us = 0, parallel_us = 0;
+    uint32_t old_worst = 0, serial_worst = 0, parallel_worst = 0;
+    uint64_t output_ns = 0;
+    int idle_frames = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        bool flash_on = (frame * 100 / 500) % 2;
+        // Alexa dims the Y strip for a while
+        uint8_t brightness[STRIP_COUNT] = {(uint8_t)(frame >= 500 && frame < 700 ? 128 : 255), 255, 255};
+
+        uint32_t old_frame = 0, serial_frame = 0, parallel_frame = 0;
+        uint64_t start = now_ns();
+        for (int s = 0; s < STRIP_COUNT; s++) {
+            StripScene scene = scene_at(s, frame);
+            compositors[s].set_limit_alarm(scene.min_limit, scene.max_limit, flash_on);
+            compositors[s].set_marker(scene.marker, MARKER_HALF_WIDTH, CRGB::Green);
+            bool changed = compositors[s].render();
+
+            LedSpan span = {0, 0};
+            if (luts[s].update(brightness[s], 255, TypicalSMD5050, 1.0f)) {
+                span = {0, strip_leds[s]};
+            } else if (changed) {
+                span = compositors[s].changed_span();
+            }
+            luts[s].apply(scenes[s].data(), outputs[s].data(), span.start, span.end);
+
+            // The old loop sent every strip on its own, then all of them again
+            old_frame += 2 * strip_wire_us(strip_leds[s]);
+            if (!span.empty()) {
+                serial_frame += strip_wire_us(strip_leds[s]);
+                parallel_frame = max(parallel_frame, strip_wire_us(strip_leds[s]));
+            }
+        }
+        output_ns += now_ns() - start;
+
+        if (serial_frame == 0) idle_frames++;
+        old_us += old_frame;
+        serial_us += serial_frame;
+        parallel_us += parallel_frame;
+        old_worst = max(old_worst, old_frame);
+        serial_worst = max(serial_worst, serial_frame);
+        parallel_worst = max(parallel_worst, parallel_frame);
+    }
+
+    printf("wire        %d frames at %d/%d/%d LEDs, %d without any change\n", frames, strip_leds[0],
+           strip_leds[1], strip_leds[2], idle_frames);
+    printf("wire        old loop (show x3, show):  mean %6.2f ms, worst %6.2f ms per frame\n",
+           old_us / 1000.0 / frames, old_worst / 1000.0);
+    printf("wire        changed strips, once each: mean %6.2f ms, worst %6.2f ms per frame\n",
+           serial_us / 1000.0 / frames, serial_worst / 1000.0);
+    printf("wire        changed strips, parallel:  mean %6.2f ms, worst %6.2f ms per frame\n",
+           parallel_us / 1000.0 / frames, parallel_worst / 1000.0);
+    printf("wire        compositing and output stage %.2f us per frame\n", output_ns / 1000.0 / frames);
+    return serial_worst < old_worst && parallel_worst <= serial_worst;
+}
+
+/**
+ * @brief Lookup tables against scaling every pixel, over all strips.
+ */
+static bool check_lut() {
+    const int rounds = 2000;
+    const uint8_t brightness = 200;
+    const uint8_t idle_dim = 64;
+    int total_leds = 0;
+    for (int s = 0; s < STRIP_COUNT; s++) total_leds += strip_leds[s];
+
+    std::vector<CRGB> scene(total_leds), lut_out(total_leds), scale_out(total_leds);
+    for (int i = 0; i < total_leds; i++) scene[i] = CRGB(i * 7, i * 13, i * 29);
+
+    // Per-pixel path: brightness and correction applied with scale8 at output
+    uint64_t start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < total_leds; i++) {
+            CRGB pixel = scene[i];
+            for (int c = 0; c < 3; c++) pixel[c] = scale8(scale8(pixel[c], TypicalSMD5050[c]), brightness);
+            scale_out[i] = pixel;
+        }
+    }
+    uint64_t scale_ns = now_ns() - start;
+
+    OutputLut lut;
+    lut.update(brightness, 255, TypicalSMD5050, 1.0f);
+    start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        lut.apply(scene.data(), lut_out.data(), 0, total_leds);
+    }
+    uint64_t lut_ns = now_ns() - start;
+
+    int max_diff = 0;
+    for (int i = 0; i < total_leds; i++) {
+        for (int c = 0; c < 3; c++) max_diff = max(max_diff, abs(lut_out[i][c] - scale_out[i][c]));
+    }
+
+    // Switching dim levels selects cached tables instead of rebuilding them
+    OutputLut switching;
+    start = now_ns();
+    switching.update(brightness, 255, TypicalSMD5050, 2.2f);
+    switching.update(brightness, idle_dim, TypicalSMD5050, 2.2f);
+    uint64_t build_ns = now_ns() - start;
+    start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        switching.update(brightness, r % 2 ? idle_dim : 255, TypicalSMD5050, 2.2f);
+    }
+    uint64_t switch_ns = now_ns() - start;
+
+    printf("lut         %d LEDs: tables %.2f us, scale8 per pixel %.2f us per frame, max difference %d\n",
+           total_leds, lut_ns / 1000.0 / rounds, scale_ns / 1000.0 / rounds, max_diff);
+    printf("lut         building two dim levels %.2f us, switching between them %.3f us\n", build_ns / 1000.0,
+           switch_ns / 1000.0 / rounds);
+    // The tables round once where the two scale8 steps each truncate
+    return max_diff <= 2 && switch_ns / rounds < build_ns / 2;
+}
+
+/**
+ * @brief The blend kernel against per-pixel blend(), over all strips.
+ */
+static bool check_blend() {
+    const int steps = 256;
+    int total_leds = 0;
+    for (int s = 0; s < STRIP_COUNT; s++) total_leds += strip_leds[s];
+
+    std::vector<CRGB> from(total_leds), to(total_leds), kernel_out(total_leds), pixel_out(total_leds);
+    for (int i = 0; i < total_leds; i++) {
+        from[i] = CRGB(i * 7, i * 13, i * 29);
+        to[i] = CRGB(255 - i * 3, i * 5, 128 + i);
+    }
+
+    uint64_t kernel_ns = 0, pixel_ns = 0;
+    int max_diff = 0;
+    for (int step = 0; step <= steps; step++) {
+        uint16_t weight = blend_weight_q8(step, steps);
+
+        uint64_t start = now_ns();
+        crossfade_frame(kernel_out.data(), from.data(), to.data(), total_leds, weight);
+        kernel_ns += now_ns() - start;
+
+        // blend() takes an 8-bit amount, so its fade never quite reaches the target
+        start = now_ns();
+        for (int i = 0; i < total_leds; i++) pixel_out[i] = blend(from[i], to[i], min(weight, (uint16_t)255));
+        pixel_ns += now_ns() - start;
+
+        for (int i = 0; i < total_leds; i++) {
+            for (int c = 0; c < 3; c++) max_diff = max(max_diff, abs(kernel_out[i][c] - pixel_out[i][c]));
+        }
+    }
+    bool landed = memcmp(kernel_out.data(), to.data(), total_leds * sizeof(CRGB)) == 0;
+
+    printf("blend       %d LEDs: kernel %.2f us, blend() per pixel %.2f us per frame, max difference %d, %s\n",
+           total_leds, kernel_ns / 1000.0 / (steps + 1), pixel_ns / 1000.0 / (steps + 1), max_diff,
+           landed ? "ends on the target" : "misses the target");
+    return landed && max_diff <= 2 && kernel_ns < pixel_ns;
+}
+
+/**
+ * @brief Effects against their strip bounds and their step timing.
+ */
+static bool check_effects() {
+    static const char* effect_names[] = {"knight_rider", "chasing", "crossfade", "alarm_flash"};
+    static const int lengths[] = {700, 400, 1};
+    const int guard = 16;
+    const CRGB guard_color(0x12, 0x34, 0x56);
+    const int step_ms = 7;
+    bool passed = true;
+
+    for (const char* name : effect_names) {
+        for (int num_leds : lengths) {
+            // The strip sits between guard pixels that no effect may touch
+            std::vector<CRGB> frame(num_leds + 2 * guard, guard_color);
+            std::vector<CRGB> snapshot(num_leds, CRGB(CRGB::Orange)), scratch(num_leds);
+            CRGB* leds = frame.data() + guard;
+            EffectEngine engine;
+            EffectParams params = {CRGB::Blue, step_ms, 20000};
+            if (!engine.start(0, name, num_leds, params, 1000, snapshot.data(), scratch.data())) {
+                printf("effects     %s is not registered\n", name);
+                passed = false;
+                break;
+            }
+
+            int frames = 0, overruns = 0, misplaced = 0;
+            uint64_t render_ns = 0;
+            uint32_t now = 1000;
+            // Uneven frame times, as a late frame scheduler delivers them
+            for (uint32_t dt = 0; now - 1000 < params.duration_ms + 100; dt = (dt + 13) % 41) {
+                uint64_t start = now_ns();
+                bool running = engine.render(0, leds, now);
+                render_ns += now_ns() - start;
+                if (!running) break;
+                frames++;
+
+                for (int i = 0; i < guard; i++) {
+                    if (frame[i] != guard_color || leds[num_leds + i] != guard_color) {
+                        overruns++;
+                        break;
+                    }
+                }
+
+                if (strcmp(name, "knight_rider") == 0) {
+                    uint32_t period = num_leds > 1 ? 2 * (num_leds - 1) : 1;
+                    uint32_t step = ((now - 1000) / step_ms) % period;
+                    int head = step < (uint32_t)num_leds ? step : period - step;
+                    if (leds[head] != params.color) misplaced++;
+                }
+                now += 1 + dt;
+            }
+
+            bool ended = !engine.active(0) && now - 1000 >= params.duration_ms && now - 1000 < params.duration_ms + 100;
+            printf("effects     %-12s %3d LEDs: %5d frames, %d overruns, %d misplaced, %s, %.2f us/frame\n", name,
+                   num_leds, frames, overruns, misplaced, ended ? "ended on time" : "did not end",
+                   frames ? render_ns / 1000.0 / frames : 0.0);
+            if (overruns > 0 || misplaced > 0 || !ended) passed = false;
+        }
+    }
+    return passed;
+}
+
+/**
+ * @struct BenchCheck
+ * @brief One named check.
+ */
+struct BenchCheck {
+    const char* name;
+    bool (*run)();
+};
+
+static const BenchCheck checks[] = {
+    {"compositor", check_compositor},
+    {"wire", check_wire},
+    {"lut", check_lut},
+    {"blend", check_blend},
+    {"effects", check_effects},
+};
+
+int main(int argc, char** argv) {
+    bool passed = true;
+    for (int i = 1; i < argc; i++) {
+        bool known = false;
+        for (const BenchCheck& check : checks) {
+            known = known || strcmp(argv[i], check.name) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "usage: led_bench [CHECK...]\nchecks:");
+            for (const BenchCheck& check : checks) fprintf(stderr, " %s", check.name);
+            fprintf(stderr, "\n");
+            return 2;
+        }
+    }
+
+    for (const BenchCheck& check : checks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++) {
+            selected = selected || strcmp(argv[i], check.name) == 0;
+        }
+        if (!selected) continue;
+        if (!check.run()) {
+            printf("FAIL: %s\n", check.name);
+            passed = false;
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file log_bench.cpp
+ * @brief Host benchmark of the asynchronous SD logger against the old synchronous log_to_sd().
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Several producer threads log messages the way the firmware's tasks do.
+ * The synchronous variant reproduces the old `log_to_sd()`: take a mutex,
+ * format the timestamp, open the file for append, print and close, all on
+ * the caller. The asynchronous variants are the firmware's LogRing and
+ * log_batch_size() with a writer thread that keeps the file open, writing
+ * text lines or the binary log format (log_codec.h). For each variant it
+ * reports messages written per second, messages dropped, bytes written and
+ * caller latency (p50, p99, worst case). A host file system is far faster
+ * than the 4 MHz SD bus, so `--io-delay-us` adds a fixed delay to every file
+ * open, close and write to model the card. Build from the repository root with:
+ *
+ *     g++ -std=c++17 -O2 -pthread -IArduino -o log_bench tools/log_bench/log_bench.cpp \
+ *         Arduino/log_ring.cpp Arduino/log_codec.cpp Arduino/logger.cpp
+ *
+ * Usage:
+ *
+ *     log_bench [--threads N] [--messages N] [--rate N] [--io-delay-us N] [--dir PATH] [--keep]
+ *
+ * `--messages` is per thread; `--rate` paces each thread in messages per
+ * second, 0 for flat out. `--keep` leaves the log files in `--dir`, e.g. to
+ * check tools/log_decode against the text log.
+ */
+#include "version.h"
+#include "log_ring.h"
+#include "log_codec.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @struct BenchOptions
+ * @brief Command line settings.
+ */
+struct BenchOptions {
+    int threads = 4;
+    int messages = 20000;
+    int rate = 0;
+    int io_delay_us = 0;
+    bool keep = false;
+    std::string dir = "/tmp";
+};
+
+/**
+ * @struct BenchResult
+ * @brief Outcome of one variant.
+ */
+struct BenchResult {
+    double seconds;
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t bytes;
+    std::vector<uint32_t> latencies_ns;
+};
+
+// The message every producer logs
+#define BENCH_FORMAT "Task %d: event %d, position %d, status 0x%04x"
+
+static uint64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t until) {
+    uint64_t now = now_ns();
+    if (until <= now) return;
+    struct timespec duration = {(time_t)((until - now) / 1000000000ULL), (long)((until - now) % 1000000000ULL)};
+    nanosleep(&duration, nullptr);
+}
+
+/**
+ * @brief Models the latency of one SD card operation.
+ */
+static void io_delay(const BenchOptions& options) {
+    if (options.io_delay_us > 0) usleep(options.io_delay_us);
+}
+
+/**
+ * @brief Runs the producers; `log(thread, event)` is one call of the variant under test.
+ */
+template <typename LogFn>
+static void run_producers(const BenchOptions& options, BenchResult& result, LogFn log) {
+    std::vector<std::vector<uint32_t>> latencies(options.threads);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < options.threads; t++) {
+        producers.emplace_back([&, t]() {
+            uint64_t next = now_ns();
+            uint64_t period = options.rate > 0 ? 1000000000ULL / options.rate : 0;
+            latencies[t].reserve(options.messages);
+            for (int i = 0; i < options.messages; i++) {
+                uint64_t start = now_ns();
+                log(t, i);
+                latencies[t].push_back((uint32_t)std::min<uint64_t>(now_ns() - start, UINT32_MAX));
+                if (period) {
+                    next += period;
+                    sleep_until_ns(next);
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) producer.join();
+    for (auto& thread_latencies : latencies) {
+        result.latencies_ns.insert(result.latencies_ns.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+}
+
+/**
+ * @brief The old log_to_sd(): everything on the caller, under one mutex.
+ */
+static BenchResult bench_sync(const BenchOptions& options) {
+    std::string path = options.dir + "/log_bench_sync.log";
+    unlink(path.c_str());
+    std::mutex sd_mutex;
+
+    BenchResult result = {};
+    std::atomic<uint64_t> bytes(0);
+    uint64_t start = now_ns();
+    run_producers(options, result, [&](int t, int i) {
+        char message[96];
+        snprintf(message, sizeof(message), BENCH_FORMAT, t, i, i * 37, i & 0xFFFF);
+        std::lock_guard<std::mutex> lock(sd_mutex);
+        struct tm timeinfo;
+        time_t now;
+        time(&now);
+        localtime_r(&now, &timeinfo);
+        char timestamp_str[20];
+        strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+        io_delay(options);
+        FILE* log_file = fopen(path.c_str(), "a");
+        if (log_file) {
+            bytes += fprintf(log_file, "[%s] %s\n", timestamp_str, message);
+            io_delay(options);
+            fclose(log_file);
+        }
+    });
+    result.seconds = (now_ns() - start) / 1e9;
+    result.written = (uint64_t)options.threads * options.messages;
+    result.bytes = bytes;
+    if (!options.keep) unlink(path.c_str());
+    return result;
+}
+
+/**
+ * @brief Fills a record the way log_write() does.
+ */
+static void fill_record(LogRecord* record, const char* format, ...) {
+    record->time = (uint32_t)time(nullptr);
+    record->uptime_ms = (uint32_t)(now_ns() / 1000000);
+    record->format = format;
+    record->level = LOG_LEVEL_INFO;
+    record->module = LOG_SYSTEM;
+    va_list args;
+    va_start(args, format);
+    record->length = log_encode_args(record->args, LOG_RECORD_ARGS, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief The asynchronous logger: lock-free ring, batching writer thread.
+ */
+static BenchResult bench_async(const BenchOptions& options, bool binary) {
+    std::string path = options.dir + (binary ? "/log_bench_async.bin" : "/log_bench_async.log");
+    unlink(path.c_str());
+    static LogRing ring;
+    std::atomic<bool> done(false);
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t file_bytes = 0;
+
+    // The writer task, as in sd_tasks.cpp
+    std::thread writer([&]() {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        static uint8_t batch[LOG_BATCH_MAX + LOG_ENCODED_MAX];
+        static LogEncoder encoder;
+        encoder.reset();
+        size_t buffered = 0;
+        uint32_t file_size = 0;
+        uint64_t oldest = 0;
+        while (true) {
+            bool finishing = done.load();
+            LogRecord* record;
+            while ((record = ring.acquire()) != nullptr) {
+                if (buffered + LOG_ENCODED_MAX > sizeof(batch)) {
+                    size_t size = log_batch_size(file_size, buffered, false);
+                    io_delay(options);
+                    file_size += write(fd, batch, size);
+                    buffered -= size;
+                    memmove(batch, batch + size, buffered);
+                }
+                if (buffered == 0) oldest = now_ns();
+                if (binary) {
+                    buffered += encoder.encode(batch + buffered, LOG_ENCODED_MAX, *record);
+                } else {
+                    buffered += log_format_line((char*)batch + buffered, LOG_LINE_MAX, *record);
+                }
+                written++;
+                ring.release(record);
+            }
+            dropped += ring.take_dropped();
+
+            bool aged = buffered > 0 && now_ns() - oldest >= LOG_FLUSH_AGE_MS * 1000000ULL;
+            size_t size;
+            while ((size = log_batch_size(file_size, buffered, finishing || aged)) > 0) {
+                io_delay(options);
+                file_size += write(fd, batch, size);
+                buffered -= size;
+                memmove(batch, batch + size, buffered);
+                oldest = now_ns();
+            }
+            if (finishing) break;
+            // Stands in for the task notification that wakes the firmware's writer
+            usleep(100);
+        }
+        close(fd);
+        file_bytes = file_size;
+    });
+
+    BenchResult result = {};
+    uint64_t start = now_ns();
+    run_producers(options, result, [&](int t, int i) {
+        LogRecord* record = ring.reserve();
+        if (record == nullptr) return;
+        fill_record(record, BENCH_FORMAT, t, i, i * 37, i & 0xFFFF);
+        ring.commit(record);
+    });
+    done = true;
+    writer.join();
+    result.seconds = (now_ns() - start) / 1e9;
+    result.written = written;
+    result.dropped = dropped;
+    result.bytes = file_bytes;
+    if (!options.keep) unlink(path.c_str());
+    return result;
+}
+
+static void report(const char* name, BenchResult& result) {
+    std::vector<uint32_t>& latencies = result.latencies_ns;
+    std::sort(latencies.begin(), latencies.end());
+    uint32_t p50 = latencies.empty() ? 0 : latencies[(latencies.size() - 1) / 2];
+    uint32_t p99 = latencies.empty() ? 0 : latencies[(latencies.size() - 1) * 99 / 100];
+    uint32_t worst = latencies.empty() ? 0 : latencies.back();
+    printf("%-6s %10.0f msg/s written, %8llu dropped, %9llu bytes, caller p50 %7.2f us, p99 %8.2f us, max %9.2f us\n",
+           name, result.written / result.seconds, (unsigned long long)result.dropped,
+           (unsigned long long)result.bytes, p50 / 1000.0, p99 / 1000.0, worst / 1000.0);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--threads") && has_value) options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--messages") && has_value) options.messages = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rate") && has_value) options.rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--io-delay-us") && has_value) options.io_delay_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dir") && has_value) options.dir = argv[++i];
+        else if (!strcmp(argv[i], "--keep")) options.keep = true;
+        else {
+            fprintf(stderr, "usage: log_bench [--threads N] [--messages N] [--rate N] [--io-delay-us N] [--dir PATH] [--keep]\n");
+            return 2;
+        }
+    }
+    if (options.threads <= 0 || options.messages <= 0 || options.rate < 0 || options.io_delay_us < 0) {
+        fprintf(stderr, "log_bench: invalid arguments\n");
+        return 2;
+    }
+
+    printf("%d threads x %d messages, %s\n", options.threads, options.messages,
+           options.rate ? (std::to_string(options.rate) + " msg/s each").c_str() : "flat out");
+    BenchResult sync_result = bench_sync(options);
+    report("sync", sync_result);
+    BenchResult async_result = bench_async(options, false);
+    report("async", async_result);
+    BenchResult binary_result = bench_async(options, true);
+    report("binary", binary_result);
+    if (binary_result.bytes > 0) {
+        printf("binary log is %.1fx smaller than the text log\n", (double)async_result.bytes / binary_result.bytes);
+    }
+    return 0;
+}
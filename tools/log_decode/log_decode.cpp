@@ -0,0 +1,112 @@
+/**
+ * @file log_decode.cpp
+ * @brief Host decoder for the firmware's binary SD log (SD.LOG_BINARY).
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Turns the binary log segments in /logs on the SD card back into the text
+ * lines the firmware writes to its text segments, using the same decoder and
+ * renderer as the web log view. The segment names sort in order, so passing
+ * every .bin file of the logs directory, as the shell expands it, prints the
+ * whole log. Damaged or truncated records are skipped up to the next session.
+ * Build from the repository root with:
+ *
+ *     g++ -std=c++17 -O2 -IArduino -o log_decode tools/log_decode/log_decode.cpp \
+ *         Arduino/log_codec.cpp Arduino/logger.cpp
+ *
+ * Usage:
+ *
+ *     log_decode [--stats] [FILE...]
+ *
+ * Reads standard input without files. `--stats` reports on standard error how
+ * many bytes the binary log takes against the same messages as text.
+ */
+#include "version.h"
+#include "log_codec.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @struct DecodeStats
+ * @brief Totals over all decoded files.
+ */
+struct DecodeStats {
+    uint64_t binary_bytes;
+    uint64_t text_bytes;
+    uint64_t messages;
+    uint64_t corrupt_bytes;
+};
+
+/**
+ * @struct InputFile
+ * @brief An open input and the bytes read from it.
+ */
+struct InputFile {
+    FILE* file;
+    uint64_t bytes;
+};
+
+static size_t read_input(void* context, uint8_t* buffer, size_t size) {
+    InputFile* input = (InputFile*)context;
+    size_t n = fread(buffer, 1, size, input->file);
+    input->bytes += n;
+    return n;
+}
+
+/**
+ * @brief Decodes one log file to standard output.
+ */
+static void decode_file(FILE* file, DecodeStats& stats) {
+    static LogReader reader;
+    InputFile input = {file, 0};
+    LogRecord record;
+    char line[LOG_LINE_MAX];
+
+    reader.begin(read_input, &input);
+    while (reader.next(&record)) {
+        size_t n = log_format_line(line, sizeof(line), record);
+        fwrite(line, 1, n, stdout);
+        stats.text_bytes += n;
+        stats.messages++;
+    }
+    stats.binary_bytes += input.bytes;
+    stats.corrupt_bytes += reader.corrupt_bytes();
+}
+
+int main(int argc, char** argv) {
+    bool report = false;
+    DecodeStats stats = {};
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--stats")) {
+            report = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "usage: log_decode [--stats] [FILE...]\n");
+            return 2;
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--stats")) continue;
+        FILE* file = strcmp(argv[i], "-") ? fopen(argv[i], "rb") : stdin;
+        if (file == nullptr) {
+            perror(argv[i]);
+            return 1;
+        }
+        decode_file(file, stats);
+        if (file != stdin) fclose(file);
+        files++;
+    }
+    if (files == 0) decode_file(stdin, stats);
+
+    if (report) {
+        fprintf(stderr, "%llu messages, %llu bytes binary, %llu bytes as text (%.1fx), %llu bytes skipped as damaged\n",
+                (unsigned long long)stats.messages, (unsigned long long)stats.binary_bytes,
+                (unsigned long long)stats.text_bytes,
+                stats.binary_bytes ? (double)stats.text_bytes / stats.binary_bytes : 0.0,
+                (unsigned long long)stats.corrupt_bytes);
+    }
+    return 0;
+}
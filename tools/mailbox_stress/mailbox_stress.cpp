@@ -0,0 +1,169 @@
+/**
+ * @file mailbox_stress.cpp
+ * @brief Two-thread stress test of the sequence-locked axis mailbox.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * One thread publishes states to an AxisMailbox as fast as it can, the way
+ * servo_task does; another reads it in a tight loop, the way led_task does.
+ * Every field of a published state is derived from its publish number, so a
+ * reader that copied words of two different publishes sees fields that
+ * disagree. The test counts such torn reads, versions that go backwards and
+ * versions that do not match the state read, and fails on any of them. It
+ * also reports how long a read takes while the writer is busy. Build from
+ * the repository root with:
+ *
+ *     g++ -std=c++17 -O2 -pthread -IArduino -o mailbox_stress tools/mailbox_stress/mailbox_stress.cpp \
+ *         Arduino/axis_mailbox.cpp
+ *
+ * Usage:
+ *
+ *     mailbox_stress [--publishes N] [--publish-gap-us N]
+ *
+ * `--publish-gap-us` pauses the writer between publishes, 0 for flat out.
+ */
+#include "version.h"
+#include "axis_mailbox.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct StressOptions
+ * @brief Command line settings.
+ */
+struct StressOptions {
+    uint32_t publishes = 5000000;
+    int publish_gap_us = 0;
+};
+
+/**
+ * @struct StressResult
+ * @brief What the reader saw.
+ */
+struct StressResult {
+    uint64_t reads = 0;
+    uint64_t torn = 0;              // Fields of different publishes in one state
+    uint64_t backwards = 0;         // Version lower than the previous read
+    uint64_t mismatched = 0;        // Version not the publish number of the state
+    uint64_t new_states = 0;        // Reads that returned a newer version
+    std::vector<uint32_t> read_ns;  // Sampled read durations
+};
+
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief The state of publish number `n`; every field depends on `n`.
+ */
+static AxisState state_for(uint32_t n) {
+    AxisState state = {};
+    state.position = (int32_t)(n * 7919u);
+    state.status = (uint16_t)n;
+    state.min_limit = n & 1;
+    state.max_limit = (n >> 1) & 1;
+    state.timestamp_ms = n * 3;
+    state.last_move_tick = ~n;
+    state.stale = (n >> 2) & 1;
+    state.reserved[0] = (uint8_t)(n >> 8);
+    state.reserved[1] = (uint8_t)(n >> 16);
+    state.reserved[2] = (uint8_t)(n >> 24);
+    return state;
+}
+
+/**
+ * @brief The publish number of a state, or -1 if its fields disagree.
+ */
+static int64_t publish_of(const AxisState& state) {
+    uint32_t n = state.timestamp_ms / 3;
+    AxisState expected = state_for(n);
+    if (state.timestamp_ms % 3 != 0 || memcmp(&state, &expected, sizeof(state)) != 0) return -1;
+    return n;
+}
+
+int main(int argc, char** argv) {
+    StressOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--publishes") && has_value) options.publishes = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--publish-gap-us") && has_value) options.publish_gap_us = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: mailbox_stress [--publishes N] [--publish-gap-us N]\n");
+            return 2;
+        }
+    }
+
+    static AxisMailbox mailbox;
+    std::atomic<bool> done{false};
+    StressResult result;
+    result.read_ns.reserve(1 << 20);
+
+    std::thread reader([&]() {
+        uint32_t last_version = 0;
+        AxisState state;
+        while (true) {
+            bool finished = done.load(std::memory_order_acquire);
+
+            uint64_t start = now_ns();
+            uint32_t version = mailbox.read(state);
+            uint64_t elapsed = now_ns() - start;
+            if ((result.reads & 63) == 0 && result.read_ns.size() < result.read_ns.capacity()) {
+                result.read_ns.push_back((uint32_t)elapsed);
+            }
+            result.reads++;
+
+            if (version < last_version) result.backwards++;
+            if (version != last_version) result.new_states++;
+            if (version > 0) {
+                int64_t n = publish_of(state);
+                if (n < 0) result.torn++;
+                else if ((uint32_t)n != version) result.mismatched++;
+            }
+            last_version = version;
+
+            // One more read after the writer finished must see the last publish
+            if (finished) {
+                if (version != options.publishes) result.mismatched++;
+                break;
+            }
+        }
+    });
+
+    uint64_t start = now_ns();
+    for (uint32_t n = 1; n <= options.publishes; n++) {
+        mailbox.publish(state_for(n));
+        if (options.publish_gap_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(options.publish_gap_us));
+        }
+    }
+    double publish_s = (now_ns() - start) / 1e9;
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    std::vector<uint32_t>& samples = result.read_ns;
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) -> uint32_t {
+        return samples.empty() ? 0 : samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))];
+    };
+
+    printf("%u publishes in %.2f s (%.0f/s), %llu reads, %llu of them a newer state\n", options.publishes,
+           publish_s, options.publishes / publish_s, (unsigned long long)result.reads,
+           (unsigned long long)result.new_states);
+    printf("torn reads %llu, versions going backwards %llu, versions not matching the state %llu\n",
+           (unsigned long long)result.torn, (unsigned long long)result.backwards,
+           (unsigned long long)result.mismatched);
+    printf("read while publishing: p50 %u ns, p99 %u ns, worst %u ns\n", percentile(0.50), percentile(0.99),
+           samples.empty() ? 0 : samples.back());
+
+    bool passed = result.torn == 0 && result.backwards == 0 && result.mismatched == 0;
+    if (!passed) printf("FAIL\n");
+    return passed ? 0 : 1;
+}
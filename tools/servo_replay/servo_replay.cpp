@@ -0,0 +1,496 @@
+/**
+ * @file servo_replay.cpp
+ * @brief Host replay harness running the firmware's servo polling logic against the LC10e simulator.
+ *
+ * Project: fireCNC
+ * Version: 1.0.0
+ *
+ * Runs the same ServoPoller, register map coalescing, poll scheduler, retry
+ * policy, Modbus statistics and gantry skew monitor as servo_task, with the
+ * same tick length planned from the bus time of each tick's reads, and the
+ * RTU master's ModbusExchange for each transaction's timing and response
+ * assembly, but carries each read out synchronously over a host serial
+ * endpoint. It either
+ * connects to a running lc10e_sim (--device) or runs the simulator
+ * in-process on a socketpair (--scenario), which needs no pty and suits CI.
+ * At the end it prints throughput, round-trip latency percentiles, the
+ * frames and bytes on the bus against one read per wanted register range,
+ * and the per-servo counters, and fails if a threshold is missed or the
+ * register plan left a range out. `--read-along` lets every slave's reads be
+ * merged across a register block, as SERVOS.*_READ_ALONG does on the device.
+ *
+ * With --scenario it also feeds the positions to a MotionEstimator per axis,
+ * as led_task does, predicts them at LED render times (--render-fps) and
+ * compares the predictions with the scenario's own positions at those times.
+ * The report gives the mean, p99 and largest error per axis, next to the
+ * error of showing the newest sample unpredicted. Build from the repository
+ * root with:
+ *
+ *     g++ -std=c++17 -O2 -pthread -IArduino -Itools/lc10e_sim -o servo_replay \
+ *         tools/servo_replay/servo_replay.cpp tools/lc10e_sim/lc10e_model.cpp \
+ *         tools/lc10e_sim/sim_serial.cpp Arduino/servo_poller.cpp Arduino/servo_registers.cpp \
+ *         Arduino/poll_scheduler.cpp Arduino/gantry_skew.cpp Arduino/modbus_stats.cpp \
+ *         Arduino/modbus_codec.cpp Arduino/modbus_exchange.cpp Arduino/motion_estimator.cpp
+ *
+ * Usage:
+ *
+ *     servo_replay (--device PATH | --scenario FILE) [--duration MS] [--baud N]
+ *                  [--timeout-ms N] [--slaves 1,2,3] [--rail-counts N]
+ *                  [--skew-counts N] [--csv FILE] [--render-fps F]
+ *                  [--min-position-hz F] [--max-p99-us N] [--read-along FIRST-LAST]
+ *
+ * Exit status: 0 on success, 1 if a threshold was missed, 2 on usage errors.
+ */
+#include "version.h"
+#include "servo_poller.h"
+#include "modbus_exchange.h"
+#include "modbus_stats.h"
+#include "motion_estimator.h"
+#include "lc10e_model.h"
+#include "sim_serial.h"
+#include <algorithm>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Longest a request may wait before it is dropped as stale, as in servo_tasks.cpp
+#define SERVO_REQUEST_MAX_AGE_MS 100
+
+static const char* axis_names[AXIS_COUNT] = {"Y", "YY", "X"};
+
+/**
+ * @struct ReplayOptions
+ * @brief Command line settings.
+ */
+struct ReplayOptions {
+    const char* device = nullptr;
+    const char* scenario = nullptr;
+    const char* csv = nullptr;
+    uint32_t duration_ms = 0;
+    int baud = 19200;
+    uint16_t timeout_ms = 30;
+    uint8_t slave_ids[AXIS_COUNT] = {1, 2, 3};
+    int64_t rail_counts = 0;
+    float skew_counts = 0.0f;
+    float render_fps = 60.0f;
+    float min_position_hz = 0.0f;
+    uint32_t max_p99_us = 0;
+    RegisterSpan read_along = {0, 0};
+};
+
+static uint64_t start_us;
+
+/**
+ * @brief Replay time in milliseconds, the harness' millis().
+ */
+static uint32_t replay_millis() {
+    return (uint32_t)((host_micros() - start_us) / 1000);
+}
+
+/**
+ * @brief Carries one read attempt out on the bus with the RTU master's ModbusExchange.
+ *
+ * Only the transport differs from modbus_rtu.cpp: poll() and read() on the
+ * descriptor in place of the UART events. The response registers point into
+ * `exchange`.
+ */
+static ModbusResponse transact(int fd, ModbusExchange& exchange, const ServoRead& read,
+                               const ReplayOptions& options, uint32_t deadline_ms) {
+    ModbusRequest request = {};
+    request.slave_id = read.slave_id;
+    request.address = read.address;
+    request.count = read.count;
+    request.timeout_ms = options.timeout_ms;
+    request.deadline_ms = deadline_ms;
+
+    if (exchange.begin(request, replay_millis(), host_micros(), modbus_frame_gap_us(options.baud, 0))) {
+        // Late answers to an earlier, timed-out request must not be taken for this one
+        if (isatty(fd)) tcflush(fd, TCIFLUSH);
+        serial_write_frame(fd, exchange.request_frame(), exchange.request_length());
+
+        while (!exchange.done(host_micros())) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, (int)((exchange.wait_us(host_micros()) + 999) / 1000));
+            if (ready <= 0 || !(pfd.revents & POLLIN)) continue;
+            size_t room;
+            uint8_t* into = exchange.receive_buffer(&room);
+            uint8_t discard[64];
+            ssize_t n = ::read(fd, room > 0 ? into : discard, room > 0 ? room : sizeof(discard));
+            if (n > 0) exchange.received(room > 0 ? (size_t)n : 0, host_micros());
+            else if (n == 0) exchange.overrun();
+        }
+
+        // Keep the bus silent for the inter-frame gap before the next request
+        uint32_t quiet_us = exchange.quiet_us(host_micros());
+        struct timespec duration = {0, (long)quiet_us * 1000};
+        if (quiet_us > 0) nanosleep(&duration, nullptr);
+    }
+    return exchange.finish(host_micros());
+}
+
+/**
+ * @brief Sleeps until the next tick, starting at once if the tick ran late.
+ */
+static void delay_until(uint64_t& last_wake_us, uint32_t period_ms) {
+    last_wake_us += period_ms * 1000ULL;
+    uint64_t now = host_micros();
+    if (last_wake_us <= now) {
+        last_wake_us = now;
+        return;
+    }
+    uint64_t wait_us = last_wake_us - now;
+    struct timespec duration = {(time_t)(wait_us / 1000000), (long)(wait_us % 1000000) * 1000};
+    nanosleep(&duration, nullptr);
+}
+
+static bool parse_slaves(const char* text, uint8_t slave_ids[AXIS_COUNT]) {
+    int ids[AXIS_COUNT];
+    if (sscanf(text, "%d,%d,%d", &ids[0], &ids[1], &ids[2]) != AXIS_COUNT) return false;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        if (ids[axis] < 1 || ids[axis] > 247) return false;
+        slave_ids[axis] = (uint8_t)ids[axis];
+    }
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: servo_replay (--device PATH | --scenario FILE) [--duration MS] [--baud N]\n"
+            "                    [--timeout-ms N] [--slaves 1,2,3] [--rail-counts N]\n"
+            "                    [--skew-counts N] [--csv FILE] [--render-fps F]\n"
+            "                    [--min-position-hz F] [--max-p99-us N] [--read-along FIRST-LAST]\n");
+}
+
+static bool parse_options(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        const char* arg = argv[i];
+        if (!has_value) return false;
+        const char* value = argv[++i];
+        if (!strcmp(arg, "--device")) options.device = value;
+        else if (!strcmp(arg, "--scenario")) options.scenario = value;
+        else if (!strcmp(arg, "--csv")) options.csv = value;
+        else if (!strcmp(arg, "--duration")) options.duration_ms = strtoul(value, nullptr, 10);
+        else if (!strcmp(arg, "--baud")) options.baud = atoi(value);
+        else if (!strcmp(arg, "--timeout-ms")) options.timeout_ms = (uint16_t)atoi(value);
+        else if (!strcmp(arg, "--slaves")) {
+            if (!parse_slaves(value, options.slave_ids)) return false;
+        }
+        else if (!strcmp(arg, "--rail-counts")) options.rail_counts = strtoll(value, nullptr, 10);
+        else if (!strcmp(arg, "--skew-counts")) options.skew_counts = strtof(value, nullptr);
+        else if (!strcmp(arg, "--render-fps")) options.render_fps = strtof(value, nullptr);
+        else if (!strcmp(arg, "--min-position-hz")) options.min_position_hz = strtof(value, nullptr);
+        else if (!strcmp(arg, "--max-p99-us")) options.max_p99_us = strtoul(value, nullptr, 10);
+        else if (!strcmp(arg, "--read-along")) {
+            if (!register_range_parse(value, &options.read_along)) return false;
+        }
+        else return false;
+    }
+    if ((options.device == nullptr) == (options.scenario == nullptr)) return false;
+    return options.baud > 0 && options.timeout_ms > 0 && options.render_fps > 0.0f;
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, int percent) {
+    if (values.empty()) return 0;
+    size_t index = (values.size() - 1) * percent / 100;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+/**
+ * @struct RenderReplay
+ * @brief The LED side of the replay: position prediction at render times
+ *        against the scenario's positions.
+ *
+ * The scenario is loaded a second time into a model of its own, which only
+ * serves as the ground truth, so the simulator thread's model is never read
+ * from this thread. Both start at time 0 with the first request.
+ */
+struct RenderReplay {
+    Lc10eModel truth;
+    const Lc10eServo* servos[AXIS_COUNT] = {};
+    MotionEstimator estimators[AXIS_COUNT];
+    bool sampled[AXIS_COUNT] = {false, false, false};
+    int32_t newest[AXIS_COUNT] = {0, 0, 0};
+    std::vector<uint32_t> errors[AXIS_COUNT];       // Predicted position
+    std::vector<uint32_t> hold_errors[AXIS_COUNT];  // Newest sample, unpredicted
+    double next_render_ms = 0.0;
+    double frame_ms = 0.0;
+};
+
+static bool render_begin(RenderReplay& render, const ReplayOptions& options, std::string& error) {
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        render.truth.add_servo(options.slave_ids[axis]);
+    }
+    if (!render.truth.load_scenario(options.scenario, error)) return false;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        for (const Lc10eServo& servo : render.truth.servos()) {
+            if (servo.slave_id == options.slave_ids[axis]) render.servos[axis] = &servo;
+        }
+    }
+    render.frame_ms = 1000.0 / options.render_fps;
+    return true;
+}
+
+/**
+ * @brief Renders every frame due up to `now_ms` with the samples known so far.
+ */
+static void render_until(RenderReplay& render, uint32_t now_ms) {
+    while (render.next_render_ms <= now_ms) {
+        uint32_t render_ms = (uint32_t)render.next_render_ms;
+        render.truth.advance(render_ms);
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            if (!render.sampled[axis]) continue;
+            int64_t actual = render.servos[axis]->position_at(render_ms);
+            int64_t predicted = render.estimators[axis].position_at(render_ms);
+            render.errors[axis].push_back((uint32_t)llabs(predicted - actual));
+            render.hold_errors[axis].push_back((uint32_t)llabs(render.newest[axis] - actual));
+        }
+        render.next_render_ms += render.frame_ms;
+    }
+}
+
+/**
+ * @brief Prints the mean, p99 and largest error of one axis.
+ */
+static void print_errors(const char* label, std::vector<uint32_t>& errors) {
+    double sum = 0.0;
+    uint32_t worst = 0;
+    for (uint32_t error : errors) {
+        sum += error;
+        worst = std::max(worst, error);
+    }
+    double mean = errors.empty() ? 0.0 : sum / errors.size();
+    printf("  %-9s mean %6.0f, p99 %6u, max %6u", label, mean, percentile(errors, 99), worst);
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    // The bus: a running simulator's pty, or an in-process simulator on a socketpair
+    Lc10eModel model;
+    std::atomic<bool> stop_sim(false);
+    std::thread sim_thread;
+    int fd;
+    if (options.device) {
+        fd = serial_open(options.device);
+        if (fd < 0) {
+            perror(options.device);
+            return 2;
+        }
+        if (options.duration_ms == 0) options.duration_ms = 10000;
+    } else {
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            model.add_servo(options.slave_ids[axis]);
+        }
+        std::string error;
+        if (!model.load_scenario(options.scenario, error)) {
+            fprintf(stderr, "servo_replay: %s\n", error.c_str());
+            return 2;
+        }
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            perror("socketpair");
+            return 2;
+        }
+        fd = pair[0];
+        int sim_fd = pair[1];
+        int baud = options.baud;
+        sim_thread = std::thread([&model, &stop_sim, sim_fd, baud]() {
+            sim_serve(sim_fd, model, baud, stop_sim, false);
+        });
+    }
+
+    FILE* csv = nullptr;
+    if (options.csv) {
+        csv = fopen(options.csv, "w");
+        if (!csv) {
+            perror(options.csv);
+            return 2;
+        }
+        fprintf(csv, "time_ms,axis,position,status,ok,stale,latency_us\n");
+    }
+
+    RenderReplay render;
+    if (options.scenario) {
+        std::string error;
+        if (!render_begin(render, options, error)) {
+            fprintf(stderr, "servo_replay: %s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    int64_t counts_per_rail[AXIS_COUNT] = {options.rail_counts, options.rail_counts, options.rail_counts};
+    ServoPoller poller;
+    poller.begin(options.slave_ids, counts_per_rail);
+    poller.set_baud(options.baud);
+    for (int axis = 0; axis < AXIS_COUNT && options.read_along.count > 0; axis++) {
+        poller.allow(axis, options.read_along.start, options.read_along.count);
+    }
+    if (options.skew_counts > 0.0f) {
+        // One count per millimeter, so the threshold is given in counts
+        poller.skew_monitor().configure(1.0f, options.skew_counts, 0.2f);
+    }
+
+    std::vector<uint32_t> latencies;
+    uint32_t ticks = 0;
+    uint32_t late_ticks = 0;
+    uint64_t planned_tick_ms = 0;
+    uint32_t transactions = 0;
+    uint32_t position_samples[AXIS_COUNT] = {0, 0, 0};
+    uint32_t skew_alarms = 0;
+    uint64_t bus_bytes = 0;
+    uint32_t planned_frames = 0, uncoalesced_frames = 0;
+    uint64_t planned_bytes = 0, uncoalesced_bytes = 0;
+    int most_reads = 0, most_ranges = 0;
+    ModbusExchange exchange;
+
+    start_us = host_micros();
+    uint64_t last_wake_us = start_us;
+    while (true) {
+        uint32_t now = replay_millis();
+        if (options.duration_ms ? now >= options.duration_ms : model.finished()) break;
+        if (options.scenario) render_until(render, now);
+
+        int num_reads = poller.plan(now);
+        uint32_t tick_ms = poller.tick_ms();
+        planned_tick_ms += tick_ms;
+
+        // Request and response frames of the plan, and of one read per wanted range
+        for (int i = 0; i < num_reads; i++) {
+            planned_frames++;
+            planned_bytes += MODBUS_READ_REQUEST_SIZE + 5 + 2 * poller.read(i).count;
+        }
+        int ranges = 0;
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            const RegisterMap& map = poller.register_map(axis);
+            for (int r = 0; r < map.range_count(); r++) {
+                uncoalesced_frames++;
+                uncoalesced_bytes += MODBUS_READ_REQUEST_SIZE + 5 + 2 * map.range(r).count;
+            }
+            ranges += map.range_count();
+        }
+        most_reads = std::max(most_reads, num_reads);
+        most_ranges = std::max(most_ranges, ranges);
+
+        for (int i = 0; i < num_reads; i++) {
+            while (true) {
+                ModbusResponse response = transact(fd, exchange, poller.read(i), options,
+                                                   now + SERVO_REQUEST_MAX_AGE_MS);
+                transactions++;
+                bus_bytes += MODBUS_READ_REQUEST_SIZE;
+                if (response.status != MODBUS_TIMEOUT) bus_bytes += 5 + 2 * poller.read(i).count;
+                if (response.status == MODBUS_OK) latencies.push_back(response.elapsed_us);
+                poller.account(i, response);
+                if (poller.retry(i, response.status)) {
+                    modbus_stats_retry(poller.read(i).axis);
+                    continue;
+                }
+                poller.complete(i, response, replay_millis());
+                break;
+            }
+        }
+
+        // Frames rendered while the reads were on the bus still see the old samples
+        if (options.scenario) render_until(render, replay_millis());
+
+        if (poller.finish()) {
+            skew_alarms++;
+            printf("%8u ms  gantry skew alarm: %.0f counts\n", replay_millis(),
+                   poller.skew_monitor().stats().error_mm);
+        }
+
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            const ServoAxisResult& result = poller.result(axis);
+            if (!result.position_read) continue;
+            AxisState state = poller.state(axis);
+            if (result.position_ok) {
+                position_samples[axis]++;
+                render.estimators[axis].add_sample(state.timestamp_ms, state.position, state.min_limit,
+                                                   state.max_limit);
+                render.sampled[axis] = true;
+                render.newest[axis] = state.position;
+            }
+            if (csv) {
+                fprintf(csv, "%u,%s,%d,%u,%d,%d,%u\n", result.sample_ms, axis_names[axis], state.position,
+                        state.status, result.position_ok ? 1 : 0, state.stale, result.latency_us);
+            }
+        }
+        poller.update_stats(replay_millis());
+
+        ticks++;
+        if (replay_millis() - now > tick_ms) late_ticks++;
+        delay_until(last_wake_us, tick_ms);
+    }
+    uint32_t elapsed_ms = replay_millis();
+
+    stop_sim = true;
+    if (sim_thread.joinable()) {
+        shutdown(fd, SHUT_RDWR);
+        sim_thread.join();
+    }
+    close(fd);
+    if (csv) fclose(csv);
+
+    // Report
+    float seconds = elapsed_ms / 1000.0f;
+    std::vector<uint32_t> sorted = latencies;
+    uint32_t p50 = percentile(sorted, 50);
+    uint32_t p99 = percentile(sorted, 99);
+    uint32_t worst = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+
+    printf("duration        %.2f s, %u ticks (%u late), planned tick %.1f ms on average\n", seconds, ticks,
+           late_ticks, ticks ? (double)planned_tick_ms / ticks : 0.0);
+    printf("transactions    %u (%.1f/s), %llu bytes on the bus\n", transactions, transactions / seconds,
+           (unsigned long long)bus_bytes);
+    printf("read plan       %u frames, %llu bytes (one read per range: %u frames, %llu bytes), "
+           "%u ranges left out\n", planned_frames, (unsigned long long)planned_bytes, uncoalesced_frames,
+           (unsigned long long)uncoalesced_bytes, poller.dropped_ranges());
+    printf("reads per tick  at most %d (one read per range: %d)\n", most_reads, most_ranges);
+    printf("round trip      p50 %u us, p99 %u us, max %u us\n", p50, p99, worst);
+    printf("gantry skew     %u alarms\n", skew_alarms);
+    if (options.scenario) {
+        printf("render error    counts at %.0f fps, predicted against newest sample\n", options.render_fps);
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            printf("%-3s %5zu frames", axis_names[axis], render.errors[axis].size());
+            print_errors("predicted", render.errors[axis]);
+            print_errors("newest", render.hold_errors[axis]);
+            printf("\n");
+        }
+    }
+
+    bool passed = true;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        ModbusSlaveStats stats = modbus_stats(axis);
+        float position_hz = position_samples[axis] / seconds;
+        printf("%-3s slave %3u   position %.1f Hz, ok %u, timeout %u, crc %u, exception %u, "
+               "bad %u, expired %u, retries %u\n",
+               axis_names[axis], options.slave_ids[axis], position_hz, stats.success, stats.timeouts,
+               stats.crc_errors, stats.exceptions, stats.bad_responses, stats.expired, stats.retries);
+        if (position_hz < options.min_position_hz) {
+            printf("FAIL: %s position rate %.1f Hz below %.1f Hz\n", axis_names[axis], position_hz,
+                   options.min_position_hz);
+            passed = false;
+        }
+    }
+    if (poller.dropped_ranges() > 0) {
+        printf("FAIL: %u register ranges left out of the read plan\n", poller.dropped_ranges());
+        passed = false;
+    }
+    if (options.max_p99_us && p99 > options.max_p99_us) {
+        printf("FAIL: p99 round trip %u us above %u us\n", p99, options.max_p99_us);
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}